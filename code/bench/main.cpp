@@ -0,0 +1,88 @@
+// Headless benchmark: renders a fixed number of frames and prints the measurements as a single JSON object on
+// stdout. Accepts all vkTriangle options, e.g.
+//   VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json vkTriangle_bench --frames 2000 --instances 10000
+
+#include "goboVkTriangle/goboVkTriangle.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static const uint32_t kDefaultBenchmarkFrameCount = 1000;
+
+static uint64_t peakResidentSetSize()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters = {};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    struct rusage usage = {};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    // Linux reports kilobytes.
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    sorban::loom::loggerInit("./vkTriangle_bench.log", 10, 3);
+
+    ApplicationConfig config;
+    config.frameCount = kDefaultBenchmarkFrameCount;
+    // A warm pipeline cache from an earlier run would make startup times incomparable.
+    config.pipelineCachePath.clear();
+    if (!parseCommandLine(argc, argv, config))
+    {
+        return EXIT_FAILURE;
+    }
+    config.headless = true;
+    if (config.frameCount == 0)
+    {
+        config.frameCount = kDefaultBenchmarkFrameCount;
+    }
+
+    RunStatistics statistics;
+    const bool succeeded = runApplication(config, &statistics);
+
+    std::printf("{\"succeeded\": %s, \"width\": %u, \"height\": %u, \"instances\": %u, \"framesInFlight\": %u, "
+                "\"frames\": %llu, \"startupMs\": %.3f, \"timeToFirstFrameMs\": %.3f, \"pipelineVariants\": %u, "
+                "\"pipelineVariantsReadyAtFirstFrame\": %u, \"pipelineBuildMs\": %.3f, \"framesPerSecond\": %.2f, "
+                "\"frameTimeAvgMs\": %.4f, \"frameTimeP50Ms\": %.4f, \"frameTimeP99Ms\": %.4f, "
+                "\"peakRssBytes\": %llu}\n",
+                succeeded ? "true" : "false",
+                config.width,
+                config.height,
+                config.instanceCount,
+                config.maxFramesInFlight,
+                static_cast<unsigned long long>(statistics.frameCount),
+                statistics.startupTime,
+                statistics.timeToFirstFrame,
+                statistics.pipelineVariants,
+                statistics.pipelineVariantsReadyAtFirstFrame,
+                statistics.pipelineBuildTime,
+                statistics.framesPerSecond,
+                statistics.averageFrameTime,
+                statistics.frameTimeP50,
+                statistics.frameTimeP99,
+                static_cast<unsigned long long>(peakResidentSetSize()));
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+// Microbenchmark of MappedFile against reading the whole file into a heap buffer, the loader it replaces. Writes a
+// file of the given size, then touches every page once through both, which is the access pattern of an upload into a
+// staging buffer. The page cache is warm for both. Prints milliseconds per load as a single JSON object on stdout, e.g.
+//   vkTriangle_mapped_file_bench --size-mb 4096
+
+#include "mappedFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static const uint32_t kDefaultSizeMb = 64;
+static const uint64_t kPageSize = 4096;
+
+static bool parseUnsigned(const char* text, uint32_t& value)
+{
+    char* end = nullptr;
+    const unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || parsed == 0)
+    {
+        std::fprintf(stderr, "Expected a positive number, got: %s\n", text);
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+static bool writeFile(const std::string& filePath, uint64_t size)
+{
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    const std::vector<char> chunk(1024 * 1024, 7);
+    for (uint64_t written = 0; written < size && file.good(); written += chunk.size())
+    {
+        file.write(chunk.data(), chunk.size());
+    }
+    return file.good();
+}
+
+static bool readFileCopy(const std::string& filePath, std::vector<char>& content)
+{
+    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    content.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(content.data(), content.size());
+    return file.good();
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t sizeMb = kDefaultSizeMb;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--size-mb" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], sizeMb))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown command line argument: %s\n", argument.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    const std::string filePath = "mappedFileBench.bin";
+    if (!writeFile(filePath, static_cast<uint64_t>(sizeMb) * 1024 * 1024))
+    {
+        std::fprintf(stderr, "Failed to write %s\n", filePath.c_str());
+        std::remove(filePath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    uint64_t copySum = 0;
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::vector<char> content;
+        if (!readFileCopy(filePath, content))
+        {
+            std::fprintf(stderr, "Failed to read %s\n", filePath.c_str());
+            std::remove(filePath.c_str());
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < content.size(); i += kPageSize)
+        {
+            copySum += static_cast<uint8_t>(content[i]);
+        }
+    }
+    const double copyTime = millisecondsSince(start);
+
+    uint64_t mappedSum = 0;
+    start = std::chrono::steady_clock::now();
+    {
+        MappedFile file;
+        if (!file.open(filePath, MappedFile::AccessHint::Sequential))
+        {
+            std::fprintf(stderr, "Failed to map %s\n", filePath.c_str());
+            std::remove(filePath.c_str());
+            return EXIT_FAILURE;
+        }
+        file.prefetch(0, file.size());
+        for (uint64_t i = 0; i < file.size(); i += kPageSize)
+        {
+            mappedSum += static_cast<uint8_t>(file.data()[i]);
+        }
+    }
+    const double mappedTime = millisecondsSince(start);
+    std::remove(filePath.c_str());
+
+    std::printf("{\"sizeMb\": %u, \"copyMs\": %.2f, \"mappedMs\": %.2f, \"speedup\": %.2f}\n",
+                sizeMb,
+                copyTime,
+                mappedTime,
+                copyTime / mappedTime);
+    // Both loaders have to see the same bytes for the timings to compare.
+    return copySum == mappedSum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
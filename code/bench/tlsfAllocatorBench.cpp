@@ -0,0 +1,108 @@
+// Microbenchmark of TlsfAllocator under steady state churn: keeps N live allocations of random sizes in one block and
+// replaces a random one at a time. Prints the throughput, utilization and fragmentation as a single JSON object on
+// stdout, e.g.
+//   vkTriangle_tlsf_bench --live 4096 --iterations 1000000
+
+#include "tlsfAllocator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static const uint64_t kBlockSize = 256ull * 1024 * 1024;
+static const uint64_t kAlignment = 256;
+static const uint32_t kDefaultLiveCount = 4096;
+static const uint32_t kDefaultIterationCount = 1000000;
+
+static bool parseUnsigned(const char* text, uint32_t& value)
+{
+    char* end = nullptr;
+    const unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || parsed == 0)
+    {
+        std::fprintf(stderr, "Expected a positive number, got: %s\n", text);
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+static uint64_t randomSize(std::mt19937& random)
+{
+    return 256 + random() % (64 * 1024);
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t liveCount = kDefaultLiveCount;
+    uint32_t iterations = kDefaultIterationCount;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--live" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], liveCount))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else if (argument == "--iterations" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], iterations))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown command line argument: %s\n", argument.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    TlsfAllocator allocator(kBlockSize);
+    std::vector<TlsfAllocator::Allocation> allocations(liveCount);
+    std::mt19937 random(42);
+    for (TlsfAllocator::Allocation& allocation : allocations)
+    {
+        if (!allocator.allocate(randomSize(random), kAlignment, allocation))
+        {
+            std::fprintf(stderr, "%u live allocations do not fit into the block.\n", liveCount);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Free a random live allocation and replace it with one of a random size.
+    uint32_t failed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        TlsfAllocator::Allocation& allocation = allocations[random() % liveCount];
+        allocator.free(allocation.handle);
+        if (!allocator.allocate(randomSize(random), kAlignment, allocation))
+        {
+            allocation = TlsfAllocator::Allocation();
+            ++failed;
+        }
+    }
+    const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+    const TlsfStats stats = allocator.stats();
+    const uint64_t freeSize = stats.totalSize - stats.usedSize;
+    const double fragmentation =
+        freeSize > 0 ? 1.0 - static_cast<double>(stats.largestFreeRange) / static_cast<double>(freeSize) : 0.0;
+    std::printf("{\"live\": %u, \"iterations\": %u, \"totalMs\": %.3f, \"pairsPerSecond\": %.0f, \"failed\": %u, "
+                "\"utilization\": %.4f, \"fragmentation\": %.4f, \"freeRanges\": %llu}\n",
+                liveCount,
+                iterations,
+                elapsed.count(),
+                iterations / (elapsed.count() / 1000.0),
+                failed,
+                static_cast<double>(stats.usedSize) / static_cast<double>(stats.totalSize),
+                fragmentation,
+                static_cast<unsigned long long>(stats.freeRangeCount));
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
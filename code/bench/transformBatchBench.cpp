@@ -0,0 +1,208 @@
+// Microbenchmark of TransformBatch against naive per object glm code: composes the model matrices and world bounding
+// spheres of N objects, then frustum culls them. Prints the average milliseconds per call of every SIMD level the CPU
+// supports as a single JSON object on stdout, e.g.
+//   vkTriangle_transform_bench --objects 100000 --iterations 200
+
+// glm reads its configuration on the first include, which is in transformBatch.h.
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "transformBatch.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+static const uint32_t kDefaultObjectCount = 100000;
+static const uint32_t kDefaultIterationCount = 100;
+
+// The array of structures layout the batch replaces.
+struct NaiveObject
+{
+    glm::vec3 position;
+    glm::quat rotation;
+    float scale;
+    glm::vec4 localSphere;
+    glm::mat4 model;
+    glm::vec4 worldSphere;
+};
+
+struct Timings
+{
+    double updateTime = 0.0;
+    double cullTime = 0.0;
+    size_t visibleCount = 0;
+};
+
+static bool parseUnsigned(const char* text, uint32_t& value)
+{
+    char* end = nullptr;
+    const unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || parsed == 0)
+    {
+        std::fprintf(stderr, "Expected a positive number, got: %s\n", text);
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+// Objects scattered around the camera, a good part of them outside the frustum.
+static void makeObject(uint32_t i, glm::vec3& position, glm::quat& rotation, float& scale)
+{
+    const float t = static_cast<float>(i);
+    position = glm::vec3(60.0f * std::sin(t * 0.013f), 60.0f * std::cos(t * 0.029f), -60.0f * std::fabs(std::sin(t)));
+    rotation = glm::angleAxis(t * 0.1f, glm::normalize(glm::vec3(std::sin(t), std::cos(t), 0.5f)));
+    scale = 0.5f + 0.1f * static_cast<float>(i % 10);
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Timings runNaive(std::vector<NaiveObject>& objects,
+                        const glm::vec4 planes[6],
+                        uint32_t iterations,
+                        std::vector<uint32_t>& visible)
+{
+    Timings timings;
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (NaiveObject& object : objects)
+        {
+            object.model = glm::translate(glm::mat4(1.0f), object.position) * glm::mat4_cast(object.rotation) *
+                           glm::scale(glm::mat4(1.0f), glm::vec3(object.scale));
+            const glm::vec4 center = object.model * glm::vec4(glm::vec3(object.localSphere), 1.0f);
+            object.worldSphere = glm::vec4(glm::vec3(center), std::fabs(object.scale) * object.localSphere.w);
+        }
+        timings.updateTime += millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        visible.clear();
+        for (uint32_t i = 0; i < objects.size(); ++i)
+        {
+            const glm::vec4& sphere = objects[i].worldSphere;
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; ++p)
+            {
+                inside = glm::dot(glm::vec3(planes[p]), glm::vec3(sphere)) + planes[p].w >= -sphere.w;
+            }
+            if (inside)
+            {
+                visible.push_back(i);
+            }
+        }
+        timings.cullTime += millisecondsSince(start);
+    }
+    timings.updateTime /= iterations;
+    timings.cullTime /= iterations;
+    timings.visibleCount = visible.size();
+    return timings;
+}
+
+static Timings runBatch(TransformBatch& batch,
+                        const glm::vec4 planes[6],
+                        uint32_t iterations,
+                        std::vector<uint32_t>& visible)
+{
+    Timings timings;
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        auto start = std::chrono::steady_clock::now();
+        batch.update();
+        timings.updateTime += millisecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        visible.clear();
+        batch.cull(planes, visible);
+        timings.cullTime += millisecondsSince(start);
+    }
+    timings.updateTime /= iterations;
+    timings.cullTime /= iterations;
+    timings.visibleCount = visible.size();
+    return timings;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t objectCount = kDefaultObjectCount;
+    uint32_t iterations = kDefaultIterationCount;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--objects" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], objectCount))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else if (argument == "--iterations" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], iterations))
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "Unknown command line argument: %s\n", argument.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    frustumPlanes(projection * view, planes);
+    const glm::vec4 localSphere(0.1f, 0.2f, 0.0f, 0.75f);
+
+    std::vector<NaiveObject> objects(objectCount);
+    for (uint32_t i = 0; i < objectCount; ++i)
+    {
+        makeObject(i, objects[i].position, objects[i].rotation, objects[i].scale);
+        objects[i].localSphere = localSphere;
+    }
+    std::vector<uint32_t> visible;
+    visible.reserve(objectCount);
+    const Timings naive = runNaive(objects, planes, iterations, visible);
+
+    std::printf("{\"objects\": %u, \"iterations\": %u, \"visible\": %zu, \"detected\": \"%s\", "
+                "\"glm\": {\"updateMs\": %.4f, \"cullMs\": %.4f}",
+                objectCount,
+                iterations,
+                naive.visibleCount,
+                simdLevelName(detectSimdLevel()),
+                naive.updateTime,
+                naive.cullTime);
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2})
+    {
+        TransformBatch batch(level);
+        if (batch.simdLevel() != level)
+        {
+            continue;
+        }
+        batch.reserve(objectCount);
+        for (const NaiveObject& object : objects)
+        {
+            batch.add(object.position, object.rotation, object.scale, object.localSphere);
+        }
+        const Timings timings = runBatch(batch, planes, iterations, visible);
+        // Matches the glm count, up to spheres grazing a plane that round to the other side.
+        std::printf(", \"%s\": {\"updateMs\": %.4f, \"cullMs\": %.4f, \"speedup\": %.2f, \"visible\": %zu}",
+                    simdLevelName(level),
+                    timings.updateTime,
+                    timings.cullTime,
+                    (naive.updateTime + naive.cullTime) / (timings.updateTime + timings.cullTime),
+                    timings.visibleCount);
+    }
+    std::printf("}\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#ifndef COMMANDRECORDER_H
+#define COMMANDRECORDER_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class WorkerPool;
+
+// Records the draws of a render pass into secondary command buffers on the threads of a WorkerPool. Every
+// recording task has its own command pool per slot, so a pool is never touched by two threads at once.
+class ParallelCommandRecorder
+{
+public:
+    // Records draws [firstDraw, firstDraw + drawCount) into commandBuffer, including all state the draws need.
+    using RecordFunction = std::function<void(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)>;
+
+    ParallelCommandRecorder();
+
+    bool init(VkDevice device,
+              uint32_t queueFamilyIndex,
+              WorkerPool& workerPool,
+              VkCommandPoolCreateFlags commandPoolFlags = 0);
+    void destroy();
+
+    // Splits drawCount draws into one contiguous range per task and records them into the secondary buffers of
+    // slot, then executes those from primary. The primary must be inside a render pass begun with
+    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. The previous recording of the slot must no longer be in use.
+    bool record(uint32_t slot,
+                VkCommandBuffer primary,
+                const VkCommandBufferInheritanceInfo& inheritanceInfo,
+                VkCommandBufferUsageFlags usage,
+                uint32_t drawCount,
+                const RecordFunction& recordDraws);
+
+    uint32_t taskCount() const
+    {
+        return m_taskCount;
+    }
+
+private:
+    struct Slot
+    {
+        std::vector<VkCommandPool> commandPools;
+        std::vector<VkCommandBuffer> commandBuffers;
+    };
+
+    bool createSlot(Slot& slot);
+
+    VkDevice m_device;
+    uint32_t m_queueFamilyIndex;
+    VkCommandPoolCreateFlags m_commandPoolFlags;
+    WorkerPool* m_workerPool;
+    uint32_t m_taskCount;
+    std::vector<Slot> m_slots;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef CPUPROFILER_H
+#define CPUPROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Collects timed CPU zones from any number of threads and exports them as a Chrome trace (chrome://tracing,
+// ui.perfetto.dev). Recording is lock free: every thread appends to its own fixed size buffer, only the first
+// zone of a thread takes a lock to register the buffer. Zone names have to be string literals.
+class CpuProfiler
+{
+public:
+    static const uint32_t kEventsPerThread = 1u << 18;
+
+    static CpuProfiler& instance();
+
+    void setThreadName(const char* name);
+    void addZone(const char* name,
+                 std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end);
+
+    // Call while no thread records zones, e.g. after the worker threads have been joined.
+    bool writeChromeTrace(const std::string& filePath) const;
+    uint64_t droppedEventCount() const;
+
+private:
+    struct Event
+    {
+        const char* name;
+        int64_t startNs;
+        int64_t durationNs;
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t threadId = 0;
+        const char* threadName = nullptr;
+        std::unique_ptr<Event[]> events;
+        // Written by the owning thread only, released so an exporting thread sees complete events.
+        std::atomic<uint32_t> eventCount{0};
+        std::atomic<uint64_t> droppedCount{0};
+    };
+
+    CpuProfiler();
+    ThreadBuffer& threadBuffer();
+
+    std::chrono::steady_clock::time_point m_epoch;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threadBuffers;
+    mutable std::mutex m_mutex;
+};
+
+// Adds a zone spanning the lifetime of the object.
+class CpuProfileZone
+{
+public:
+    explicit CpuProfileZone(const char* name) : m_name(name), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~CpuProfileZone()
+    {
+        CpuProfiler::instance().addZone(m_name, m_start, std::chrono::steady_clock::now());
+    }
+
+    CpuProfileZone(const CpuProfileZone&) = delete;
+    CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+    const char* m_name;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Instrumentation only exists in builds configured with VK_TRIANGLE_CPU_PROFILER, otherwise it compiles to nothing.
+#ifdef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_CONCAT_IMPL(a, b) a##b
+#define CPU_PROFILER_CONCAT(a, b) CPU_PROFILER_CONCAT_IMPL(a, b)
+#define PROFILE_ZONE(name) CpuProfileZone CPU_PROFILER_CONCAT(cpuProfileZone, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#define PROFILE_THREAD_NAME(name) CpuProfiler::instance().setThreadName(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD_NAME(name)
+#endif
+
+#endif
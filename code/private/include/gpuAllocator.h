@@ -0,0 +1,120 @@
+#ifndef GPUALLOCATOR_H
+#define GPUALLOCATOR_H
+
+#include "tlsfAllocator.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Buffers and linear images vs. optimally tiled images, the two may not share a bufferImageGranularity page.
+enum class GpuResourceKind
+{
+    Linear,
+    Optimal
+};
+
+struct GpuAllocation
+{
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Persistently mapped address of the allocation, nullptr unless the memory is host visible.
+    void* mapped = nullptr;
+    uint32_t pool = 0;
+    uint32_t block = 0;
+    uint32_t handle = TlsfAllocator::kInvalidHandle;
+    bool dedicated = false;
+};
+
+struct GpuAllocatorStats
+{
+    uint64_t deviceMemoryCount = 0;
+    uint64_t reservedSize = 0;
+    uint64_t usedSize = 0;
+    uint64_t allocationCount = 0;
+    uint64_t freeRangeCount = 0;
+    uint64_t largestFreeRange = 0;
+
+    double utilization() const
+    {
+        return reservedSize > 0 ? static_cast<double>(usedSize) / static_cast<double>(reservedSize) : 0.0;
+    }
+
+    // 0 when all free memory is one contiguous range, approaching 1 as free memory splinters.
+    double fragmentation() const
+    {
+        const uint64_t freeSize = reservedSize - usedSize;
+        return freeSize > 0 ? 1.0 - static_cast<double>(largestFreeRange) / static_cast<double>(freeSize) : 0.0;
+    }
+};
+
+// Allocates large VkDeviceMemory blocks per memory type and sub-allocates resources from them with a TLSF
+// allocator. Requests larger than half a block get a dedicated allocation. Host visible blocks stay mapped for
+// their whole lifetime. All methods are thread safe.
+class GpuMemoryAllocator
+{
+public:
+    static const VkDeviceSize kDefaultBlockSize = 64ull * 1024 * 1024;
+
+    GpuMemoryAllocator();
+
+    bool init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = kDefaultBlockSize);
+    void destroy();
+
+    bool allocate(const VkMemoryRequirements& requirements,
+                  VkMemoryPropertyFlags properties,
+                  GpuResourceKind kind,
+                  GpuAllocation& allocation);
+    void free(GpuAllocation& allocation);
+
+    bool createBuffer(VkDeviceSize size,
+                      VkBufferUsageFlags usage,
+                      VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer,
+                      GpuAllocation& allocation);
+    void destroyBuffer(VkBuffer& buffer, GpuAllocation& allocation);
+
+    bool createImage(const VkImageCreateInfo& imageInfo,
+                     VkMemoryPropertyFlags properties,
+                     VkImage& image,
+                     GpuAllocation& allocation);
+    void destroyImage(VkImage& image, GpuAllocation& allocation);
+
+    GpuAllocatorStats stats() const;
+    void logStats() const;
+
+private:
+    struct Block
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        char* mapped = nullptr;
+        std::unique_ptr<TlsfAllocator> allocator;
+    };
+
+    struct Pool
+    {
+        uint32_t memoryType = 0;
+        std::vector<Block> blocks;
+    };
+
+    bool allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, VkDeviceMemory& memory, char*& mapped);
+    void freeDeviceMemory(VkDeviceMemory memory, char* mapped);
+    uint32_t poolIndex(uint32_t memoryType, GpuResourceKind kind) const;
+
+    VkPhysicalDevice m_physicalDevice;
+    VkDevice m_device;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    VkDeviceSize m_blockSize;
+    VkDeviceSize m_bufferImageGranularity;
+    uint32_t m_maxAllocationCount;
+    uint64_t m_deviceMemoryCount;
+    uint64_t m_dedicatedSize;
+    uint64_t m_dedicatedCount;
+    std::vector<Pool> m_pools;
+    mutable std::mutex m_mutex;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef GPUCULLER_H
+#define GPUCULLER_H
+
+#include "gpuAllocator.h"
+#include "pipelineLayoutCache.h"
+#include "shaderRegistry.h"
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+// What the culling dispatch of one frame draws: draw d covers instances [d * instancesPerDraw, (d + 1) *
+// instancesPerDraw) clamped to instanceCount and belongs to group d % groupCount.
+struct CullDispatch
+{
+    glm::mat4 viewProjection;
+    uint32_t groupCount;
+    uint32_t instancesPerDraw;
+    uint32_t instanceCount;
+    uint32_t indexCount;
+};
+
+// Frustum culls draws on the GPU. A compute pass tests the bounding sphere of every draw against the view frustum
+// and appends the visible ones as VkDrawIndexedIndirectCommand to the region of their group, which the graphics pass
+// then issues with a single indirect draw. With VK_KHR_draw_indirect_count the GPU written count bounds the draw,
+// otherwise the region is cleared up front and the unused commands draw no instances. Every frame slot owns its
+// commands and counts, like the uniform ring slices.
+class GpuCuller
+{
+public:
+    GpuCuller();
+
+    // boundsBuffer() has to be filled with drawCount spheres, center in xyz and radius in w, before the first
+    // dispatch. drawIndirectCount requires VK_KHR_draw_indirect_count to be enabled, the device has to support the
+    // features of gpuCullingSupported() either way. Every dispatch uses at most maxGroupCount groups.
+    bool init(GpuMemoryAllocator& allocator,
+              VkDevice device,
+              PipelineLayoutCache& layoutCache,
+              VkPipelineCache pipelineCache,
+              const ShaderBinary& shader,
+              uint32_t drawCount,
+              uint32_t maxGroupCount,
+              uint32_t slotCount,
+              bool drawIndirectCount);
+    void destroy();
+
+    // Replaces the commands and counts with ones for slotCount slots, their contents are lost. No submission may
+    // use the culler meanwhile.
+    bool resizeSlots(uint32_t slotCount);
+
+    VkBuffer boundsBuffer() const
+    {
+        return m_boundsBuffer;
+    }
+
+    // Records the culling of slot's commands, outside of a render pass. The slot must not be read by a pending
+    // submission.
+    void recordCulling(VkCommandBuffer commandBuffer, uint32_t slot, const CullDispatch& dispatch) const;
+
+    // Records the indirect draw of group within the render pass, the graphics pipeline and its state are bound.
+    void recordDraw(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t groupCount, uint32_t group) const;
+
+    bool drawCountSupported() const
+    {
+        return m_drawIndexedIndirectCount != nullptr;
+    }
+
+private:
+    bool createSlotBuffers(uint32_t slotCount);
+    void writeDescriptorSet();
+
+    // Most draws a group holds, the groups split the draws round robin.
+    uint32_t groupCapacity(uint32_t groupCount) const
+    {
+        return (m_drawCount + groupCount - 1) / groupCount;
+    }
+
+    GpuMemoryAllocator* m_allocator;
+    VkDevice m_device;
+    uint32_t m_drawCount;
+    uint32_t m_maxGroupCount;
+    // Commands per slot, enough for groupCapacity() of every group count up to m_maxGroupCount.
+    uint32_t m_slotCommandCount;
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount;
+    VkBuffer m_boundsBuffer;
+    GpuAllocation m_boundsAllocation;
+    VkBuffer m_commandBuffer;
+    GpuAllocation m_commandAllocation;
+    VkBuffer m_countBuffer;
+    GpuAllocation m_countAllocation;
+    // Owned by the layout cache.
+    VkPipelineLayout m_pipelineLayout;
+    VkPipeline m_pipeline;
+    VkDescriptorPool m_descriptorPool;
+    VkDescriptorSet m_descriptorSet;
+};
+
+// Whether physicalDevice has multiDrawIndirect and drawIndirectFirstInstance, which have to be enabled for culling.
+bool gpuCullingSupported(VkPhysicalDevice physicalDevice);
+bool drawIndirectCountSupported(VkPhysicalDevice physicalDevice);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include "rollingStatistics.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Measures named scopes of GPU work with timestamp queries. The query pool is split into ranges, every command
+// buffer that records scopes owns one range. Results are read back without waiting: a range is only collected
+// once the submission that used it is known to be complete.
+class GpuProfiler
+{
+public:
+    static const uint32_t kInvalidScope = 0xffffffffu;
+
+    GpuProfiler();
+
+    // Returns false and stays disabled when the queue family does not support timestamps.
+    bool init(VkPhysicalDevice physicalDevice,
+              VkDevice device,
+              uint32_t queueFamilyIndex,
+              uint32_t rangeCount,
+              uint32_t maxScopesPerRange = 16);
+    void destroy();
+
+    bool enabled() const
+    {
+        return m_queryPool != VK_NULL_HANDLE;
+    }
+
+    // Resets the queries of range, has to be recorded outside of a render pass before any scope of the range.
+    void beginRange(VkCommandBuffer commandBuffer, uint32_t range);
+    uint32_t beginScope(VkCommandBuffer commandBuffer, uint32_t range, const char* name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t range, uint32_t scope);
+
+    // Call once the queue submission with the command buffer of range was made.
+    void submitted(uint32_t range);
+    // Accumulates the results of the last submission of range. The caller guarantees it has completed, e.g. by
+    // having waited on its fence. Ranges without a pending submission are ignored.
+    void collect(uint32_t range);
+    // Collects every range, only valid once the device is idle.
+    void collectAll();
+
+    void logStatistics() const;
+    bool writeJson(const std::string& filePath) const;
+
+private:
+    struct Scope
+    {
+        std::string name;
+        uint32_t query;
+    };
+
+    struct Range
+    {
+        std::vector<Scope> scopes;
+        bool pending = false;
+    };
+
+    VkDevice m_device;
+    VkQueryPool m_queryPool;
+    double m_timestampPeriod;
+    uint64_t m_timestampMask;
+    uint32_t m_queriesPerRange;
+    std::vector<Range> m_ranges;
+    std::map<std::string, RollingStatistics> m_statistics;
+    // Scopes may be recorded from several threads.
+    mutable std::mutex m_mutex;
+};
+
+// Writes a GPU scope around the lifetime of the object.
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(GpuProfiler& profiler, VkCommandBuffer commandBuffer, uint32_t range, const char* name)
+        : m_profiler(profiler),
+          m_commandBuffer(commandBuffer),
+          m_range(range),
+          m_scope(profiler.beginScope(commandBuffer, range, name))
+    {
+    }
+
+    ~GpuProfileScope()
+    {
+        m_profiler.endScope(m_commandBuffer, m_range, m_scope);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    GpuProfiler& m_profiler;
+    VkCommandBuffer m_commandBuffer;
+    uint32_t m_range;
+    uint32_t m_scope;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <string>
+
+// Maps a file read-only into memory. Pages are loaded on first access instead of being copied up front, the
+// mapped bytes can be handed to consumers such as the StagingUploader without an intermediate copy.
+class MappedFile
+{
+public:
+    enum class AccessHint
+    {
+        Normal,
+        // Read front to back, the OS may read ahead aggressively and drop pages behind the reader.
+        Sequential,
+        Random
+    };
+
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filePath, AccessHint accessHint = AccessHint::Normal);
+    void close();
+
+    bool isOpen() const
+    {
+        return m_isOpen;
+    }
+
+    // Page aligned start of the file content, nullptr for empty files.
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    uint64_t size() const
+    {
+        return m_size;
+    }
+
+    // Points span at [offset, offset + size) of the file. Fails when the range is out of bounds or its start
+    // is not a multiple of alignment, which has to be a power of two.
+    bool span(uint64_t offset, uint64_t size, uint64_t alignment, const char*& span) const;
+
+    // Asks the OS to start reading [offset, offset + size) in the background, e.g. ahead of an upload.
+    void prefetch(uint64_t offset, uint64_t size) const;
+
+private:
+    char* m_data;
+    uint64_t m_size;
+    bool m_isOpen;
+#ifdef _WIN32
+    void* m_fileHandle;
+    void* m_mappingHandle;
+#endif
+};
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "gpuAllocator.h"
+#include "vertexLayout.h"
+
+#include <cstddef>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+struct Vertex
+{
+    glm::vec2 position;
+    glm::vec3 color;
+
+    static VertexLayout layout()
+    {
+        VertexLayout vertexLayout;
+        vertexLayout.addBinding(sizeof(Vertex), VK_VERTEX_INPUT_RATE_VERTEX)
+            .addAttribute(0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, position))
+            .addAttribute(1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color));
+        return vertexLayout;
+    }
+};
+
+// Per instance transform and color, fetched from a second vertex buffer binding at instance rate.
+struct InstanceData
+{
+    glm::vec2 offset;
+    float scale;
+    float padding;
+    glm::vec4 color;
+
+    static void appendLayout(VertexLayout& vertexLayout)
+    {
+        vertexLayout.addBinding(sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE)
+            .addAttribute(2, VK_FORMAT_R32G32_SFLOAT, offsetof(InstanceData, offset))
+            .addAttribute(3, VK_FORMAT_R32_SFLOAT, offsetof(InstanceData, scale))
+            .addAttribute(4, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, color));
+    }
+};
+
+struct MeshData
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+// Geometry living in device local vertex and index buffers.
+struct GpuMesh
+{
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    GpuAllocation vertexAllocation;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    GpuAllocation indexAllocation;
+    uint32_t indexCount = 0;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef PIPELINEBUILDSERVICE_H
+#define PIPELINEBUILDSERVICE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class WorkerPool;
+
+// Compiles pipelines on worker threads while the render loop keeps going. vkCreateGraphicsPipelines may be called
+// concurrently as long as every call has its own create info; all builds should go through one shared
+// VkPipelineCache so they benefit from each other's work.
+class PipelineBuildService
+{
+public:
+    // Creates one pipeline and returns it, VK_NULL_HANDLE on failure. Runs on a worker thread.
+    using BuildFunction = std::function<VkPipeline()>;
+
+    PipelineBuildService();
+    ~PipelineBuildService();
+
+    PipelineBuildService(const PipelineBuildService&) = delete;
+    PipelineBuildService& operator=(const PipelineBuildService&) = delete;
+
+    // A thread count of 0 starts one build thread per hardware thread.
+    void init(VkDevice device, uint32_t threadCount = 0);
+    // Skips the builds that have not started yet, waits for the running ones and destroys every pipeline.
+    void destroy();
+
+    // Queues a build and returns the index its pipeline is looked up with.
+    uint32_t enqueue(BuildFunction build);
+
+    // The pipeline of index, VK_NULL_HANDLE while it is still being built or when its build failed.
+    VkPipeline pipeline(uint32_t index) const;
+
+    uint32_t pipelineCount() const;
+    // Builds that have finished, successfully or not.
+    uint32_t finishedCount() const;
+    bool finished() const
+    {
+        return finishedCount() == pipelineCount();
+    }
+
+    // From the enqueue that started an idle service until its last build finished, zero while builds are running.
+    std::chrono::steady_clock::duration buildTime() const;
+
+    // Blocks until every queued build has finished.
+    void waitAll();
+
+private:
+    void run(uint32_t index, const BuildFunction& build);
+
+    VkDevice m_device;
+    std::unique_ptr<WorkerPool> m_workerPool;
+    uint32_t m_threadCount;
+    std::vector<VkPipeline> m_pipelines;
+    uint32_t m_finishedCount;
+    std::atomic<bool> m_cancelled;
+    std::chrono::steady_clock::time_point m_firstEnqueue;
+    std::chrono::steady_clock::duration m_buildTime;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_buildFinished;
+};
+
+#endif
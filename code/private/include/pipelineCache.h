@@ -0,0 +1,47 @@
+#ifndef PIPELINECACHE_H
+#define PIPELINECACHE_H
+
+#include "mappedFile.h"
+
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// VkPipelineCache that is seeded from and written back to a file on disk. The file is keyed on the vendor id,
+// device id and pipeline cache UUID of the physical device, blobs from another device or driver version, as well
+// as truncated or corrupt files, are discarded and the cache starts out empty.
+class PersistentPipelineCache
+{
+public:
+    PersistentPipelineCache();
+
+    bool create(VkDevice device, const VkPhysicalDeviceProperties& deviceProperties, const std::string& filePath);
+    bool save() const;
+    void destroy();
+
+    VkPipelineCache handle() const
+    {
+        return m_pipelineCache;
+    }
+
+    size_t loadedSize() const
+    {
+        return m_loadedSize;
+    }
+
+private:
+    // Maps the cache file and points blob at the driver data inside it.
+    bool loadBlob(MappedFile& file, const char*& blob, size_t& blobSize) const;
+    bool isBlobCompatible(const char* fileContent, size_t fileSize) const;
+
+    VkDevice m_device;
+    VkPipelineCache m_pipelineCache;
+    std::string m_filePath;
+    uint32_t m_vendorID;
+    uint32_t m_deviceID;
+    uint8_t m_pipelineCacheUUID[VK_UUID_SIZE];
+    size_t m_loadedSize;
+};
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PIPELINELAYOUTCACHE_H
+#define PIPELINELAYOUTCACHE_H
+
+#include "spirvReflection.h"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class VertexLayout;
+
+// Creates descriptor set layouts and pipeline layouts from the reflected interfaces of a pipeline's shader stages.
+// Identical layouts are created once and shared, pipelines using the same resources therefore stay layout
+// compatible and keep their bound descriptor sets when switching between them. All methods are thread safe.
+class PipelineLayoutCache
+{
+public:
+    PipelineLayoutCache();
+
+    // With dynamicUniformBuffers the uniform buffers the shaders declare are laid out as
+    // VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, SPIR-V cannot tell the two apart.
+    void init(VkDevice device, bool dynamicUniformBuffers = false);
+    // Destroys every layout handed out.
+    void destroy();
+
+    // Merges the descriptor bindings and push constant ranges of stages, which must agree where they overlap, and
+    // returns the matching pipeline layout. setLayouts receives the descriptor set layout of every set when given.
+    bool pipelineLayout(const std::vector<const ShaderReflection*>& stages,
+                        VkPipelineLayout& layout,
+                        std::vector<VkDescriptorSetLayout>* setLayouts = nullptr);
+
+private:
+    struct WordsHash
+    {
+        size_t operator()(const std::vector<uint32_t>& words) const;
+    };
+
+    struct CachedPipelineLayout
+    {
+        VkPipelineLayout layout;
+        std::vector<uint32_t> setLayoutIndices;
+    };
+
+    // Callers hold m_mutex.
+    bool descriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t& index);
+
+    VkDevice m_device;
+    bool m_dynamicUniformBuffers;
+    std::vector<VkDescriptorSetLayout> m_setLayouts;
+    std::unordered_map<std::vector<uint32_t>, uint32_t, WordsHash> m_setLayoutIndices;
+    std::unordered_map<std::vector<uint32_t>, CachedPipelineLayout, WordsHash> m_pipelineLayouts;
+    std::mutex m_mutex;
+};
+
+VkShaderStageFlagBits shaderStageFlag(ShaderExecutionModel executionModel);
+VkDescriptorType descriptorType(DescriptorKind kind);
+// The format a vertex attribute has to have to feed input, VK_FORMAT_UNDEFINED if there is none.
+VkFormat vertexInputFormat(const ReflectedVertexInput& input);
+
+// Checks that vertexLayout provides every input the vertex shader reads with a matching format. Buffer strides and
+// offsets come from the C++ vertex structs, the shader only dictates locations and formats.
+bool validateVertexLayout(const ShaderReflection& vertexShader, const VertexLayout& vertexLayout);
+
+#endif
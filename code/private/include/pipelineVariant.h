@@ -0,0 +1,64 @@
+#ifndef PIPELINEVARIANT_H
+#define PIPELINEVARIANT_H
+
+#include <cstddef>
+#include <cstdint>
+
+enum class BlendMode : uint32_t
+{
+    Opaque,
+    Alpha,
+    Additive
+};
+
+// Everything two graphics pipelines built from the same shaders differ in. Specialization constant i is passed as
+// constant_id i to every stage; drivers fold them like literals, so branches and loop bounds depending on them cost
+// nothing at runtime and one SPIR-V binary serves all variants.
+struct PipelineVariantKey
+{
+    static const uint32_t kMaxSpecializationConstants = 4;
+
+    uint32_t specializationConstants[kMaxSpecializationConstants] = {};
+    BlendMode blendMode = BlendMode::Opaque;
+};
+
+inline bool operator==(const PipelineVariantKey& lhs, const PipelineVariantKey& rhs)
+{
+    for (uint32_t i = 0; i < PipelineVariantKey::kMaxSpecializationConstants; ++i)
+    {
+        if (lhs.specializationConstants[i] != rhs.specializationConstants[i])
+        {
+            return false;
+        }
+    }
+    return lhs.blendMode == rhs.blendMode;
+}
+
+inline bool operator!=(const PipelineVariantKey& lhs, const PipelineVariantKey& rhs)
+{
+    return !(lhs == rhs);
+}
+
+// FNV-1a over the fields, for keying std::unordered_map.
+struct PipelineVariantKeyHash
+{
+    size_t operator()(const PipelineVariantKey& key) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        const auto combine = [&hash](uint32_t value) {
+            for (uint32_t byte = 0; byte < 4; ++byte)
+            {
+                hash ^= (value >> (byte * 8)) & 0xffu;
+                hash *= 1099511628211ull;
+            }
+        };
+        for (uint32_t constant : key.specializationConstants)
+        {
+            combine(constant);
+        }
+        combine(static_cast<uint32_t>(key.blendMode));
+        return static_cast<size_t>(hash);
+    }
+};
+
+#endif
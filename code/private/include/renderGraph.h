@@ -0,0 +1,241 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// How a pass accesses an image. Each usage implies the layout, pipeline stages and access flags of the access.
+enum class ImageUsage
+{
+    ColorAttachment,
+    DepthStencilAttachment,
+    FragmentSampled,
+    ComputeSampled,
+    // Read and written by compute shaders.
+    ComputeStorage,
+    TransferSrc,
+    TransferDst
+};
+
+// What an attachment starts with. Clear and DontCare overwrite the image, only Load reads the previous contents.
+enum class AttachmentLoad
+{
+    Clear,
+    Load,
+    DontCare
+};
+
+// The state an imported image is in when the graph starts or has to be left in when it ends.
+struct ImageState
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+};
+
+// An image owned by the graph, it only lives between its first and last use within the frame.
+struct TransientImageDesc
+{
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+};
+
+struct MemoryFootprint
+{
+    VkDeviceSize size;
+    VkDeviceSize alignment;
+};
+
+struct GraphImageBarrier
+{
+    uint32_t resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+};
+
+// All barriers needed before a pass, recorded with a single vkCmdPipelineBarrier.
+struct BarrierBatch
+{
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    std::vector<GraphImageBarrier> imageBarriers;
+
+    bool empty() const
+    {
+        return imageBarriers.empty();
+    }
+};
+
+// An attachment of a graphics pass in declaration order, as the pass' render pass has to describe it.
+struct GraphAttachment
+{
+    uint32_t resource;
+    VkImageLayout layout;
+    VkAttachmentLoadOp loadOp;
+    VkAttachmentStoreOp storeOp;
+};
+
+// Declares a frame as passes reading and writing images and compiles the declaration into an execution order.
+// Passes contributing to neither an imported image nor a side effect are culled. Barriers and layout transitions
+// are derived from the declared usages, merged into one batch per pass and skipped between reads. Transient images
+// whose lifetimes do not overlap share memory. Compiling only needs the Vulkan headers, recording is left to the
+// RenderGraphExecutor.
+class RenderGraph
+{
+public:
+    using FootprintFunction = std::function<MemoryFootprint(uint32_t resource)>;
+
+    RenderGraph();
+
+    // An image created outside the graph, e.g. a swapchain image. initialState describes the last access before the
+    // graph, a semaphore wait for example, finalState the access following it.
+    uint32_t importImage(const std::string& name,
+                         VkFormat format,
+                         const ImageState& initialState,
+                         const ImageState& finalState);
+    uint32_t createImage(const std::string& name, const TransientImageDesc& desc);
+
+    // Passes execute in declaration order. A pass with side effects is never culled.
+    uint32_t addPass(const std::string& name, bool sideEffects = false);
+    // Declares one use of resource by pass, a pass may use each resource only once. load only applies to attachments.
+    void useImage(uint32_t pass, uint32_t resource, ImageUsage usage, AttachmentLoad load = AttachmentLoad::Load);
+
+    // Forgets all resources and passes.
+    void clear();
+
+    // Culls, orders, places transient images and derives the barriers. footprint is asked for the memory
+    // requirements of every transient image used by a remaining pass. Returns false for an invalid declaration.
+    bool compile(const FootprintFunction& footprint);
+
+    // The passes left after culling, in execution order.
+    const std::vector<uint32_t>& passOrder() const
+    {
+        return m_passOrder;
+    }
+
+    // The barriers before the passOrder()[orderIndex] pass.
+    const BarrierBatch& barriersBefore(uint32_t orderIndex) const
+    {
+        return m_batches[orderIndex];
+    }
+
+    // The transitions of imported images into their final state, after the last pass.
+    const BarrierBatch& finalBarriers() const
+    {
+        return m_batches.back();
+    }
+
+    uint32_t passCount() const
+    {
+        return static_cast<uint32_t>(m_passes.size());
+    }
+    const std::string& passName(uint32_t pass) const
+    {
+        return m_passes[pass].name;
+    }
+    // The color and depth attachments of a remaining pass.
+    const std::vector<GraphAttachment>& attachments(uint32_t pass) const
+    {
+        return m_passes[pass].attachments;
+    }
+
+    uint32_t resourceCount() const
+    {
+        return static_cast<uint32_t>(m_resources.size());
+    }
+    const std::string& resourceName(uint32_t resource) const
+    {
+        return m_resources[resource].name;
+    }
+    VkFormat resourceFormat(uint32_t resource) const
+    {
+        return m_resources[resource].format;
+    }
+    bool transient(uint32_t resource) const
+    {
+        return m_resources[resource].transient;
+    }
+    const TransientImageDesc& transientDesc(uint32_t resource) const
+    {
+        return m_resources[resource].desc;
+    }
+    // Whether a remaining pass uses the resource.
+    bool resourceUsed(uint32_t resource) const
+    {
+        return m_resources[resource].firstUse <= m_resources[resource].lastUse;
+    }
+    // All usages of the resource, transient images have to be created with it.
+    VkImageUsageFlags imageUsageFlags(uint32_t resource) const
+    {
+        return m_resources[resource].usageFlags;
+    }
+    // Offset of a used transient image within the shared transient memory.
+    VkDeviceSize memoryOffset(uint32_t resource) const
+    {
+        return m_resources[resource].memoryOffset;
+    }
+    // Memory needed by all used transient images with and without aliasing.
+    VkDeviceSize transientMemorySize() const
+    {
+        return m_transientMemorySize;
+    }
+    VkDeviceSize unaliasedMemorySize() const
+    {
+        return m_unaliasedMemorySize;
+    }
+
+private:
+    struct Use
+    {
+        uint32_t resource;
+        ImageUsage usage;
+        AttachmentLoad load;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        bool sideEffects;
+        bool culled;
+        std::vector<Use> uses;
+        std::vector<GraphAttachment> attachments;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        VkFormat format;
+        bool transient;
+        TransientImageDesc desc;
+        ImageState initialState;
+        ImageState finalState;
+        VkImageUsageFlags usageFlags;
+        // Lifetime in execution order indices, firstUse > lastUse while unused.
+        uint32_t firstUse;
+        uint32_t lastUse;
+        MemoryFootprint footprint;
+        VkDeviceSize memoryOffset;
+    };
+
+    void cullPasses();
+    void placeTransientImages();
+    void deriveBarriers();
+    void deriveAttachments();
+
+    std::vector<Pass> m_passes;
+    std::vector<Resource> m_resources;
+    std::vector<uint32_t> m_passOrder;
+    // One batch per pass in m_passOrder followed by the final transitions.
+    std::vector<BarrierBatch> m_batches;
+    VkDeviceSize m_transientMemorySize;
+    VkDeviceSize m_unaliasedMemorySize;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef RENDERGRAPHEXECUTOR_H
+#define RENDERGRAPHEXECUTOR_H
+
+#include "gpuAllocator.h"
+#include "renderGraph.h"
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Creates the Vulkan objects of a RenderGraph and records its barriers. Every graphics pass gets a render pass
+// keeping its attachments in their attachment layouts, the graph's barriers transition them outside of it. Every
+// frame slot has its own transient images, bound to its own region of one allocation at the offsets the graph placed
+// them at. The graph only orders the aliasing within a frame, frames in flight never share transient memory.
+class RenderGraphExecutor
+{
+public:
+    RenderGraphExecutor();
+
+    void init(VkDevice device, GpuMemoryAllocator& allocator);
+
+    // Compiles graph and creates its objects for slotCount frame slots, destroying the objects of the previous build
+    // first. The graph has to outlive the build.
+    bool build(RenderGraph& graph, uint32_t slotCount);
+    // Replaces the transient images with ones for slotCount frame slots, the render passes stay. Requires the device
+    // to be done with the old images.
+    bool resizeSlots(uint32_t slotCount);
+    // Requires the device to be done with the objects of the build.
+    void destroy();
+
+    uint32_t slotCount() const
+    {
+        return m_slotCount;
+    }
+
+    // VK_NULL_HANDLE for passes without attachments or culled passes.
+    VkRenderPass renderPass(uint32_t pass) const
+    {
+        return m_renderPasses[pass];
+    }
+    VkImageView transientImageView(uint32_t slot, uint32_t resource) const
+    {
+        return m_imageViews[slot * m_graph->resourceCount() + resource];
+    }
+
+    // Records batch as one pipeline barrier for the frame of slot. The images of imported resources are taken from
+    // importedImages, indexed by resource. Uses scratch memory of the executor, so only one thread may record at a
+    // time.
+    void recordBarriers(VkCommandBuffer commandBuffer,
+                        uint32_t slot,
+                        const BarrierBatch& batch,
+                        const std::vector<VkImage>& importedImages);
+
+private:
+    // Creates the images of every slot that compiling did not create yet and binds them to a new allocation.
+    bool createTransientImages();
+    void destroyTransientImages();
+    bool createTransientImage(uint32_t slot, uint32_t resource, MemoryFootprint& footprint);
+    bool createRenderPass(uint32_t pass);
+
+    VkDevice m_device;
+    GpuMemoryAllocator* m_allocator;
+    const RenderGraph* m_graph;
+    uint32_t m_slotCount;
+    std::vector<VkRenderPass> m_renderPasses;
+    // Transient images and their views indexed by slot * resourceCount() + resource, VK_NULL_HANDLE for imported or
+    // unused resources.
+    std::vector<VkImage> m_images;
+    std::vector<VkImageView> m_imageViews;
+    uint32_t m_memoryTypeBits;
+    GpuAllocation m_transientMemory;
+    std::vector<VkImageMemoryBarrier> m_scratchBarriers;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef ROLLINGSTATISTICS_H
+#define ROLLINGSTATISTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Keeps the most recent samples of a measurement in a ring buffer and computes order statistics over them.
+class RollingStatistics
+{
+public:
+    explicit RollingStatistics(size_t capacity = 1024)
+        : m_capacity(std::max<size_t>(capacity, 1)), m_next(0), m_count(0)
+    {
+        m_samples.reserve(m_capacity);
+    }
+
+    void add(double sample)
+    {
+        if (m_samples.size() < m_capacity)
+        {
+            m_samples.push_back(sample);
+        }
+        else
+        {
+            m_samples[m_next] = sample;
+        }
+        m_next = (m_next + 1) % m_capacity;
+        ++m_count;
+    }
+
+    // Number of samples ever added, the statistics only cover the last capacity of them.
+    uint64_t count() const
+    {
+        return m_count;
+    }
+
+    bool empty() const
+    {
+        return m_samples.empty();
+    }
+
+    double min() const
+    {
+        return empty() ? 0.0 : *std::min_element(m_samples.begin(), m_samples.end());
+    }
+
+    double max() const
+    {
+        return empty() ? 0.0 : *std::max_element(m_samples.begin(), m_samples.end());
+    }
+
+    double average() const
+    {
+        double sum = 0.0;
+        for (double sample : m_samples)
+        {
+            sum += sample;
+        }
+        return empty() ? 0.0 : sum / static_cast<double>(m_samples.size());
+    }
+
+    // Nearest rank percentile, percent in [0, 100].
+    double percentile(double percent) const
+    {
+        if (empty())
+        {
+            return 0.0;
+        }
+        std::vector<double> sorted(m_samples);
+        const size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(sorted.size())));
+        const size_t index = std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+private:
+    size_t m_capacity;
+    size_t m_next;
+    uint64_t m_count;
+    std::vector<double> m_samples;
+};
+
+#endif
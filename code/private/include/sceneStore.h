@@ -0,0 +1,167 @@
+#ifndef SCENESTORE_H
+#define SCENESTORE_H
+
+#include "transformBatch.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Stays valid while the entity lives, a destroyed entity's handle never refers to a later entity.
+struct Entity
+{
+    static const uint32_t kInvalidSlot = 0xffffffffu;
+
+    uint32_t slot = kInvalidSlot;
+    uint32_t generation = 0;
+};
+
+// Indices of a mesh in the shared vertex and index buffers.
+struct MeshRange
+{
+    uint32_t indexCount = 0;
+    uint32_t firstIndex = 0;
+    int32_t vertexOffset = 0;
+};
+
+// Layout of VkDrawIndexedIndirectCommand, so draws can be copied into an indirect buffer as they are.
+struct DrawIndexedIndirect
+{
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t vertexOffset;
+    uint32_t firstInstance;
+};
+
+struct EntityDesc
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    float scale = 1.0f;
+    // Center in xyz and radius in w, in object space.
+    glm::vec4 localSphere = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    // Returned by SceneStore::addMesh().
+    uint32_t mesh = 0;
+    // Any value the renderer maps to a pipeline, entities of the same material share their draws.
+    uint32_t material = 0;
+};
+
+// The visible entities of a frame, ready for upload. Every command draws the entities of one mesh and material as
+// instances, firstInstance indexes instances.
+struct SceneDraws
+{
+    std::vector<glm::mat4> instances;
+    std::vector<DrawIndexedIndirect> commands;
+    // Material of every command, to bind its pipeline.
+    std::vector<uint32_t> commandMaterials;
+};
+
+// Entities with dense component arrays: transform and bounds in a TransformBatch, mesh and material handles in
+// arrays of the same order. Handles go through a slot table to the dense index, so create and destroy are O(1):
+// destroy moves the last entity into the hole and patches its slot. Iterating the components is a linear scan over
+// contiguous memory, whatever the order entities were created and destroyed in.
+class SceneStore
+{
+public:
+    explicit SceneStore(SimdLevel level = detectSimdLevel());
+
+    uint32_t addMesh(const MeshRange& range);
+
+    // Returns an entity that is not alive when desc.mesh was not returned by addMesh().
+    Entity create(const EntityDesc& desc);
+    // Returns false for a handle that is not alive.
+    bool destroy(Entity entity);
+    bool alive(Entity entity) const;
+    void reserve(uint32_t capacity);
+    void clear();
+
+    uint32_t size() const
+    {
+        return static_cast<uint32_t>(m_denseSlots.size());
+    }
+
+    // Dense index of a live entity, valid until the next destroy().
+    uint32_t denseIndex(Entity entity) const
+    {
+        return m_slots[entity.slot].denseIndex;
+    }
+    Entity entityAt(uint32_t denseIndex) const
+    {
+        const uint32_t slot = m_denseSlots[denseIndex];
+        return Entity{slot, m_slots[slot].generation};
+    }
+
+    // The setters return false for a handle that is not alive.
+    bool setTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, float scale);
+    // Also returns false and keeps the mesh when mesh was not returned by addMesh().
+    bool setMesh(Entity entity, uint32_t mesh);
+    bool setMaterial(Entity entity, uint32_t material);
+
+    // Dense component arrays, indexed by denseIndex().
+    const TransformBatch& transforms() const
+    {
+        return m_transforms;
+    }
+    const std::vector<uint32_t>& meshes() const
+    {
+        return m_meshes;
+    }
+    const std::vector<uint32_t>& materials() const
+    {
+        return m_materials;
+    }
+
+    // Recomposes the model matrices and world bounds of every entity, see TransformBatch::update().
+    void update();
+
+    // Fills draws with the entities whose bounds intersect planes, one command per mesh and material pair in the
+    // order the pairs first occur. Uses the bounds of the last update(). Linear in the number of entities, the pairs
+    // are looked up in a flat hash table that only grows with the number of distinct pairs.
+    void collectDraws(const glm::vec4 planes[6], SceneDraws& draws);
+
+private:
+    struct Slot
+    {
+        uint32_t denseIndex;
+        // Incremented on destroy, invalidating the handles of the slot.
+        uint32_t generation;
+    };
+
+    // Maps a mesh and material pair to its command in collectDraws().
+    struct CommandEntry
+    {
+        uint64_t key;
+        uint32_t command;
+    };
+
+    static const uint32_t kDeadIndex = 0xffffffffu;
+    // No mesh handle reaches 0xffffffff, so no pair has this key.
+    static const uint64_t kEmptyKey = ~0ull;
+
+    uint32_t findCommand(uint64_t key, uint32_t mesh, uint32_t material, SceneDraws& draws);
+    void growCommandTable();
+
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<MeshRange> m_meshRanges;
+    // Dense components, all in the same order.
+    TransformBatch m_transforms;
+    std::vector<uint32_t> m_meshes;
+    std::vector<uint32_t> m_materials;
+    std::vector<uint32_t> m_denseSlots;
+    // Scratch memory of collectDraws(), reused between calls.
+    std::vector<uint32_t> m_visible;
+    std::vector<uint32_t> m_visibleCommands;
+    std::vector<uint32_t> m_nextInstance;
+    // Open addressing with linear probing, the size is a power of two and kept at least twice the number of
+    // commands.
+    std::vector<CommandEntry> m_commandTable;
+    uint32_t m_commandTableShift;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SHADERHOTRELOADER_H
+#define SHADERHOTRELOADER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches GLSL sources on a background thread (inotify on Linux, modification times elsewhere) and recompiles a
+// shader with glslangValidator whenever its file is written. The SPIR-V is handed to the reload function on the
+// watcher thread, so expensive follow-up work such as building pipelines stays off the render loop as well.
+class ShaderHotReloader
+{
+public:
+    // Receives the file name of the changed shader, e.g. "triangle1.frag", and its freshly compiled SPIR-V.
+    using ReloadFunction = std::function<void(const std::string& name, std::vector<uint32_t>& spirv)>;
+
+    ShaderHotReloader();
+    ~ShaderHotReloader();
+
+    ShaderHotReloader(const ShaderHotReloader&) = delete;
+    ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+    // Starts watching the files of names in sourceDirectory, compilerPath is the glslangValidator to run.
+    bool start(const std::string& sourceDirectory,
+               const std::vector<std::string>& names,
+               const std::string& compilerPath,
+               ReloadFunction reload);
+    void stop();
+
+    bool running() const
+    {
+        return m_thread.joinable();
+    }
+
+private:
+    void watchLoop();
+    void reload(const std::string& name) const;
+    bool compile(const std::string& name, std::vector<uint32_t>& spirv) const;
+
+    std::string m_sourceDirectory;
+    std::vector<std::string> m_names;
+    std::string m_compilerPath;
+    ReloadFunction m_reload;
+    std::thread m_thread;
+    std::atomic<bool> m_stopping;
+    int m_inotifyFd;
+};
+
+#endif
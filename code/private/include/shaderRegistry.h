@@ -0,0 +1,23 @@
+#ifndef SHADERREGISTRY_H
+#define SHADERREGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+// SPIR-V compiled from the GLSL sources at build time and linked into the binary.
+struct ShaderBinary
+{
+    // File name of the GLSL source, e.g. "triangle1.vert".
+    const char* name;
+    const uint32_t* code;
+    // In bytes, as VkShaderModuleCreateInfo::codeSize expects.
+    size_t codeSize;
+    VkShaderStageFlagBits stage;
+};
+
+// Returns the embedded shader compiled from the source called name, nullptr if there is none.
+const ShaderBinary* findShader(const char* name);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef SPIRVREFLECTION_H
+#define SPIRVREFLECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Execution models as numbered by the SPIR-V specification.
+enum class ShaderExecutionModel : uint32_t
+{
+    Vertex = 0,
+    TessellationControl = 1,
+    TessellationEvaluation = 2,
+    Geometry = 3,
+    Fragment = 4,
+    GLCompute = 5
+};
+
+enum class DescriptorKind
+{
+    Sampler,
+    CombinedImageSampler,
+    SampledImage,
+    StorageImage,
+    UniformTexelBuffer,
+    StorageTexelBuffer,
+    UniformBuffer,
+    StorageBuffer,
+    InputAttachment
+};
+
+struct ReflectedDescriptorBinding
+{
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    DescriptorKind kind = DescriptorKind::UniformBuffer;
+    // Array size, 0 for runtime sized arrays.
+    uint32_t count = 1;
+};
+
+enum class ComponentKind
+{
+    Float,
+    SignedInt,
+    UnsignedInt
+};
+
+struct ReflectedVertexInput
+{
+    uint32_t location = 0;
+    ComponentKind componentKind = ComponentKind::Float;
+    uint32_t componentCount = 1;
+    // In bits.
+    uint32_t componentWidth = 32;
+};
+
+// The resource interface of one entry point of a SPIR-V module.
+struct ShaderReflection
+{
+    ShaderExecutionModel executionModel = ShaderExecutionModel::Vertex;
+    std::string entryPoint;
+    // Sorted by set, then binding.
+    std::vector<ReflectedDescriptorBinding> descriptorBindings;
+    // Byte range of the push constant block the entry point uses, a size of 0 when it has none.
+    uint32_t pushConstantOffset = 0;
+    uint32_t pushConstantSize = 0;
+    // Vertex shader inputs sorted by location, built-ins excluded. Empty for the other stages.
+    std::vector<ReflectedVertexInput> vertexInputs;
+};
+
+// Parses the decorations, types and global variables of a SPIR-V module without a SPIR-V library. Reflects the first
+// entry point, or the one called entryPoint when given. Returns false for malformed modules and for interfaces it
+// cannot describe, e.g. vertex inputs that are not scalars or vectors.
+bool reflectSpirv(const uint32_t* code,
+                  size_t wordCount,
+                  ShaderReflection& reflection,
+                  const char* entryPoint = nullptr);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef STAGINGUPLOADER_H
+#define STAGINGUPLOADER_H
+
+#include "timelineSemaphore.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class GpuMemoryAllocator;
+
+// Batches uploads into device local buffers. All pending copies go through a single host visible staging buffer
+// and are submitted with one command buffer on the given queue. Completion is tracked with a fence, or with a
+// timeline semaphore counting the flushed batches.
+class StagingUploader
+{
+public:
+    StagingUploader();
+
+    bool init(GpuMemoryAllocator& allocator,
+              VkDevice device,
+              VkQueue queue,
+              uint32_t queueFamilyIndex,
+              bool timelineSemaphore = false);
+    void destroy();
+
+    // Queues a copy of size bytes from data into dstBuffer. The data is read during flush(), it has to stay
+    // valid until then. Spans of a MappedFile can be passed directly, their pages are copied into the staging
+    // buffer without a detour through the heap.
+    void enqueue(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+    // Copies all pending data into the staging buffer, submits the transfers and waits for their completion. The
+    // pending copies are dropped on failure too, so their destination buffers can be destroyed right away.
+    bool flush();
+
+private:
+    struct PendingCopy
+    {
+        const void* data;
+        VkDeviceSize size;
+        VkBuffer dstBuffer;
+        VkDeviceSize dstOffset;
+    };
+
+    GpuMemoryAllocator* m_allocator;
+    VkDevice m_device;
+    VkQueue m_queue;
+    VkCommandPool m_commandPool;
+    VkFence m_fence;
+    bool m_useTimeline;
+    TimelineSemaphore m_timeline;
+    // Value signaled by the most recent flush.
+    uint64_t m_flushCount;
+    std::vector<PendingCopy> m_pendingCopies;
+};
+
+#endif
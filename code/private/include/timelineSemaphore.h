@@ -0,0 +1,41 @@
+#ifndef TIMELINESEMAPHORE_H
+#define TIMELINESEMAPHORE_H
+
+#include <cstdint>
+#include <limits>
+
+#include <vulkan/vulkan.h>
+
+// A VK_KHR_timeline_semaphore counter. Submissions signal increasing values, the host waits for exactly the value
+// of the work it depends on or polls how far the GPU got, without a fence per submission to reset and recycle.
+class TimelineSemaphore
+{
+public:
+    TimelineSemaphore();
+
+    // The device must have been created with the extension and its timelineSemaphore feature enabled.
+    bool init(VkDevice device, uint64_t initialValue = 0);
+    void destroy();
+
+    VkSemaphore semaphore() const
+    {
+        return m_semaphore;
+    }
+
+    // The largest value signaled so far.
+    uint64_t completedValue() const;
+
+    // Blocks until the counter reaches value, returns false on timeout or device loss.
+    bool wait(uint64_t value, uint64_t timeout = std::numeric_limits<uint64_t>::max()) const;
+
+private:
+    VkDevice m_device;
+    VkSemaphore m_semaphore;
+    PFN_vkGetSemaphoreCounterValueKHR m_getSemaphoreCounterValue;
+    PFN_vkWaitSemaphoresKHR m_waitSemaphores;
+};
+
+// Whether physicalDevice offers VK_KHR_timeline_semaphore with the timelineSemaphore feature.
+bool timelineSemaphoreSupported(VkPhysicalDevice physicalDevice);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef TLSFALLOCATOR_H
+#define TLSFALLOCATOR_H
+
+#include <cstdint>
+#include <vector>
+
+struct TlsfStats
+{
+    uint64_t totalSize = 0;
+    uint64_t usedSize = 0;
+    uint64_t allocationCount = 0;
+    uint64_t freeRangeCount = 0;
+    uint64_t largestFreeRange = 0;
+};
+
+// Two level segregated fit allocator over the range [0, size). It never touches memory, it only hands out
+// offsets, which makes it usable for sub-allocating VkDeviceMemory blocks. Allocation and free are O(1):
+// free ranges are kept in size class lists indexed through two bitmaps, freed ranges merge with their free
+// neighbours immediately.
+class TlsfAllocator
+{
+public:
+    static const uint32_t kInvalidHandle = 0xffffffffu;
+    // Every offset and size is a multiple of the minimum alignment.
+    static const uint64_t kMinAlignment = 8;
+
+    struct Allocation
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t handle = kInvalidHandle;
+    };
+
+    explicit TlsfAllocator(uint64_t size);
+
+    // alignment has to be a power of two.
+    bool allocate(uint64_t size, uint64_t alignment, Allocation& allocation);
+    void free(uint32_t handle);
+
+    bool empty() const
+    {
+        return m_allocationCount == 0;
+    }
+
+    uint64_t size() const
+    {
+        return m_size;
+    }
+
+    TlsfStats stats() const;
+
+private:
+    static const uint32_t kSecondLevelCountLog2 = 5;
+    static const uint32_t kSecondLevelCount = 1u << kSecondLevelCountLog2;
+    static const uint32_t kMinAlignmentLog2 = 3;
+    static const uint32_t kFirstLevelShift = kSecondLevelCountLog2 + kMinAlignmentLog2;
+    static const uint64_t kSmallRangeSize = 1ull << kFirstLevelShift;
+    static const uint32_t kFirstLevelCount = 64 - kFirstLevelShift + 1;
+
+    struct Range
+    {
+        uint64_t offset;
+        uint64_t size;
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool isFree;
+    };
+
+    static void mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+    uint32_t findFreeRange(uint64_t size) const;
+    void insertFreeRange(uint32_t handle);
+    void removeFreeRange(uint32_t handle);
+    uint32_t createRange(uint64_t offset, uint64_t size);
+    void releaseRange(uint32_t handle);
+    // Splits the tail of a range beyond size off into a new free range.
+    void splitTail(uint32_t handle, uint64_t size);
+    void mergeWithNext(uint32_t handle);
+
+    uint64_t m_size;
+    uint64_t m_usedSize;
+    uint64_t m_allocationCount;
+    uint64_t m_firstLevelBitmap;
+    uint32_t m_secondLevelBitmaps[kFirstLevelCount];
+    uint32_t m_freeHeads[kFirstLevelCount][kSecondLevelCount];
+    std::vector<Range> m_ranges;
+    std::vector<uint32_t> m_unusedHandles;
+};
+
+#endif
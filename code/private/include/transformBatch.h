@@ -0,0 +1,96 @@
+#ifndef TRANSFORMBATCH_H
+#define TRANSFORMBATCH_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Instruction sets the batch kernels exist for. Every level computes the same results as Scalar up to rounding.
+enum class SimdLevel
+{
+    Scalar,
+    // 4 objects per instruction, part of every x86-64 CPU.
+    Sse2,
+    // 8 objects per instruction.
+    Avx2
+};
+
+// The best level the CPU running the process supports, Scalar on other architectures.
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// The planes bounding the clip volume of viewProjection, normalized and facing inwards, with Vulkan's [0, 1] depth.
+void frustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+// Transforms and bounding spheres of many objects, stored as one array per component so the kernels load 4 or 8
+// objects with one instruction. update() composes the model matrices and moves the spheres to world space, cull()
+// tests the world spheres against a frustum; both cover thousands of objects per call.
+class TransformBatch
+{
+public:
+    // level is clamped to what the CPU supports.
+    explicit TransformBatch(SimdLevel level = detectSimdLevel());
+
+    // localSphere is center in xyz and radius in w, in object space. Returns the index of the object.
+    uint32_t add(const glm::vec3& position, const glm::quat& rotation, float scale, const glm::vec4& localSphere);
+    void setTransform(uint32_t index, const glm::vec3& position, const glm::quat& rotation, float scale);
+    // Moves the last object to index, like the swap-remove of a dense array.
+    void removeSwap(uint32_t index);
+    void reserve(uint32_t capacity);
+    void clear();
+
+    uint32_t size() const
+    {
+        return static_cast<uint32_t>(m_positionX.size());
+    }
+
+    SimdLevel simdLevel() const
+    {
+        return m_level;
+    }
+
+    // model = translate(position) * rotate(rotation) * scale(scale) of every object, and its local sphere
+    // transformed by it. rotation has to be normalized.
+    void update();
+
+    // Appends the indices of the objects whose world sphere is at least partly inside planes to visible, returns
+    // how many were appended. planes are normalized and face inwards, see frustumPlanes(). Uses the spheres of the
+    // last update().
+    uint32_t cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const;
+
+    // Valid after update(), the matrices of all objects are contiguous and ready to be copied into a buffer.
+    const glm::mat4* modelMatrices() const
+    {
+        return m_models.data();
+    }
+    glm::vec4 worldSphere(uint32_t index) const
+    {
+        return glm::vec4(m_worldX[index], m_worldY[index], m_worldZ[index], m_worldRadius[index]);
+    }
+
+private:
+    SimdLevel m_level;
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_rotationX;
+    std::vector<float> m_rotationY;
+    std::vector<float> m_rotationZ;
+    std::vector<float> m_rotationW;
+    std::vector<float> m_scale;
+    std::vector<float> m_localX;
+    std::vector<float> m_localY;
+    std::vector<float> m_localZ;
+    std::vector<float> m_localRadius;
+    std::vector<float> m_worldX;
+    std::vector<float> m_worldY;
+    std::vector<float> m_worldZ;
+    std::vector<float> m_worldRadius;
+    std::vector<glm::mat4> m_models;
+};
+
+#endif
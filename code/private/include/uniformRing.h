@@ -0,0 +1,53 @@
+#ifndef UNIFORMRING_H
+#define UNIFORMRING_H
+
+#include "gpuAllocator.h"
+
+#include <vulkan/vulkan.h>
+
+// Per frame uniform data in one persistently mapped, host coherent buffer. Every frame slot owns a slice, selected
+// by the dynamic offset the descriptor set is bound with, so updating a frame's data is a plain copy: no
+// allocation, mapping or flush in the render loop.
+class UniformRing
+{
+public:
+    UniformRing();
+
+    // offsetAlignment is VkPhysicalDeviceLimits::minUniformBufferOffsetAlignment.
+    bool init(GpuMemoryAllocator& allocator, VkDeviceSize sliceSize, uint32_t sliceCount, VkDeviceSize offsetAlignment);
+    void destroy();
+
+    // Overwrites the start of slice, which must not be read by a pending submission.
+    void write(uint32_t slice, const void* data, VkDeviceSize size);
+
+    uint32_t dynamicOffset(uint32_t slice) const
+    {
+        return static_cast<uint32_t>(slice * m_alignedSliceSize);
+    }
+
+    VkBuffer buffer() const
+    {
+        return m_buffer;
+    }
+
+    // The descriptor range, the size of one slice's data.
+    VkDeviceSize sliceSize() const
+    {
+        return m_sliceSize;
+    }
+
+    uint32_t sliceCount() const
+    {
+        return m_sliceCount;
+    }
+
+private:
+    GpuMemoryAllocator* m_allocator;
+    VkBuffer m_buffer;
+    GpuAllocation m_allocation;
+    VkDeviceSize m_sliceSize;
+    VkDeviceSize m_alignedSliceSize;
+    uint32_t m_sliceCount;
+};
+
+#endif
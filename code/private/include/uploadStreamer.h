@@ -0,0 +1,113 @@
+#ifndef UPLOADSTREAMER_H
+#define UPLOADSTREAMER_H
+
+#include "gpuAllocator.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// What a graphics queue submission has to do before it may read streamed buffers: wait on the semaphores at the
+// given stages and execute the command buffers acquiring the buffers from the transfer queue family.
+struct GraphicsHandoff
+{
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<VkPipelineStageFlags> waitStages;
+    std::vector<VkCommandBuffer> commandBuffers;
+
+    bool empty() const
+    {
+        return waitSemaphores.empty();
+    }
+
+    // Keeps the capacity, handing off does not allocate once the vectors have grown.
+    void clear()
+    {
+        waitSemaphores.clear();
+        waitStages.clear();
+        commandBuffers.clear();
+    }
+};
+
+// Streams uploads into device local buffers on a transfer queue without the CPU waiting for them. Copies queued
+// between two submit() calls form a batch sharing one staging buffer and one submission. Completion is signaled to
+// the graphics queue with a semaphore per batch, which the next graphics submission waits on on the GPU. When the
+// transfer queue belongs to another family the batch releases the buffers and the handoff acquires them.
+class UploadStreamer
+{
+public:
+    UploadStreamer();
+
+    bool init(GpuMemoryAllocator& allocator,
+              VkDevice device,
+              VkQueue transferQueue,
+              uint32_t transferFamily,
+              uint32_t graphicsFamily);
+    // Requires the device to be idle.
+    void destroy();
+
+    // Queues a copy of size bytes from data into dstBuffer, which has to be created with exclusive sharing. The data
+    // is read during submit().
+    void enqueue(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+    // Copies all pending data into a staging buffer and submits the batch on the transfer queue, without waiting.
+    bool submit();
+
+    // Appends the batches submitted since the last call to handoff. submissionNumber identifies the graphics
+    // submission executing it, see release().
+    void takeHandoffs(uint64_t submissionNumber, GraphicsHandoff& handoff);
+
+    // Frees the staging memory and recycles the semaphores of batches handed to graphics submissions numbered below
+    // completedSubmissions, those have completed and with them the transfers they waited for.
+    void release(uint64_t completedSubmissions);
+
+    bool dedicatedQueueFamily() const
+    {
+        return m_transferFamily != m_graphicsFamily;
+    }
+
+    // Submitted batches whose graphics submission has not completed yet.
+    size_t pendingBatchCount() const
+    {
+        return m_batches.size();
+    }
+
+private:
+    struct PendingCopy
+    {
+        const void* data;
+        VkDeviceSize size;
+        VkBuffer dstBuffer;
+        VkDeviceSize dstOffset;
+    };
+
+    struct Batch
+    {
+        VkBuffer stagingBuffer = VK_NULL_HANDLE;
+        GpuAllocation stagingAllocation;
+        VkCommandBuffer transferCommands = VK_NULL_HANDLE;
+        VkCommandBuffer acquireCommands = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        bool handedOff = false;
+        uint64_t submissionNumber = 0;
+    };
+
+    VkSemaphore takeSemaphore();
+    void freeBatch(Batch& batch);
+
+    GpuMemoryAllocator* m_allocator;
+    VkDevice m_device;
+    VkQueue m_transferQueue;
+    uint32_t m_transferFamily;
+    uint32_t m_graphicsFamily;
+    VkCommandPool m_transferCommandPool;
+    VkCommandPool m_acquireCommandPool;
+    std::vector<PendingCopy> m_pendingCopies;
+    std::deque<Batch> m_batches;
+    // Unsignaled semaphores of released batches.
+    std::vector<VkSemaphore> m_freeSemaphores;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef VERTEXLAYOUT_H
+#define VERTEXLAYOUT_H
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+// Describes the vertex buffer bindings of a pipeline and the attributes fetched from each of them.
+class VertexLayout
+{
+public:
+    VertexLayout& addBinding(uint32_t stride, VkVertexInputRate inputRate)
+    {
+        VkVertexInputBindingDescription binding = {};
+        binding.binding = static_cast<uint32_t>(m_bindings.size());
+        binding.stride = stride;
+        binding.inputRate = inputRate;
+        m_bindings.push_back(binding);
+        return *this;
+    }
+
+    // Adds an attribute to the most recently added binding.
+    VertexLayout& addAttribute(uint32_t location, VkFormat format, uint32_t offset)
+    {
+        VkVertexInputAttributeDescription attribute = {};
+        attribute.binding = m_bindings.empty() ? 0 : m_bindings.back().binding;
+        attribute.location = location;
+        attribute.format = format;
+        attribute.offset = offset;
+        m_attributes.push_back(attribute);
+        return *this;
+    }
+
+    // The returned structure points into this layout, which has to outlive the pipeline creation.
+    VkPipelineVertexInputStateCreateInfo createInfo() const
+    {
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(m_bindings.size());
+        vertexInputInfo.pVertexBindingDescriptions = m_bindings.empty() ? nullptr : m_bindings.data();
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(m_attributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions = m_attributes.empty() ? nullptr : m_attributes.data();
+        return vertexInputInfo;
+    }
+
+    const std::vector<VkVertexInputBindingDescription>& bindings() const
+    {
+        return m_bindings;
+    }
+
+    const std::vector<VkVertexInputAttributeDescription>& attributes() const
+    {
+        return m_attributes;
+    }
+
+private:
+    std::vector<VkVertexInputBindingDescription> m_bindings;
+    std::vector<VkVertexInputAttributeDescription> m_attributes;
+};
+
+#endif
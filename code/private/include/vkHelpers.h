@@ -0,0 +1,11 @@
+#ifndef VKHELPERS_H
+#define VKHELPERS_H
+
+#include <vulkan/vulkan.h>
+
+bool findMemoryType(const VkPhysicalDevice& device,
+                    uint32_t typeFilter,
+                    VkMemoryPropertyFlags properties,
+                    uint32_t& memoryTypeIndex);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads consuming a shared job queue.
+class WorkerPool
+{
+public:
+    // A thread count of 0 starts one worker per hardware thread.
+    explicit WorkerPool(uint32_t threadCount = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t threadCount() const
+    {
+        return static_cast<uint32_t>(m_threads.size());
+    }
+
+    void submit(std::function<void()> job);
+
+    // Runs task(0) ... task(count - 1) on the workers and returns once all of them finished. Every index runs on
+    // exactly one thread.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    bool m_stopping;
+};
+
+#endif
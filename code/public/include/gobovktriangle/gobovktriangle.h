@@ -1,5 +1,100 @@
 #ifndef GOBOVKTRIANGLE_H
 #define GOBOVKTRIANGLE_H
 
-#endif
+#include <cstdint>
+#include <string>
+
+// How the command buffers of a frame are produced.
+enum class RecordingMode
+{
+    // Recorded once per swap chain image and resubmitted every frame.
+    Static,
+    // Re-recorded every frame into a transient command pool that is reset as a whole.
+    PerFrame
+};
+
+// How the CPU tracks the completion of frames and uploads.
+enum class SyncMode
+{
+    // A fence per frame slot and per upload, waited on and reset for every reuse.
+    Fences,
+    // One VK_KHR_timeline_semaphore counter for frames and one for uploads, waited on for the exact value needed.
+    // Falls back to fences when the device lacks the extension.
+    Timeline
+};
+
+struct ApplicationConfig
+{
+    // Number of frames the CPU may record and submit ahead of the GPU.
+    uint32_t maxFramesInFlight = 2;
+    // Render into offscreen images without GLFW, a surface or VK_KHR_swapchain (e.g. on lavapipe/SwiftShader).
+    bool headless = false;
+    uint32_t width = 480;
+    uint32_t height = 270;
+    // Number of frames to render before exiting, 0 renders until the window is closed.
+    uint32_t frameCount = 0;
+    // Number of mesh instances drawn per frame, laid out on a grid covering the viewport.
+    uint32_t instanceCount = 1;
+    // Instances per draw call, 0 draws all of them with a single call.
+    uint32_t instancesPerDraw = 0;
+    // Scales the grid around the viewport center, above 1 pushes the outer instances out of view.
+    float zoom = 1.0f;
+    // Frustum culls the draws in a compute pass and issues the visible ones with indirect draws, falls back to
+    // drawing everything from the CPU when the device lacks multiDrawIndirect or drawIndirectFirstInstance.
+    bool gpuCulling = false;
+    // Threads recording draws into secondary command buffers, 0 records everything on the main thread.
+    uint32_t recordingThreads = 0;
+    RecordingMode recordingMode = RecordingMode::Static;
+    SyncMode syncMode = SyncMode::Fences;
+    // Uploads the instance data on the graphics queue and waits for it, instead of streaming it on the transfer
+    // queue while startup continues and having the first frame wait for it on the GPU.
+    bool blockingUploads = false;
+    // Measures the render pass and draws with timestamp queries, statistics are logged at exit.
+    bool gpuProfiling = false;
+    // Also writes the GPU statistics as JSON to this file when not empty.
+    std::string gpuProfilePath;
+    // Writes the CPU profiler zones as a Chrome trace to this file at exit, requires VK_TRIANGLE_CPU_PROFILER.
+    std::string cpuTracePath;
+    // Graphics pipeline variants differing in specialization constants and blend state. The base pipeline is built
+    // before the first frame, the others on background threads while frames are already rendered; draws cycle
+    // through the ready ones.
+    uint32_t pipelineVariants = 1;
+    // Threads building the pipeline variants, 0 starts one per hardware thread.
+    uint32_t pipelineBuildThreads = 0;
+    // Holds the first frame back until every variant is built, to compare against building in the background.
+    bool waitForPipelines = false;
+    // Recompiles the GLSL shaders whenever they are saved and swaps the rebuilt pipeline in between frames.
+    bool shaderHotReload = false;
+    // Directory holding the GLSL sources to watch, empty uses the source tree the binary was built from.
+    std::string shaderSourceDirectory;
+    // Pipeline cache file loaded at startup and written back at shutdown, empty disables the on-disk cache.
+    std::string pipelineCachePath = "./goboVkTriangle.pipelinecache";
+};
 
+// Measurements of a finished run, times are in milliseconds.
+struct RunStatistics
+{
+    // From the start of the run until every resource is created.
+    double startupTime = 0.0;
+    // From the start of the run until the first frame is submitted.
+    double timeToFirstFrame = 0.0;
+    uint32_t pipelineVariants = 0;
+    // Variants, including the base pipeline, that were built by the time the first frame was submitted.
+    uint32_t pipelineVariantsReadyAtFirstFrame = 0;
+    // From queuing the background variant builds until the last one finished.
+    double pipelineBuildTime = 0.0;
+    uint64_t frameCount = 0;
+    double framesPerSecond = 0.0;
+    double averageFrameTime = 0.0;
+    double frameTimeP50 = 0.0;
+    double frameTimeP99 = 0.0;
+};
+
+// Parses the vkTriangle command line options into config, returns false on unknown or malformed options.
+bool parseCommandLine(int argc, char* argv[], ApplicationConfig& config);
+
+// Renders until the configured frame count is reached or the window is closed, fills statistics when given.
+// Returns false when rendering a frame failed.
+bool runApplication(const ApplicationConfig& config, RunStatistics* statistics = nullptr);
+
+#endif
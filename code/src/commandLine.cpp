@@ -0,0 +1,192 @@
+#include "goboVkTriangle/goboVkTriangle.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstdlib>
+
+static bool parseUnsigned(const char* text, uint32_t& value)
+{
+    char* end = nullptr;
+    const unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0')
+    {
+        lerror("Expected a number, got: {}", text);
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+static bool parseFloat(const char* text, float& value)
+{
+    char* end = nullptr;
+    const float parsed = std::strtof(text, &end);
+    if (end == text || *end != '\0')
+    {
+        lerror("Expected a number, got: {}", text);
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool parseCommandLine(int argc, char* argv[], ApplicationConfig& config)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string argument = argv[i];
+        if (argument == "--frames-in-flight" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.maxFramesInFlight))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--headless")
+        {
+            config.headless = true;
+        }
+        else if (argument == "--width" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.width))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--height" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.height))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--instances" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.instanceCount))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--instances-per-draw" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.instancesPerDraw))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--zoom" && i + 1 < argc)
+        {
+            if (!parseFloat(argv[++i], config.zoom))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--gpu-culling")
+        {
+            config.gpuCulling = true;
+        }
+        else if (argument == "--recording-threads" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.recordingThreads))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--recording-mode" && i + 1 < argc)
+        {
+            const std::string mode = argv[++i];
+            if (mode == "static")
+            {
+                config.recordingMode = RecordingMode::Static;
+            }
+            else if (mode == "per-frame")
+            {
+                config.recordingMode = RecordingMode::PerFrame;
+            }
+            else
+            {
+                lerror("Unknown recording mode: {}", mode.c_str());
+                return false;
+            }
+        }
+        else if (argument == "--sync" && i + 1 < argc)
+        {
+            const std::string mode = argv[++i];
+            if (mode == "fences")
+            {
+                config.syncMode = SyncMode::Fences;
+            }
+            else if (mode == "timeline")
+            {
+                config.syncMode = SyncMode::Timeline;
+            }
+            else
+            {
+                lerror("Unknown sync mode: {}", mode.c_str());
+                return false;
+            }
+        }
+        else if (argument == "--blocking-uploads")
+        {
+            config.blockingUploads = true;
+        }
+        else if (argument == "--gpu-profile")
+        {
+            config.gpuProfiling = true;
+        }
+        else if (argument == "--gpu-profile-json" && i + 1 < argc)
+        {
+            config.gpuProfiling = true;
+            config.gpuProfilePath = argv[++i];
+        }
+        else if (argument == "--cpu-trace" && i + 1 < argc)
+        {
+            config.cpuTracePath = argv[++i];
+        }
+        else if (argument == "--pipeline-variants" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.pipelineVariants))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--pipeline-build-threads" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.pipelineBuildThreads))
+            {
+                return false;
+            }
+        }
+        else if (argument == "--wait-for-pipelines")
+        {
+            config.waitForPipelines = true;
+        }
+        else if (argument == "--hot-reload")
+        {
+            config.shaderHotReload = true;
+        }
+        else if (argument == "--shader-dir" && i + 1 < argc)
+        {
+            config.shaderHotReload = true;
+            config.shaderSourceDirectory = argv[++i];
+        }
+        else if (argument == "--pipeline-cache" && i + 1 < argc)
+        {
+            config.pipelineCachePath = argv[++i];
+        }
+        else if (argument == "--frames" && i + 1 < argc)
+        {
+            if (!parseUnsigned(argv[++i], config.frameCount))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            lerror("Unknown command line argument: {}", argument.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
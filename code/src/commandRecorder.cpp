@@ -0,0 +1,122 @@
+#include "commandRecorder.h"
+
+#include "cpuProfiler.h"
+#include "workerPool.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <algorithm>
+#include <atomic>
+
+ParallelCommandRecorder::ParallelCommandRecorder()
+    : m_device(VK_NULL_HANDLE), m_queueFamilyIndex(0), m_commandPoolFlags(0), m_workerPool(nullptr), m_taskCount(0)
+{
+}
+
+bool ParallelCommandRecorder::init(VkDevice device,
+                                   uint32_t queueFamilyIndex,
+                                   WorkerPool& workerPool,
+                                   VkCommandPoolCreateFlags commandPoolFlags)
+{
+    m_device = device;
+    m_queueFamilyIndex = queueFamilyIndex;
+    m_commandPoolFlags = commandPoolFlags;
+    m_workerPool = &workerPool;
+    m_taskCount = workerPool.threadCount();
+    return true;
+}
+
+void ParallelCommandRecorder::destroy()
+{
+    for (auto& slot : m_slots)
+    {
+        // Destroying a pool frees its command buffers as well.
+        for (auto pool : slot.commandPools)
+        {
+            vkDestroyCommandPool(m_device, pool, nullptr);
+        }
+    }
+    m_slots.clear();
+}
+
+bool ParallelCommandRecorder::record(uint32_t slotIndex,
+                                     VkCommandBuffer primary,
+                                     const VkCommandBufferInheritanceInfo& inheritanceInfo,
+                                     VkCommandBufferUsageFlags usage,
+                                     uint32_t drawCount,
+                                     const RecordFunction& recordDraws)
+{
+    if (slotIndex >= m_slots.size())
+    {
+        m_slots.resize(slotIndex + 1);
+    }
+    Slot& slot = m_slots[slotIndex];
+    if (slot.commandPools.empty() && !createSlot(slot))
+    {
+        return false;
+    }
+
+    const uint32_t drawsPerTask = (drawCount + m_taskCount - 1) / m_taskCount;
+    std::atomic<bool> succeeded(true);
+    m_workerPool->parallelFor(m_taskCount, [&](uint32_t task) {
+        PROFILE_ZONE("record secondary command buffer");
+        const uint32_t firstDraw = std::min(drawCount, task * drawsPerTask);
+        const uint32_t taskDrawCount = std::min(drawCount - firstDraw, drawsPerTask);
+
+        // Recycles all memory of the previous recording at once instead of resetting single buffers.
+        vkResetCommandPool(m_device, slot.commandPools[task], 0);
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = usage | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        VkCommandBuffer commandBuffer = slot.commandBuffers[task];
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        if (taskDrawCount > 0)
+        {
+            recordDraws(commandBuffer, firstDraw, taskDrawCount);
+        }
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            succeeded = false;
+        }
+    });
+    if (!succeeded)
+    {
+        lerror("Failed to record secondary command buffers!");
+        return false;
+    }
+
+    vkCmdExecuteCommands(primary, m_taskCount, slot.commandBuffers.data());
+    return true;
+}
+
+bool ParallelCommandRecorder::createSlot(Slot& slot)
+{
+    slot.commandPools.resize(m_taskCount, VK_NULL_HANDLE);
+    slot.commandBuffers.resize(m_taskCount, VK_NULL_HANDLE);
+    for (uint32_t task = 0; task < m_taskCount; ++task)
+    {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = m_queueFamilyIndex;
+        poolInfo.flags = m_commandPoolFlags;
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &slot.commandPools[task]) != VK_SUCCESS)
+        {
+            lerror("Failed to create recording command pool!");
+            return false;
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = slot.commandPools[task];
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &slot.commandBuffers[task]) != VK_SUCCESS)
+        {
+            lerror("Failed to allocate secondary command buffer!");
+            return false;
+        }
+    }
+    return true;
+}
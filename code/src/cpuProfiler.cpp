@@ -0,0 +1,121 @@
+#include "cpuProfiler.h"
+
+#include <fstream>
+#include <iomanip>
+
+const uint32_t CpuProfiler::kEventsPerThread;
+
+static void writeJsonString(std::ostream& stream, const char* text)
+{
+    stream << '"';
+    for (const char* c = text; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            stream << '\\';
+        }
+        stream << *c;
+    }
+    stream << '"';
+}
+
+CpuProfiler& CpuProfiler::instance()
+{
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+CpuProfiler::CpuProfiler() : m_epoch(std::chrono::steady_clock::now())
+{
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+    threadBuffer().threadName = name;
+}
+
+void CpuProfiler::addZone(const char* name,
+                          std::chrono::steady_clock::time_point start,
+                          std::chrono::steady_clock::time_point end)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    const uint32_t index = buffer.eventCount.load(std::memory_order_relaxed);
+    if (index >= kEventsPerThread)
+    {
+        buffer.droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Event& event = buffer.events[index];
+    event.name = name;
+    event.startNs = std::chrono::duration_cast<std::chrono::nanoseconds>(start - m_epoch).count();
+    event.durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    buffer.eventCount.store(index + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string& filePath) const
+{
+    std::ofstream file(filePath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    const char* separator = "\n";
+    for (const auto& buffer : m_threadBuffers)
+    {
+        if (buffer->threadName != nullptr)
+        {
+            file << separator << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << buffer->threadId
+                 << ", \"args\": {\"name\": ";
+            writeJsonString(file, buffer->threadName);
+            file << "}}";
+            separator = ",\n";
+        }
+
+        // Chrome traces count in microseconds, keep the nanoseconds as fractions.
+        const uint32_t eventCount = buffer->eventCount.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < eventCount; ++i)
+        {
+            const Event& event = buffer->events[i];
+            file << separator << "{\"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->threadId << ", \"name\": ";
+            writeJsonString(file, event.name);
+            file << ", \"ts\": " << static_cast<double>(event.startNs) / 1000.0
+                 << ", \"dur\": " << static_cast<double>(event.durationNs) / 1000.0 << "}";
+            separator = ",\n";
+        }
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+uint64_t CpuProfiler::droppedEventCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t droppedCount = 0;
+    for (const auto& buffer : m_threadBuffers)
+    {
+        droppedCount += buffer->droppedCount.load(std::memory_order_relaxed);
+    }
+    return droppedCount;
+}
+
+CpuProfiler::ThreadBuffer& CpuProfiler::threadBuffer()
+{
+    // Buffers are owned by the profiler, so zones of threads that already exited still get exported.
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (buffer == nullptr)
+    {
+        std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+        newBuffer->events.reset(new Event[kEventsPerThread]);
+        buffer = newBuffer.get();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        buffer->threadId = static_cast<uint32_t>(m_threadBuffers.size());
+        m_threadBuffers.push_back(std::move(newBuffer));
+    }
+    return *buffer;
+}
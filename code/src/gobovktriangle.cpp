@@ -2,42 +2,65 @@
 // See original from: https://vulkan-tutorial.com/, for more details.
 
 #include "goboVkTriangle/goboVkTriangle.h"
+#include "commandRecorder.h"
+#include "cpuProfiler.h"
+#include "gpuAllocator.h"
+#include "gpuCuller.h"
+#include "gpuProfiler.h"
+#include "mesh.h"
+#include "pipelineBuildService.h"
+#include "pipelineCache.h"
+#include "pipelineLayoutCache.h"
+#include "pipelineVariant.h"
+#include "renderGraph.h"
+#include "renderGraphExecutor.h"
+#include "rollingStatistics.h"
+#include "shaderHotReloader.h"
+#include "shaderRegistry.h"
+#include "spirvReflection.h"
+#include "stagingUploader.h"
+#include "timelineSemaphore.h"
+#include "uniformRing.h"
+#include "uploadStreamer.h"
+#include "vkHelpers.h"
+#include "workerPool.h"
 
 #include "sorban_loom/sorban_loom.h"
 
 #include <algorithm>
-#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 
 #include <vulkan/vulkan.h>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/vec4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
-static bool readFile(const std::string& fileName, std::vector<char>& resultBuffer)
-{
-    std::ifstream file(fileName, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
-    {
-        lerror("Failed to open file {}", fileName.c_str());
-        return false;
-    }
+// constant_id of the specialization constants triangle1.frag declares.
+static const uint32_t kColorModeConstant = 0;
+static const uint32_t kPosterizeLevelsConstant = 1;
+static const uint32_t kOpacityConstant = 2;
 
-    size_t fileSize = (size_t) file.tellg();
-    resultBuffer.resize(fileSize);
-    file.seekg(0);
-    file.read(resultBuffer.data(), fileSize);
-    file.close();
-
-    ldebug("Read file {}, {} bytes", fileName.c_str(), fileSize);
-
-    return true;
-}
+#ifndef VK_TRIANGLE_SHADER_SOURCE_DIR
+#define VK_TRIANGLE_SHADER_SOURCE_DIR "."
+#endif
+#ifndef VK_TRIANGLE_GLSLANG_VALIDATOR
+#define VK_TRIANGLE_GLSLANG_VALIDATOR "glslangValidator"
+#endif
 
 bool chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
                            VkPresentModeKHR& chosenPresentMode)
@@ -170,6 +193,9 @@ struct QueueFamilyIndices
 {
     int graphicsFamily = -1;
     int presentFamily = -1;
+    // A family without graphics support that can transfer, preferably transfer only (DMA engines), else async
+    // compute. -1 when the device has none, uploads then share the graphics family.
+    int transferFamily = -1;
 
     bool isComplete()
     {
@@ -232,8 +258,16 @@ static QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& device, VkSu
             indices.graphicsFamily = i;
         }
 
+        // Without a surface nothing is presented, the graphics queue stands in for the present queue.
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (surface == VK_NULL_HANDLE)
+        {
+            presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        }
+        else
+        {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        }
         if (queueFamily.queueCount > 0 && presentSupport)
         {
             indices.presentFamily = i;
@@ -246,24 +280,154 @@ static QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& device, VkSu
         ++i;
     }
 
+    // Compute queues support transfers even without the transfer bit.
+    for (uint32_t family = 0; family < queueFamilyCount; ++family)
+    {
+        const VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if (queueFamilies[family].queueCount == 0 || (flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            continue;
+        }
+        if (!(flags & VK_QUEUE_COMPUTE_BIT) && (flags & VK_QUEUE_TRANSFER_BIT))
+        {
+            indices.transferFamily = static_cast<int>(family);
+            break;
+        }
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && indices.transferFamily < 0)
+        {
+            indices.transferFamily = static_cast<int>(family);
+        }
+    }
+
     return indices;
 }
 
+// Objects of a replaced swap chain, kept alive until the frames that still reference them have finished.
+struct RetiredSwapchain
+{
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    std::vector<VkImageView> imageViews;
+    std::vector<VkFramebuffer> framebuffers;
+    std::vector<VkCommandBuffer> commandBuffers;
+    uint64_t frameNumber = 0;
+};
+
+// Per frame data of triangle1.vert, set 0 binding 0, read from a slice of the uniform ring.
+struct FrameUniforms
+{
+    // Rotates every triangle around its own origin.
+    glm::mat4 model;
+    // Places the instance grid, the culling dispatch tests the draw bounds against the same frustum.
+    glm::mat4 viewProjection;
+};
+
+// Per draw push constants of triangle1.vert.
+struct DrawConstants
+{
+    glm::vec4 tint;
+};
+static const VkShaderStageFlags kDrawConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
+// Draws cycle through this many tints.
+static const uint32_t kTintCount = 4;
+
+// Variant 0 is the plain base pipeline, the others step through the color modes, blend modes and posterization
+// levels of triangle1.frag, so every index yields a distinct pipeline.
+static PipelineVariantKey pipelineVariantKey(uint32_t variant)
+{
+    PipelineVariantKey key;
+    key.specializationConstants[kColorModeConstant] = variant % 3;
+    key.blendMode = static_cast<BlendMode>((variant / 3) % 3);
+    key.specializationConstants[kPosterizeLevelsConstant] = variant < 9 ? 0 : variant / 9 + 1;
+    key.specializationConstants[kOpacityConstant] = key.blendMode == BlendMode::Opaque ? 100 : 75;
+    return key;
+}
+
+// A pipeline replaced by a hot reload together with the static command buffers recorded with it.
+struct RetiredPipeline
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> commandBuffers;
+    // Variant pipelines built from the replaced shaders, destroying the service destroys them.
+    std::unique_ptr<PipelineBuildService> variantBuilds;
+    uint64_t frameNumber = 0;
+};
+
+struct FrameStatistics
+{
+    uint64_t frameCount = 0;
+    std::chrono::steady_clock::duration totalFrameTime = std::chrono::steady_clock::duration::zero();
+    std::chrono::steady_clock::duration totalStallTime = std::chrono::steady_clock::duration::zero();
+    std::chrono::steady_clock::duration totalRecordTime = std::chrono::steady_clock::duration::zero();
+    // Individual frame times in milliseconds for the percentiles, long runs keep the most recent ones.
+    RollingStatistics frameTimes{1u << 16};
+};
+
 class HelloVkTriangleApplication
 {
 public:
-    HelloVkTriangleApplication() : m_enableValidationLayers(false), m_physicalDevice(VK_NULL_HANDLE)
+    explicit HelloVkTriangleApplication(const ApplicationConfig& config)
+        : m_config(config),
+          m_enableValidationLayers(false),
+          m_window(nullptr),
+          m_instance(VK_NULL_HANDLE),
+          m_debugCallback(VK_NULL_HANDLE),
+          m_surface(VK_NULL_HANDLE),
+          m_physicalDevice(VK_NULL_HANDLE),
+          m_logicalDevice(VK_NULL_HANDLE),
+          m_swapchain(VK_NULL_HANDLE),
+          m_graphicsPipeline(VK_NULL_HANDLE),
+          m_pendingPipeline(VK_NULL_HANDLE),
+          m_pipelineBuilds(new PipelineBuildService()),
+          m_finishedVariantCount(0),
+          m_variantsReadyAtFirstFrame(0),
+          m_commandPool(VK_NULL_HANDLE),
+          m_instanceBuffer(VK_NULL_HANDLE),
+          m_instanceCount(0),
+          m_instancesPerDraw(0),
+          m_drawCount(0),
+          m_meshRadius(0.0f),
+          m_drawIndirectCount(false),
+          m_descriptorPool(VK_NULL_HANDLE),
+          m_frameDescriptorSet(VK_NULL_HANDLE),
+          m_currentFrame(0),
+          m_frameNumber(0),
+          m_framebufferResized(false),
+          m_startupTime(std::chrono::steady_clock::duration::zero()),
+          m_timeToFirstFrame(std::chrono::steady_clock::duration::zero())
     {
+        m_config.maxFramesInFlight = std::max(1u, m_config.maxFramesInFlight);
         m_validationLayers.push_back("VK_LAYER_LUNARG_standard_validation");
-        m_requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        if (!m_config.headless)
+        {
+            m_requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
     }
 
-    void run()
+    bool run(RunStatistics* statistics)
     {
-        initWindow();
-        initVulkan();
-        mainLoop();
+        PROFILE_FUNCTION();
+        m_runStart = std::chrono::steady_clock::now();
+        if (!m_config.headless && !initWindow())
+        {
+            cleanup();
+            return false;
+        }
+        if (!initVulkan())
+        {
+            lerror("Failed to initialize Vulkan!");
+            cleanup();
+            return false;
+        }
+        m_startupTime = std::chrono::steady_clock::now() - m_runStart;
+        linfo("Startup took {:.3f} ms", std::chrono::duration<double, std::milli>(m_startupTime).count());
+
+        const bool succeeded = mainLoop();
+        if (statistics != nullptr)
+        {
+            fillRunStatistics(*statistics);
+        }
         cleanup();
+        return succeeded;
     }
 
 private:
@@ -282,7 +446,8 @@ private:
 
         score += deviceProperties.limits.maxImageDimension2D;
 
-        if (!deviceFeatures.geometryShader)
+        // Software rasterizers like SwiftShader lack geometry shaders, headless runs need to accept them.
+        if (!m_config.headless && !deviceFeatures.geometryShader)
         {
             return 0;
         }
@@ -310,6 +475,11 @@ private:
             }
         }
 
+        if (m_config.headless)
+        {
+            return score;
+        }
+
         SwapChainDetails swapchainDetails;
         if (!querySwapChainSupport(device, surface, swapchainDetails))
         {
@@ -335,17 +505,25 @@ private:
 
     bool initWindow()
     {
+        PROFILE_FUNCTION();
         glfwInit();
 
         glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-        double factor = 0.25;
-        m_windowWidth = factor * 1920;
-        m_windowHeight = factor * 1080;
+        m_windowWidth = m_config.width;
+        m_windowHeight = m_config.height;
         m_window = glfwCreateWindow(m_windowWidth, m_windowHeight, "Vk", nullptr, nullptr);
+        glfwSetWindowUserPointer(m_window, this);
+        glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
 
         return true;
     }
 
+    static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
+    {
+        auto application = reinterpret_cast<HelloVkTriangleApplication*>(glfwGetWindowUserPointer(window));
+        application->m_framebufferResized = true;
+    }
+
     void setupDebugCallback()
     {
         if (!m_enableValidationLayers)
@@ -366,6 +544,7 @@ private:
 
     bool createSurface()
     {
+        PROFILE_FUNCTION();
         if (glfwCreateWindowSurface(m_instance, m_window, nullptr, &m_surface) != VK_SUCCESS)
         {
             lerror("Failed to create window surface!");
@@ -376,6 +555,7 @@ private:
 
     bool pickPhysicalDevice()
     {
+        PROFILE_FUNCTION();
         uint32_t deviceCount = 0;
         vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
         if (deviceCount == 0)
@@ -411,6 +591,7 @@ private:
 
     bool createSwapChain(uint32_t windowWidth, uint32_t windowHeight)
     {
+        PROFILE_FUNCTION();
         SwapChainDetails swapchainSupport;
         if (!querySwapChainSupport(m_physicalDevice, m_surface, swapchainSupport))
         {
@@ -475,7 +656,9 @@ private:
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        // Passing the current swap chain lets the presentation engine hand over its resources, it gets retired
+        // and can no longer acquire images, even if the creation of the new one fails.
+        createInfo.oldSwapchain = m_swapchain;
 
         if (vkCreateSwapchainKHR(m_logicalDevice, &createInfo, nullptr, &m_swapchain) != VK_SUCCESS)
         {
@@ -493,8 +676,46 @@ private:
         return true;
     }
 
+    bool createOffscreenTargets(uint32_t width, uint32_t height)
+    {
+        PROFILE_FUNCTION();
+        // One render target per frame slot, the in-flight fence of the slot guards reuse of its image.
+        m_swapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+        m_swapchainExtent = {width, height};
+        m_swapchainImages.resize(m_config.maxFramesInFlight, VK_NULL_HANDLE);
+        m_offscreenImageAllocations.resize(m_config.maxFramesInFlight);
+
+        for (uint32_t i = 0; i < m_config.maxFramesInFlight; ++i)
+        {
+            VkImageCreateInfo imageInfo = {};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = m_swapchainImageFormat;
+            imageInfo.extent = {width, height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (!m_allocator.createImage(imageInfo,
+                                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                         m_swapchainImages[i],
+                                         m_offscreenImageAllocations[i]))
+            {
+                lerror("Failed to create offscreen image {}!", i);
+                return false;
+            }
+        }
+
+        ldebug("{} offscreen render targets created ({}x{})!", m_swapchainImages.size(), width, height);
+        return true;
+    }
+
     bool createSwapChainImageViews()
     {
+        PROFILE_FUNCTION();
         m_swapchainImageViews.resize(m_swapchainImages.size());
         for (size_t i = 0; i < m_swapchainImages.size(); ++i)
         {
@@ -523,12 +744,12 @@ private:
         return true;
     }
 
-    bool createShaderModule(const std::vector<char>& shader, VkShaderModule& shaderModule)
+    bool createShaderModule(const ShaderBinary& shader, VkShaderModule& shaderModule) const
     {
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = shader.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(shader.data());
+        createInfo.codeSize = shader.codeSize;
+        createInfo.pCode = shader.code;
         if (vkCreateShaderModule(m_logicalDevice, &createInfo, nullptr, &shaderModule))
         {
             lerror("Failed to create shader module!");
@@ -538,49 +759,29 @@ private:
         return true;
     }
 
+    // Declares the frame as a render graph and builds it. The graph derives the barriers and layout transitions of
+    // the swapchain image, the render pass of the main pass keeps it in the attachment layout throughout.
     bool createRenderPass()
     {
-        VkAttachmentDescription colorAttachment = {};
-        colorAttachment.format = m_swapchainImageFormat;
-        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-        VkAttachmentReference colorAttachmentRef = {};
-        colorAttachmentRef.attachment = 0;
-        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-        VkSubpassDescription subpass = {};
-        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-        subpass.pColorAttachments = &colorAttachmentRef;
-        subpass.colorAttachmentCount = 1;
-
-        VkRenderPassCreateInfo createRenderPassInfo = {};
-        createRenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-        createRenderPassInfo.attachmentCount = 1;
-        createRenderPassInfo.pAttachments = &colorAttachment;
-        createRenderPassInfo.subpassCount = 1;
-        createRenderPassInfo.pSubpasses = &subpass;
-
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        createRenderPassInfo.dependencyCount = 1;
-        createRenderPassInfo.pDependencies = &dependency;
-
-        if (vkCreateRenderPass(m_logicalDevice, &createRenderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS)
-        {
-            lerror("Failed to create the render pass!");
+        PROFILE_FUNCTION();
+        // The acquire semaphore is waited on at the color attachment output stage, the transition chains onto it.
+        const ImageState acquired = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+        const ImageState presented = {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+        const ImageState copied = {
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT};
+        const ImageState released = m_config.headless ? copied : presented;
+
+        m_frameGraph.clear();
+        m_backbufferResource = m_frameGraph.importImage("backbuffer", m_swapchainImageFormat, acquired, released);
+        m_mainPass = m_frameGraph.addPass("triangles");
+        m_frameGraph.useImage(m_mainPass, m_backbufferResource, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+        if (!m_graphExecutor.build(m_frameGraph, frameSlotCount()))
+        {
+            lerror("Failed to build the frame graph!");
             return false;
         }
+        m_renderPass = m_graphExecutor.renderPass(m_mainPass);
+        m_graphImages.assign(m_frameGraph.resourceCount(), VK_NULL_HANDLE);
         ldebug("Render pass created!");
 
         return true;
@@ -588,8 +789,13 @@ private:
 
     bool createLogicalDevice()
     {
+        PROFILE_FUNCTION();
         std::set<int> uniqueQueueFamilyIndices = {m_queueFamilyIndices.graphicsFamily,
                                                   m_queueFamilyIndices.presentFamily};
+        if (m_queueFamilyIndices.transferFamily >= 0)
+        {
+            uniqueQueueFamilyIndices.insert(m_queueFamilyIndices.transferFamily);
+        }
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         float queuePriority = 1.0f;
         for (int queueFamily : uniqueQueueFamilyIndices)
@@ -604,13 +810,50 @@ private:
 
         VkPhysicalDeviceFeatures deviceFeatures = {};
 
+        std::vector<const char*> deviceExtensions = m_requiredDeviceExtensions;
+        if (m_config.gpuCulling)
+        {
+            if (gpuCullingSupported(m_physicalDevice))
+            {
+                deviceFeatures.multiDrawIndirect = VK_TRUE;
+                deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+                m_drawIndirectCount = drawIndirectCountSupported(m_physicalDevice);
+                if (m_drawIndirectCount)
+                {
+                    deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+                }
+            }
+            else
+            {
+                linfo("multiDrawIndirect or drawIndirectFirstInstance is not supported, drawing without GPU culling.");
+                m_config.gpuCulling = false;
+            }
+        }
+
+        VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+        timelineFeatures.timelineSemaphore = VK_TRUE;
+        if (m_config.syncMode == SyncMode::Timeline)
+        {
+            if (timelineSemaphoreSupported(m_physicalDevice))
+            {
+                deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+            }
+            else
+            {
+                linfo("VK_KHR_timeline_semaphore is not supported, synchronizing with fences.");
+                m_config.syncMode = SyncMode::Fences;
+            }
+        }
+
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = m_config.syncMode == SyncMode::Timeline ? &timelineFeatures : nullptr;
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(m_requiredDeviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = m_requiredDeviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
         if (m_enableValidationLayers)
         {
@@ -633,75 +876,389 @@ private:
 
     bool createGraphicsPipeline()
     {
-        std::vector<char> vertShaderCode;
-        if (!readFile("X:\\goboVkTriangle\\code\\src\\vert.spv", vertShaderCode))
+        PROFILE_FUNCTION();
+        const ShaderBinary* vertShader = findShader("triangle1.vert");
+        const ShaderBinary* fragShader = findShader("triangle1.frag");
+        if (vertShader == nullptr || fragShader == nullptr)
+        {
+            lerror("Embedded shaders not found!");
+            return false;
+        }
+
+        if (!reflectPipelineLayout(currentShader(*vertShader, m_reloadedVertSpirv),
+                                   currentShader(*fragShader, m_reloadedFragSpirv),
+                                   m_pipelineLayout,
+                                   &m_descriptorSetLayouts))
+        {
+            return false;
+        }
+
+        const auto pipelineStart = std::chrono::steady_clock::now();
+        if (!buildGraphicsPipeline(currentShader(*vertShader, m_reloadedVertSpirv),
+                                   currentShader(*fragShader, m_reloadedFragSpirv),
+                                   pipelineVariantKey(0),
+                                   m_graphicsPipeline))
+        {
+            return false;
+        }
+        const std::chrono::duration<double, std::milli> pipelineTime =
+            std::chrono::steady_clock::now() - pipelineStart;
+        linfo("Graphics pipeline created in {:.3f} ms ({} bytes of pipeline cache loaded)",
+              pipelineTime.count(),
+              m_pipelineCache.loadedSize());
+
+        return true;
+    }
+
+    // Derives the pipeline layout from the shaders' resource interfaces and checks their vertex inputs against the
+    // vertex layout the pipelines are built with.
+    bool reflectPipelineLayout(const ShaderBinary& vertShader,
+                               const ShaderBinary& fragShader,
+                               VkPipelineLayout& layout,
+                               std::vector<VkDescriptorSetLayout>* setLayouts = nullptr)
+    {
+        ShaderReflection vertReflection;
+        ShaderReflection fragReflection;
+        if (!reflectSpirv(vertShader.code, vertShader.codeSize / sizeof(uint32_t), vertReflection, "main") ||
+            !reflectSpirv(fragShader.code, fragShader.codeSize / sizeof(uint32_t), fragReflection, "main"))
+        {
+            lerror("Failed to reflect shaders {} and {}!", vertShader.name, fragShader.name);
+            return false;
+        }
+        if (!validateVertexLayout(vertReflection, pipelineVertexLayout()))
+        {
+            return false;
+        }
+        return m_layoutCache.pipelineLayout({&vertReflection, &fragReflection}, layout, setLayouts);
+    }
+
+    // Index of the variant described by key, registering it the first time the key is seen.
+    uint32_t pipelineVariantIndex(const PipelineVariantKey& key)
+    {
+        const auto found = m_variantIndices.find(key);
+        if (found != m_variantIndices.end())
+        {
+            return found->second;
+        }
+        const uint32_t variant = static_cast<uint32_t>(m_variantKeys.size());
+        m_variantIndices.emplace(key, variant);
+        m_variantKeys.push_back(key);
+        return variant;
+    }
+
+    // Queues every variant but the base pipeline, which is already built, on the build threads. Build i of the
+    // service is variant i + 1.
+    void startPipelineVariantBuilds()
+    {
+        if (m_config.pipelineVariants < 2)
+        {
+            return;
+        }
+        for (uint32_t variant = 0; variant < m_config.pipelineVariants; ++variant)
+        {
+            pipelineVariantIndex(pipelineVariantKey(variant));
+        }
+
+        m_pipelineBuilds->init(m_logicalDevice, m_config.pipelineBuildThreads);
+        // Hot reloads may replace the SPIR-V while builds are still queued, they get a copy of their own.
+        const ShaderBinary vertShader = currentShader(*findShader("triangle1.vert"), m_reloadedVertSpirv);
+        const ShaderBinary fragShader = currentShader(*findShader("triangle1.frag"), m_reloadedFragSpirv);
+        const auto vertCode = std::make_shared<const std::vector<uint32_t>>(
+            vertShader.code, vertShader.code + vertShader.codeSize / sizeof(uint32_t));
+        const auto fragCode = std::make_shared<const std::vector<uint32_t>>(
+            fragShader.code, fragShader.code + fragShader.codeSize / sizeof(uint32_t));
+        for (size_t variant = 1; variant < m_variantKeys.size(); ++variant)
+        {
+            const PipelineVariantKey key = m_variantKeys[variant];
+            m_pipelineBuilds->enqueue([this, vertShader, fragShader, vertCode, fragCode, key]() {
+                VkPipeline pipeline = VK_NULL_HANDLE;
+                return buildGraphicsPipeline(currentShader(vertShader, *vertCode),
+                                             currentShader(fragShader, *fragCode),
+                                             key,
+                                             pipeline)
+                           ? pipeline
+                           : VK_NULL_HANDLE;
+            });
+        }
+        if (m_config.waitForPipelines)
+        {
+            m_pipelineBuilds->waitAll();
+        }
+    }
+
+    // Snapshots the pipeline of every variant for recording, variants still being built fall back to the base
+    // pipeline. Returns false when nothing changed since the last snapshot.
+    bool updateVariantPipelines()
+    {
+        const uint32_t finishedCount = m_pipelineBuilds->finishedCount();
+        if (!m_variantPipelines.empty() && m_variantPipelines[0] == m_graphicsPipeline &&
+            finishedCount == m_finishedVariantCount)
+        {
+            return false;
+        }
+
+        m_variantPipelines.assign(std::max<size_t>(1, m_variantKeys.size()), m_graphicsPipeline);
+        for (uint32_t variant = 1; variant < m_variantPipelines.size(); ++variant)
+        {
+            const VkPipeline pipeline = m_pipelineBuilds->pipeline(variant - 1);
+            if (pipeline != VK_NULL_HANDLE)
+            {
+                m_variantPipelines[variant] = pipeline;
+            }
+        }
+        m_finishedVariantCount = finishedCount;
+        return true;
+    }
+
+    // Picks up variants that finished building at the frame boundary. Per frame recording uses them right away,
+    // static command buffers are re-recorded once, when the last one is done.
+    bool applyFinishedVariants()
+    {
+        if (m_config.pipelineVariants < 2 || m_finishedVariantCount == m_pipelineBuilds->pipelineCount())
+        {
+            return true;
+        }
+        if (m_config.recordingMode == RecordingMode::Static && !m_pipelineBuilds->finished())
+        {
+            return true;
+        }
+        if (!updateVariantPipelines() || m_config.recordingMode == RecordingMode::PerFrame)
+        {
+            return true;
+        }
+
+        RetiredPipeline retired;
+        retired.frameNumber = m_frameNumber;
+        if (!rerecordStaticCommandBuffers(retired.commandBuffers))
         {
             return false;
         }
+        m_retiredPipelines.push_back(std::move(retired));
+        return true;
+    }
+
+    // Records fresh static command buffers and hands the previous ones to the caller to retire.
+    bool rerecordStaticCommandBuffers(std::vector<VkCommandBuffer>& retiredCommandBuffers)
+    {
+        if (m_workerPool)
+        {
+            // Secondary command buffers are re-recorded in place, the GPU must be done executing them.
+            waitForSubmittedFrames();
+        }
+        retiredCommandBuffers.swap(m_commandBuffers);
+        return createCommandBuffers();
+    }
+
+    // The embedded shader, or its hot reloaded replacement once there is one.
+    static ShaderBinary currentShader(const ShaderBinary& embedded, const std::vector<uint32_t>& reloaded)
+    {
+        ShaderBinary shader = embedded;
+        if (!reloaded.empty())
+        {
+            shader.code = reloaded.data();
+            shader.codeSize = reloaded.size() * sizeof(uint32_t);
+        }
+        return shader;
+    }
+
+    // Per vertex mesh attributes followed by the per instance attributes.
+    static VertexLayout pipelineVertexLayout()
+    {
+        VertexLayout vertexLayout = Vertex::layout();
+        InstanceData::appendLayout(vertexLayout);
+        return vertexLayout;
+    }
+
+    bool startShaderHotReload()
+    {
+        const std::string sourceDirectory = m_config.shaderSourceDirectory.empty()
+                                                ? std::string(VK_TRIANGLE_SHADER_SOURCE_DIR)
+                                                : m_config.shaderSourceDirectory;
+        return m_shaderHotReloader.start(sourceDirectory,
+                                         {"triangle1.vert", "triangle1.frag"},
+                                         VK_TRIANGLE_GLSLANG_VALIDATOR,
+                                         [this](const std::string& name, std::vector<uint32_t>& spirv) {
+                                             onShaderReloaded(name, spirv);
+                                         });
+    }
+
+    // Runs on the watcher thread. The pipeline is built here through the pipeline cache and only handed to the
+    // render loop, which swaps it in at the next frame boundary.
+    void onShaderReloaded(const std::string& name, std::vector<uint32_t>& spirv)
+    {
+        std::lock_guard<std::mutex> lock(m_pipelineMutex);
+        // The new SPIR-V only becomes current once its pipeline is built, later builds must not pick up a module
+        // that was rejected.
+        std::vector<uint32_t> reloaded;
+        reloaded.swap(spirv);
+        const bool vertex = name == "triangle1.vert";
+        const ShaderBinary vertShader =
+            currentShader(*findShader("triangle1.vert"), vertex ? reloaded : m_reloadedVertSpirv);
+        const ShaderBinary fragShader =
+            currentShader(*findShader("triangle1.frag"), vertex ? m_reloadedFragSpirv : reloaded);
+        // Pipelines are swapped without rebinding descriptor sets, an edit changing the resource interface needs a
+        // restart.
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        if (!reflectPipelineLayout(vertShader, fragShader, layout) || layout != m_pipelineLayout)
+        {
+            lerror("Reloaded {} does not match the pipeline layout, keeping the previous pipeline.", name.c_str());
+            return;
+        }
+
+        const auto pipelineStart = std::chrono::steady_clock::now();
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (!buildGraphicsPipeline(vertShader, fragShader, pipelineVariantKey(0), pipeline))
+        {
+            lerror("Failed to rebuild graphics pipeline for {}, keeping the previous one.", name.c_str());
+            return;
+        }
+        const std::chrono::duration<double, std::milli> pipelineTime =
+            std::chrono::steady_clock::now() - pipelineStart;
+        linfo("Graphics pipeline rebuilt for {} in {:.3f} ms", name.c_str(), pipelineTime.count());
+        (vertex ? m_reloadedVertSpirv : m_reloadedFragSpirv).swap(reloaded);
+
+        // Superseded before the render loop picked it up, it was never used.
+        if (m_pendingPipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(m_logicalDevice, m_pendingPipeline, nullptr);
+        }
+        m_pendingPipeline = pipeline;
+    }
+
+    // Swaps a hot reloaded pipeline in at the frame boundary and rebuilds the variants from the reloaded shaders,
+    // they render with the new base pipeline until then. The replaced pipelines and the static command buffers
+    // recorded with them are retired until the frames in flight using them have completed.
+    bool applyPendingPipeline()
+    {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        RetiredPipeline retired;
+        {
+            // A rebuild in progress is picked up by one of the next frames instead of stalling this one.
+            std::unique_lock<std::mutex> lock(m_pipelineMutex, std::try_to_lock);
+            if (!lock.owns_lock() || m_pendingPipeline == VK_NULL_HANDLE)
+            {
+                return true;
+            }
+            pipeline = m_pendingPipeline;
+            m_pendingPipeline = VK_NULL_HANDLE;
+            if (m_config.pipelineVariants >= 2)
+            {
+                // Builds of the previous shaders that have not started yet are skipped when the service is destroyed.
+                retired.variantBuilds = std::move(m_pipelineBuilds);
+                m_pipelineBuilds.reset(new PipelineBuildService());
+                m_finishedVariantCount = 0;
+                startPipelineVariantBuilds();
+            }
+        }
 
-        std::vector<char> fragShaderCode;
-        if (!readFile("X:\\goboVkTriangle\\code\\src\\frag.spv", fragShaderCode))
+        retired.pipeline = m_graphicsPipeline;
+        retired.frameNumber = m_frameNumber;
+        m_graphicsPipeline = pipeline;
+        updateVariantPipelines();
+        if (m_config.recordingMode == RecordingMode::Static && !rerecordStaticCommandBuffers(retired.commandBuffers))
         {
             return false;
         }
+        m_retiredPipelines.push_back(std::move(retired));
+        return true;
+    }
+
+    void releaseRetiredPipelines(bool deviceIdle)
+    {
+        const uint64_t completedFrames = deviceIdle ? m_frameNumber : completedFrameCount();
+        while (!m_retiredPipelines.empty())
+        {
+            RetiredPipeline& retired = m_retiredPipelines.front();
+            if (completedFrames < retired.frameNumber)
+            {
+                break;
+            }
+
+            if (!retired.commandBuffers.empty())
+            {
+                vkFreeCommandBuffers(m_logicalDevice,
+                                     m_commandPool,
+                                     static_cast<uint32_t>(retired.commandBuffers.size()),
+                                     retired.commandBuffers.data());
+            }
+            vkDestroyPipeline(m_logicalDevice, retired.pipeline, nullptr);
+            // Waits for a build of the replaced shaders that is still running.
+            retired.variantBuilds.reset();
+            m_retiredPipelines.pop_front();
+        }
+    }
 
+    // Only reads the render pass, the pipeline layout and the pipeline cache, which Vulkan synchronizes
+    // internally, so pipelines can be built on any thread.
+    bool buildGraphicsPipeline(const ShaderBinary& vertShader,
+                               const ShaderBinary& fragShader,
+                               const PipelineVariantKey& variant,
+                               VkPipeline& pipeline) const
+    {
         VkShaderModule vertShaderModule;
         VkShaderModule fragShaderModule;
 
-        if (!createShaderModule(vertShaderCode, vertShaderModule))
+        if (!createShaderModule(vertShader, vertShaderModule))
         {
             return false;
         }
-        if (!createShaderModule(fragShaderCode, fragShaderModule))
+        if (!createShaderModule(fragShader, fragShaderModule))
         {
+            vkDestroyShaderModule(m_logicalDevice, vertShaderModule, nullptr);
             return false;
         }
-        ldebug("Shader modules created!");
+
+        // Every stage sees all constants, ids a shader does not declare are ignored.
+        VkSpecializationMapEntry specializationEntries[PipelineVariantKey::kMaxSpecializationConstants];
+        for (uint32_t i = 0; i < PipelineVariantKey::kMaxSpecializationConstants; ++i)
+        {
+            specializationEntries[i].constantID = i;
+            specializationEntries[i].offset = i * sizeof(uint32_t);
+            specializationEntries[i].size = sizeof(uint32_t);
+        }
+        VkSpecializationInfo specializationInfo = {};
+        specializationInfo.mapEntryCount = PipelineVariantKey::kMaxSpecializationConstants;
+        specializationInfo.pMapEntries = specializationEntries;
+        specializationInfo.dataSize = sizeof(variant.specializationConstants);
+        specializationInfo.pData = variant.specializationConstants;
 
         VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
         vertShaderStageInfo.module = vertShaderModule;
         vertShaderStageInfo.pName = "main";
+        vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
         VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         fragShaderStageInfo.module = fragShaderModule;
         fragShaderStageInfo.pName = "main";
+        fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
         VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 0;
-        vertexInputInfo.pVertexBindingDescriptions = nullptr;
-        vertexInputInfo.vertexAttributeDescriptionCount = 0;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+        const VertexLayout vertexLayout = pipelineVertexLayout();
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = vertexLayout.createInfo();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float) m_swapchainExtent.width;
-        viewport.height = (float) m_swapchainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-
-        VkRect2D scissor = {};
-        scissor.offset = {0, 0};
-        scissor.extent = m_swapchainExtent;
-
+        // Viewport and scissor are dynamic, so the pipeline survives swap chain recreation.
         VkPipelineViewportStateCreateInfo viewportState = {};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1;
-        viewportState.pViewports = &viewport;
+        viewportState.pViewports = nullptr;
         viewportState.scissorCount = 1;
-        viewportState.pScissors = &scissor;
+        viewportState.pScissors = nullptr;
+
+        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamicState = {};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
 
         VkPipelineRasterizationStateCreateInfo rasterizer = {};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -733,6 +1290,17 @@ private:
         colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
         colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
         colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        if (variant.blendMode == BlendMode::Alpha)
+        {
+            colorBlendAttachment.blendEnable = VK_TRUE;
+            colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        }
+        else if (variant.blendMode == BlendMode::Additive)
+        {
+            colorBlendAttachment.blendEnable = VK_TRUE;
+            colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        }
 
         VkPipelineColorBlendStateCreateInfo colorBlending = {};
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -745,18 +1313,6 @@ private:
         colorBlending.blendConstants[2] = 0.0f;
         colorBlending.blendConstants[3] = 0.0f;
 
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 0;
-        pipelineLayoutInfo.pSetLayouts = nullptr;
-        pipelineLayoutInfo.pushConstantRangeCount = 0;
-        pipelineLayoutInfo.pPushConstantRanges = 0;
-        if (vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS)
-        {
-            lerror("Failed to create pipeline layout!");
-            return false;
-        }
-
         VkGraphicsPipelineCreateInfo pipelineInfo = {};
         pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineInfo.stageCount = 2;
@@ -768,34 +1324,39 @@ private:
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pDepthStencilState = nullptr;
         pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr;
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = m_pipelineLayout;
         pipelineInfo.renderPass = m_renderPass;
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex = -1;
 
-        if (vkCreateGraphicsPipelines(m_logicalDevice,
-                                      VK_NULL_HANDLE,
-                                      1,
-                                      &pipelineInfo,
-                                      nullptr,
-                                      &m_graphicsPipeline) != VK_SUCCESS)
-        {
-            lerror("Failed to create graphics pipeline!");
-            return false;
-        }
-        ldebug("Graphics pipeline created!");
+        const VkResult result =
+            vkCreateGraphicsPipelines(m_logicalDevice, m_pipelineCache.handle(), 1, &pipelineInfo, nullptr, &pipeline);
 
+        // Pipelines do not reference their modules after creation.
         vkDestroyShaderModule(m_logicalDevice, vertShaderModule, nullptr);
         vkDestroyShaderModule(m_logicalDevice, fragShaderModule, nullptr);
-        ldebug("Shader modules cleaned up.");
 
+        if (result != VK_SUCCESS)
+        {
+            lerror("Failed to create graphics pipeline!");
+            return false;
+        }
         return true;
     }
 
+    bool createPipelineCache()
+    {
+        PROFILE_FUNCTION();
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+        return m_pipelineCache.create(m_logicalDevice, deviceProperties, m_config.pipelineCachePath);
+    }
+
     bool createFramebuffers()
     {
+        PROFILE_FUNCTION();
         m_swapchainFramebuffers.resize(m_swapchainImageViews.size());
         for (size_t i = 0; i < m_swapchainImageViews.size(); ++i)
         {
@@ -823,6 +1384,7 @@ private:
 
     bool createCommandPool()
     {
+        PROFILE_FUNCTION();
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily;
@@ -837,73 +1399,646 @@ private:
         return true;
     }
 
-    bool createCommandBuffers()
+    bool createGeometryBuffers()
     {
-        m_commandBuffers.resize(m_swapchainFramebuffers.size());
-        VkCommandBufferAllocateInfo buffAllocInfo = {};
-        buffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        buffAllocInfo.commandPool = m_commandPool;
-        buffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        buffAllocInfo.commandBufferCount = (uint32_t) m_commandBuffers.size();
-
-        if (vkAllocateCommandBuffers(m_logicalDevice, &buffAllocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+        PROFILE_FUNCTION();
+        MeshData meshData;
+        meshData.vertices = {{{0.0f, -0.5f}, {1.0f, 0.0f, 0.0f}},
+                             {{0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}},
+                             {{-0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}};
+        meshData.indices = {0, 1, 2};
+        // The model matrix only rotates, a circle around the origin bounds the mesh at any angle.
+        m_meshRadius = 0.0f;
+        for (const Vertex& vertex : meshData.vertices)
         {
-            lerror("Failed to allocate command buffer!");
-            return false;
+            m_meshRadius = std::max(m_meshRadius, glm::length(vertex.position));
         }
 
-        for (size_t i = 0; i < m_commandBuffers.size(); ++i)
-        {
-            VkCommandBufferBeginInfo beginInfo = {};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-            beginInfo.pInheritanceInfo = nullptr;
-
-            vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo);
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = m_renderPass;
-            renderPassInfo.framebuffer = m_swapchainFramebuffers[i];
-            renderPassInfo.renderArea.offset = {0, 0};
-            renderPassInfo.renderArea.extent = m_swapchainExtent;
-
-            VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
-            renderPassInfo.clearValueCount = 1;
-            renderPassInfo.pClearValues = &clearColor;
-
-            vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-            vkCmdDraw(m_commandBuffers[i], 3, 1, 0, 0);
-            vkCmdEndRenderPass(m_commandBuffers[i]);
-
-            if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS)
+        return uploadMesh(meshData, m_mesh);
+    }
+
+    bool uploadMesh(const MeshData& meshData, GpuMesh& mesh)
+    {
+        const VkDeviceSize vertexBufferSize = sizeof(Vertex) * meshData.vertices.size();
+        const VkDeviceSize indexBufferSize = sizeof(uint32_t) * meshData.indices.size();
+
+        if (!m_allocator.createBuffer(vertexBufferSize,
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                      mesh.vertexBuffer,
+                                      mesh.vertexAllocation))
+        {
+            lerror("Failed to create mesh vertex buffer!");
+            return false;
+        }
+        if (!m_allocator.createBuffer(indexBufferSize,
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                      mesh.indexBuffer,
+                                      mesh.indexAllocation))
+        {
+            lerror("Failed to create mesh index buffer!");
+            m_allocator.destroyBuffer(mesh.vertexBuffer, mesh.vertexAllocation);
+            return false;
+        }
+        mesh.indexCount = static_cast<uint32_t>(meshData.indices.size());
+
+        m_stagingUploader.enqueue(meshData.vertices.data(), vertexBufferSize, mesh.vertexBuffer);
+        m_stagingUploader.enqueue(meshData.indices.data(), indexBufferSize, mesh.indexBuffer);
+        if (!m_stagingUploader.flush())
+        {
+            lerror("Failed to upload mesh!");
+            destroyMesh(mesh);
+            return false;
+        }
+
+        ldebug("Mesh uploaded, {} vertices, {} indices.", meshData.vertices.size(), meshData.indices.size());
+        return true;
+    }
+
+    bool createInstanceBuffer()
+    {
+        PROFILE_FUNCTION();
+        m_instanceCount = std::max(1u, m_config.instanceCount);
+        m_instancesPerDraw = m_config.instancesPerDraw > 0 ? std::min(m_config.instancesPerDraw, m_instanceCount)
+                                                           : m_instanceCount;
+        m_drawCount = (m_instanceCount + m_instancesPerDraw - 1) / m_instancesPerDraw;
+
+        // Square grid over clip space, each instance scaled to fit its cell.
+        const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_instanceCount))));
+        const float cellSize = 2.0f / columns;
+        std::vector<InstanceData> instances(m_instanceCount);
+        for (uint32_t i = 0; i < m_instanceCount; ++i)
+        {
+            InstanceData& instance = instances[i];
+            instance.offset = {-1.0f + (i % columns + 0.5f) * cellSize, -1.0f + (i / columns + 0.5f) * cellSize};
+            instance.scale = cellSize;
+            instance.padding = 0.0f;
+            instance.color = {0.5f + 0.5f * std::sin(i * 0.37f), 0.5f + 0.5f * std::sin(i * 0.71f + 2.0f), 1.0f, 1.0f};
+        }
+
+        const VkDeviceSize bufferSize = sizeof(InstanceData) * instances.size();
+        if (!m_allocator.createBuffer(bufferSize,
+                                      VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                      m_instanceBuffer,
+                                      m_instanceAllocation))
+        {
+            lerror("Failed to create instance buffer!");
+            return false;
+        }
+
+        // Uploaded together with the instances, the enqueued data has to outlive the flush or submit.
+        std::vector<glm::vec4> drawBounds;
+        if (m_config.gpuCulling && !createGpuCuller(instances, drawBounds))
+        {
+            // Like a device without the culling features: the CPU side draws stay correct, just unculled.
+            lerror("GPU culling could not be set up, drawing without it.");
+            m_gpuCuller.destroy();
+            m_config.gpuCulling = false;
+        }
+
+        if (m_config.blockingUploads)
+        {
+            m_stagingUploader.enqueue(instances.data(), bufferSize, m_instanceBuffer);
+            if (m_config.gpuCulling)
+            {
+                m_stagingUploader.enqueue(
+                    drawBounds.data(), sizeof(glm::vec4) * drawBounds.size(), m_gpuCuller.boundsBuffer());
+            }
+            if (!m_stagingUploader.flush())
             {
-                lerror("Failed to record command buffer!");
+                lerror("Failed to upload instance data!");
                 return false;
             }
         }
+        else
+        {
+            // The first frame waits for the copy on the GPU, startup carries on meanwhile.
+            m_uploadStreamer.enqueue(instances.data(), bufferSize, m_instanceBuffer);
+            if (m_config.gpuCulling)
+            {
+                m_uploadStreamer.enqueue(
+                    drawBounds.data(), sizeof(glm::vec4) * drawBounds.size(), m_gpuCuller.boundsBuffer());
+            }
+            if (!m_uploadStreamer.submit())
+            {
+                lerror("Failed to stream instance data!");
+                return false;
+            }
+        }
+
+        ldebug("Instance buffer created for {} instances.", m_instanceCount);
+        return true;
+    }
+
+    // Creates the culler for m_drawCount draws and fills drawBounds with the sphere of every draw, the circle
+    // enclosing the circles of its instances in the z = 0 plane.
+    bool createGpuCuller(const std::vector<InstanceData>& instances, std::vector<glm::vec4>& drawBounds)
+    {
+        const ShaderBinary* cullShader = findShader("cull.comp");
+        if (cullShader == nullptr)
+        {
+            lerror("Culling shader missing from the shader registry!");
+            return false;
+        }
+        const uint32_t maxGroupCount =
+            std::min(m_drawCount, kTintCount * std::max(1u, m_config.pipelineVariants));
+        if (!m_gpuCuller.init(m_allocator,
+                              m_logicalDevice,
+                              m_layoutCache,
+                              m_pipelineCache.handle(),
+                              *cullShader,
+                              m_drawCount,
+                              maxGroupCount,
+                              m_uniformRing.sliceCount(),
+                              m_drawIndirectCount))
+        {
+            return false;
+        }
+
+        drawBounds.resize(m_drawCount);
+        for (uint32_t draw = 0; draw < m_drawCount; ++draw)
+        {
+            const uint32_t first = draw * m_instancesPerDraw;
+            const uint32_t last = std::min(first + m_instancesPerDraw, m_instanceCount);
+            glm::vec2 lower = instances[first].offset;
+            glm::vec2 upper = lower;
+            for (uint32_t i = first; i < last; ++i)
+            {
+                lower = glm::min(lower, instances[i].offset);
+                upper = glm::max(upper, instances[i].offset);
+            }
+            const glm::vec2 center = 0.5f * (lower + upper);
+            float radius = 0.0f;
+            for (uint32_t i = first; i < last; ++i)
+            {
+                radius = std::max(radius,
+                                  glm::length(instances[i].offset - center) + m_meshRadius * instances[i].scale);
+            }
+            drawBounds[draw] = glm::vec4(center, 0.0f, radius);
+        }
+        return true;
+    }
+
+    // Indirect draws of the culling pass: group g holds the visible draws of variant g % variantCount and tint
+    // g % kTintCount, which are the draws d with d % groupCount == g, like the draws of recordDraws().
+    uint32_t cullGroupCount() const
+    {
+        const uint32_t variantCount = static_cast<uint32_t>(m_variantPipelines.size());
+        uint32_t groupCount = kTintCount;
+        while (groupCount % variantCount != 0)
+        {
+            groupCount += kTintCount;
+        }
+        return std::min(groupCount, m_drawCount);
+    }
+
+    glm::mat4 viewProjection() const
+    {
+        return glm::scale(glm::mat4(1.0f), glm::vec3(m_config.zoom, m_config.zoom, 1.0f));
+    }
+
+    // Frame slots a recorded command buffer can be tied to: per frame recording uses one per frame in flight, static
+    // command buffers one per swap chain image. Both index the uniform ring slices, GPU profiler ranges and transient
+    // images of the frame graph.
+    uint32_t frameSlotCount() const
+    {
+        return m_config.recordingMode == RecordingMode::PerFrame ? m_config.maxFramesInFlight
+                                                                 : static_cast<uint32_t>(m_swapchainImages.size());
+    }
+
+    // The uniform ring with a slice per frame slot and the descriptor set every draw binds it through.
+    bool createFrameUniforms()
+    {
+        PROFILE_FUNCTION();
+        if (m_descriptorSetLayouts.empty())
+        {
+            lerror("triangle1.vert declares no frame uniforms!");
+            return false;
+        }
+
+        if (!createUniformRing(frameSlotCount()))
+        {
+            return false;
+        }
+
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSize.descriptorCount = 1;
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        if (vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+        {
+            lerror("Failed to create descriptor pool!");
+            return false;
+        }
+
+        VkDescriptorSetAllocateInfo setAllocInfo = {};
+        setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setAllocInfo.descriptorPool = m_descriptorPool;
+        setAllocInfo.descriptorSetCount = 1;
+        setAllocInfo.pSetLayouts = &m_descriptorSetLayouts[0];
+        if (vkAllocateDescriptorSets(m_logicalDevice, &setAllocInfo, &m_frameDescriptorSet) != VK_SUCCESS)
+        {
+            lerror("Failed to allocate frame descriptor set!");
+            return false;
+        }
+
+        writeFrameDescriptorSet();
+
+        ldebug("Frame uniforms created for {} frame slots.", m_uniformRing.sliceCount());
+        return true;
+    }
+
+    bool createUniformRing(uint32_t sliceCount)
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+        return m_uniformRing.init(
+            m_allocator, sizeof(FrameUniforms), sliceCount, deviceProperties.limits.minUniformBufferOffsetAlignment);
+    }
+
+    // Written once per uniform ring, the slice is picked by the dynamic offset at bind time.
+    void writeFrameDescriptorSet()
+    {
+        VkDescriptorBufferInfo bufferInfo = {};
+        bufferInfo.buffer = m_uniformRing.buffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = m_uniformRing.sliceSize();
+        VkWriteDescriptorSet descriptorWrite = {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = m_frameDescriptorSet;
+        descriptorWrite.dstBinding = 0;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptorWrite.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(m_logicalDevice, 1, &descriptorWrite, 0, nullptr);
+    }
+
+    // Static command buffers own the frame slot of their swap chain image, a recreated swap chain with more images
+    // needs more uniform ring slices, culling commands, profiler ranges and frame graph images. Waits for the
+    // submitted frames, which still use the old ones.
+    bool growFrameSlots()
+    {
+        const uint32_t slotCount = frameSlotCount();
+        if (slotCount <= m_uniformRing.sliceCount())
+        {
+            return true;
+        }
+        waitForSubmittedFrames();
 
-        ldebug("Command buffers created!");
+        m_uniformRing.destroy();
+        if (!createUniformRing(slotCount))
+        {
+            return false;
+        }
+        writeFrameDescriptorSet();
+        if (m_config.gpuCulling && !m_gpuCuller.resizeSlots(slotCount))
+        {
+            return false;
+        }
+        if (slotCount > m_graphExecutor.slotCount() && !m_graphExecutor.resizeSlots(slotCount))
+        {
+            return false;
+        }
+        if (m_gpuProfiler.enabled())
+        {
+            // The statistics survive, only the query ranges are replaced.
+            m_gpuProfiler.collectAll();
+            m_gpuProfiler.destroy();
+            m_gpuProfiler.init(m_physicalDevice,
+                               m_logicalDevice,
+                               static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily),
+                               slotCount);
+        }
+        ldebug("Frame slots grown to {}.", slotCount);
         return true;
     }
 
-    bool createSemaphores()
+    // Writes the uniforms of the frame about to be submitted into the slice of slot.
+    void updateFrameUniforms(uint32_t slot)
+    {
+        const std::chrono::duration<float> time = std::chrono::steady_clock::now() - m_runStart;
+        FrameUniforms uniforms;
+        uniforms.model = glm::rotate(glm::mat4(1.0f), time.count(), glm::vec3(0.0f, 0.0f, 1.0f));
+        uniforms.viewProjection = viewProjection();
+        m_uniformRing.write(slot, &uniforms, sizeof(uniforms));
+    }
+
+    void destroyMesh(GpuMesh& mesh)
     {
+        m_allocator.destroyBuffer(mesh.vertexBuffer, mesh.vertexAllocation);
+        m_allocator.destroyBuffer(mesh.indexBuffer, mesh.indexAllocation);
+        mesh = GpuMesh();
+    }
+
+    bool createCommandBuffers()
+    {
+        PROFILE_FUNCTION();
+        if (m_config.recordingMode == RecordingMode::PerFrame)
+        {
+            // Recorded in drawFrame(), nothing to prepare per swap chain image.
+            return true;
+        }
+
+        // Every image's command buffer binds its own uniform ring slice.
+        if (m_swapchainFramebuffers.size() > m_uniformRing.sliceCount())
+        {
+            lerror("Swap chain grew to {} images, the uniform ring has {} slices!",
+                   m_swapchainFramebuffers.size(),
+                   m_uniformRing.sliceCount());
+            return false;
+        }
+
+        const auto recordStart = std::chrono::steady_clock::now();
+        m_commandBuffers.resize(m_swapchainFramebuffers.size());
+        VkCommandBufferAllocateInfo buffAllocInfo = {};
+        buffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        buffAllocInfo.commandPool = m_commandPool;
+        buffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        buffAllocInfo.commandBufferCount = (uint32_t) m_commandBuffers.size();
+
+        if (vkAllocateCommandBuffers(m_logicalDevice, &buffAllocInfo, m_commandBuffers.data()) != VK_SUCCESS)
+        {
+            lerror("Failed to allocate command buffer!");
+            return false;
+        }
+
+        for (size_t i = 0; i < m_commandBuffers.size(); ++i)
+        {
+            if (!recordCommandBuffer(m_commandBuffers[i],
+                                     static_cast<uint32_t>(i),
+                                     VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+                                     static_cast<uint32_t>(i)))
+            {
+                return false;
+            }
+        }
+
+        const std::chrono::duration<double, std::milli> recordTime = std::chrono::steady_clock::now() - recordStart;
+        linfo("Command buffers recorded: {} draws each, {} recording threads, {:.3f} ms",
+              m_drawCount,
+              m_workerPool ? m_workerPool->threadCount() : 0,
+              recordTime.count());
+        return true;
+    }
+
+    // One primary command buffer and transient pool per frame slot, the pool is reset as a whole before the slot
+    // records its next frame.
+    bool createFrameCommandPools()
+    {
+        PROFILE_FUNCTION();
+        m_frameCommandPools.resize(m_config.maxFramesInFlight, VK_NULL_HANDLE);
+        m_frameCommandBuffers.resize(m_config.maxFramesInFlight, VK_NULL_HANDLE);
+        for (uint32_t i = 0; i < m_config.maxFramesInFlight; ++i)
+        {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.queueFamilyIndex = m_queueFamilyIndices.graphicsFamily;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            if (vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &m_frameCommandPools[i]) != VK_SUCCESS)
+            {
+                lerror("Failed to create frame command pool!");
+                return false;
+            }
+
+            VkCommandBufferAllocateInfo buffAllocInfo = {};
+            buffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            buffAllocInfo.commandPool = m_frameCommandPools[i];
+            buffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            buffAllocInfo.commandBufferCount = 1;
+            if (vkAllocateCommandBuffers(m_logicalDevice, &buffAllocInfo, &m_frameCommandBuffers[i]) != VK_SUCCESS)
+            {
+                lerror("Failed to allocate frame command buffer!");
+                return false;
+            }
+        }
+
+        ldebug("Frame command pools created.");
+        return true;
+    }
+
+    // Records the render pass into the framebuffer of imageIndex. slot selects the secondary command buffers of the
+    // worker recorder and the GPU profiler query range, it must not be in use by a pending submission.
+    bool recordCommandBuffer(VkCommandBuffer commandBuffer,
+                             uint32_t imageIndex,
+                             VkCommandBufferUsageFlags usage,
+                             uint32_t slot)
+    {
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = usage;
+        beginInfo.pInheritanceInfo = nullptr;
+
+        vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        m_gpuProfiler.beginRange(commandBuffer, slot);
+        if (m_config.gpuCulling)
+        {
+            GpuProfileScope cullScope(m_gpuProfiler, commandBuffer, slot, "culling");
+            CullDispatch dispatch;
+            dispatch.viewProjection = viewProjection();
+            dispatch.groupCount = cullGroupCount();
+            dispatch.instancesPerDraw = m_instancesPerDraw;
+            dispatch.instanceCount = m_instanceCount;
+            dispatch.indexCount = m_mesh.indexCount;
+            m_gpuCuller.recordCulling(commandBuffer, slot, dispatch);
+        }
+        const uint32_t renderPassScope = m_gpuProfiler.beginScope(commandBuffer, slot, "render pass");
+        m_graphImages[m_backbufferResource] = m_swapchainImages[imageIndex];
+        m_graphExecutor.recordBarriers(commandBuffer, slot, m_frameGraph.barriersBefore(0), m_graphImages);
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_renderPass;
+        renderPassInfo.framebuffer = m_swapchainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = {0, 0};
+        renderPassInfo.renderArea.extent = m_swapchainExtent;
+
+        VkClearValue clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
+        renderPassInfo.clearValueCount = 1;
+        renderPassInfo.pClearValues = &clearColor;
+
+        // The culled draws are a handful of indirect draws, not worth spreading over the recording threads.
+        if (m_workerPool && !m_config.gpuCulling)
+        {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+            VkCommandBufferInheritanceInfo inheritanceInfo = {};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.renderPass = m_renderPass;
+            inheritanceInfo.subpass = 0;
+            inheritanceInfo.framebuffer = m_swapchainFramebuffers[imageIndex];
+            const auto recordFunction = [this, slot](VkCommandBuffer secondary, uint32_t first, uint32_t count) {
+                recordDraws(secondary, slot, first, count);
+            };
+            if (!m_commandRecorder.record(slot, commandBuffer, inheritanceInfo, usage, m_drawCount, recordFunction))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            GpuProfileScope drawScope(m_gpuProfiler, commandBuffer, slot, "draws");
+            if (m_config.gpuCulling)
+            {
+                recordCulledDraws(commandBuffer, slot);
+            }
+            else
+            {
+                recordDraws(commandBuffer, slot, 0, m_drawCount);
+            }
+        }
+        vkCmdEndRenderPass(commandBuffer);
+        m_graphExecutor.recordBarriers(commandBuffer, slot, m_frameGraph.finalBarriers(), m_graphImages);
+        m_gpuProfiler.endScope(commandBuffer, slot, renderPassScope);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        {
+            lerror("Failed to record command buffer!");
+            return false;
+        }
+        return true;
+    }
+
+    // Records draws [firstDraw, firstDraw + drawCount) with all the state they need, so it works for primary and
+    // secondary command buffers alike. Every draw covers up to m_instancesPerDraw instances. The frame uniforms are
+    // read from the uniform ring slice of slot.
+    void recordDraws(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t firstDraw, uint32_t drawCount)
+    {
+        const uint32_t variantCount = static_cast<uint32_t>(m_variantPipelines.size());
+        VkPipeline boundPipeline = m_variantPipelines[firstDraw % variantCount];
+        bindDrawState(commandBuffer, slot, boundPipeline);
+        for (uint32_t draw = firstDraw; draw < firstDraw + drawCount; ++draw)
+        {
+            // Draws cycle through the pipeline variants, consecutive draws of one variant share the binding.
+            const VkPipeline pipeline = m_variantPipelines[draw % variantCount];
+            if (pipeline != boundPipeline)
+            {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = pipeline;
+            }
+            pushTint(commandBuffer, draw % kTintCount);
+            const uint32_t firstInstance = draw * m_instancesPerDraw;
+            const uint32_t instanceCount = std::min(m_instancesPerDraw, m_instanceCount - firstInstance);
+            vkCmdDrawIndexed(commandBuffer, m_mesh.indexCount, instanceCount, 0, 0, firstInstance);
+        }
+    }
+
+    // Records the draws the culling pass of slot left visible, one indirect draw per group of cullGroupCount().
+    void recordCulledDraws(VkCommandBuffer commandBuffer, uint32_t slot)
+    {
+        const uint32_t variantCount = static_cast<uint32_t>(m_variantPipelines.size());
+        const uint32_t groupCount = cullGroupCount();
+        VkPipeline boundPipeline = m_variantPipelines[0];
+        bindDrawState(commandBuffer, slot, boundPipeline);
+        for (uint32_t group = 0; group < groupCount; ++group)
+        {
+            const VkPipeline pipeline = m_variantPipelines[group % variantCount];
+            if (pipeline != boundPipeline)
+            {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPipeline = pipeline;
+            }
+            pushTint(commandBuffer, group % kTintCount);
+            m_gpuCuller.recordDraw(commandBuffer, slot, groupCount, group);
+        }
+    }
+
+    // Binds pipeline and the state shared by every draw of the frame slot.
+    void bindDrawState(VkCommandBuffer commandBuffer, uint32_t slot, VkPipeline pipeline)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        // All variants share the pipeline layout, the set stays bound across pipeline switches.
+        const uint32_t dynamicOffset = m_uniformRing.dynamicOffset(slot);
+        vkCmdBindDescriptorSets(commandBuffer,
+                                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                m_pipelineLayout,
+                                0,
+                                1,
+                                &m_frameDescriptorSet,
+                                1,
+                                &dynamicOffset);
+
+        VkViewport viewport = {};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float) m_swapchainExtent.width;
+        viewport.height = (float) m_swapchainExtent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor = {};
+        scissor.offset = {0, 0};
+        scissor.extent = m_swapchainExtent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkBuffer vertexBuffers[] = {m_mesh.vertexBuffer, m_instanceBuffer};
+        VkDeviceSize vertexOffsets[] = {0, 0};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, vertexOffsets);
+        vkCmdBindIndexBuffer(commandBuffer, m_mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    void pushTint(VkCommandBuffer commandBuffer, uint32_t tint)
+    {
+        // Small per draw data goes through push constants, no buffer update needed.
+        DrawConstants drawConstants;
+        const float shade = 1.0f - 0.25f * static_cast<float>(tint);
+        drawConstants.tint = glm::vec4(shade, shade, shade, 1.0f);
+        vkCmdPushConstants(
+            commandBuffer, m_pipelineLayout, kDrawConstantStages, 0, sizeof(drawConstants), &drawConstants);
+    }
+
+    bool createSyncObjects()
+    {
+        PROFILE_FUNCTION();
+        m_imageAvailableSemaphores.resize(m_config.maxFramesInFlight);
+        m_renderFinishedSemaphores.resize(m_config.maxFramesInFlight);
+        m_inFlightFences.resize(m_config.maxFramesInFlight, VK_NULL_HANDLE);
+        m_imagesInFlight.resize(m_swapchainImages.size(), VK_NULL_HANDLE);
+        m_imageFrameValues.resize(m_swapchainImages.size(), 0);
+
         VkSemaphoreCreateInfo semaphoreInfo = {};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphore) != VK_SUCCESS ||
-            vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphore) != VK_SUCCESS)
+
+        // Fences start signaled, so the first wait on each frame slot returns immediately.
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+        // Frame n signals n + 1 on the timeline, it replaces the slot fences. Acquire and present still need the
+        // binary semaphores.
+        const bool timeline = m_config.syncMode == SyncMode::Timeline;
+        if (timeline && !m_frameTimeline.init(m_logicalDevice))
         {
-            lerror("Failed to create the semaphores.");
             return false;
         }
 
-        ldebug("Semaphores created!");
+        for (uint32_t i = 0; i < m_config.maxFramesInFlight; ++i)
+        {
+            if (vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) !=
+                    VK_SUCCESS ||
+                vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) !=
+                    VK_SUCCESS ||
+                (!timeline && vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS))
+            {
+                lerror("Failed to create the synchronization objects for frame {}.", i);
+                return false;
+            }
+        }
+
+        ldebug("Synchronization objects created for {} frames in flight!", m_config.maxFramesInFlight);
         return true;
     }
 
     bool initVulkan()
     {
+        PROFILE_FUNCTION();
 #ifndef NDEBUG
         m_enableValidationLayers = true;
 #endif
@@ -953,7 +2088,10 @@ private:
             return false;
         }
         setupDebugCallback();
-        createSurface();
+        if (!m_config.headless && !createSurface())
+        {
+            return false;
+        }
 
         uint32_t extensionCount = 0;
         vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -971,55 +2109,323 @@ private:
             return false;
         }
 
-        createLogicalDevice();
+        if (!createLogicalDevice() || !m_allocator.init(m_physicalDevice, m_logicalDevice))
+        {
+            return false;
+        }
+        m_graphExecutor.init(m_logicalDevice, m_allocator);
+        // The frame uniforms are bound with dynamic offsets into the uniform ring.
+        m_layoutCache.init(m_logicalDevice, true);
         vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.graphicsFamily, 0, &m_graphicsQueue);
         vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.presentFamily, 0, &m_presentQueue);
-        createSwapChain(m_windowWidth, m_windowHeight);
-        createSwapChainImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
-        createCommandPool();
-        createCommandBuffers();
-        createSemaphores();
+        m_transferQueue = m_graphicsQueue;
+        if (m_queueFamilyIndices.transferFamily >= 0)
+        {
+            vkGetDeviceQueue(m_logicalDevice, m_queueFamilyIndices.transferFamily, 0, &m_transferQueue);
+        }
+        const bool targetsCreated = m_config.headless ? createOffscreenTargets(m_config.width, m_config.height)
+                                                      : createSwapChain(m_windowWidth, m_windowHeight);
+        if (!targetsCreated || !createSwapChainImageViews() || !createRenderPass())
+        {
+            return false;
+        }
+        // Without a cache the pipelines are still built, only slower.
+        createPipelineCache();
+        if (!createGraphicsPipeline())
+        {
+            return false;
+        }
+        startPipelineVariantBuilds();
+        updateVariantPipelines();
+        if (!createFramebuffers() || !createCommandPool() || !createFrameUniforms())
+        {
+            return false;
+        }
+        if (!m_stagingUploader.init(m_allocator,
+                                    m_logicalDevice,
+                                    m_graphicsQueue,
+                                    static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily),
+                                    m_config.syncMode == SyncMode::Timeline))
+        {
+            return false;
+        }
+        const int uploadFamily = m_queueFamilyIndices.transferFamily >= 0 ? m_queueFamilyIndices.transferFamily
+                                                                           : m_queueFamilyIndices.graphicsFamily;
+        if (!m_uploadStreamer.init(m_allocator,
+                                   m_logicalDevice,
+                                   m_transferQueue,
+                                   static_cast<uint32_t>(uploadFamily),
+                                   static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily)))
+        {
+            return false;
+        }
+        if (!createGeometryBuffers() || !createInstanceBuffer())
+        {
+            return false;
+        }
+        if (m_config.recordingThreads > 0)
+        {
+            m_workerPool.reset(new WorkerPool(m_config.recordingThreads));
+            if (!m_commandRecorder.init(m_logicalDevice,
+                                        static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily),
+                                        *m_workerPool,
+                                        m_config.recordingMode == RecordingMode::PerFrame
+                                            ? VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
+                                            : 0))
+            {
+                return false;
+            }
+        }
+        if (m_config.recordingMode == RecordingMode::PerFrame && !createFrameCommandPools())
+        {
+            return false;
+        }
+        if (m_config.gpuProfiling && !m_gpuProfiler.init(m_physicalDevice,
+                                                          m_logicalDevice,
+                                                          static_cast<uint32_t>(m_queueFamilyIndices.graphicsFamily),
+                                                          frameSlotCount()))
+        {
+            return false;
+        }
+        if (!createCommandBuffers() || !createSyncObjects())
+        {
+            return false;
+        }
+        if (m_config.shaderHotReload && !startShaderHotReload())
+        {
+            // Rendering does not depend on it, keep running with the shaders of the build.
+            lerror("Shader hot reload could not start, continuing without it.");
+            m_config.shaderHotReload = false;
+        }
 
         return true;
     }
 
     bool drawFrame()
     {
-        // Update game state
-        vkQueueWaitIdle(m_presentQueue);
+        PROFILE_FUNCTION();
+        const auto frameStart = std::chrono::steady_clock::now();
+
+        // Only block when the GPU still owns the frame slot we are about to reuse.
+        const bool timeline = m_config.syncMode == SyncMode::Timeline;
+        {
+            PROFILE_ZONE("wait for frame slot");
+            if (timeline)
+            {
+                // The slot was last used by the frame maxFramesInFlight frames back.
+                if (m_frameNumber >= m_config.maxFramesInFlight)
+                {
+                    m_frameTimeline.wait(m_frameNumber - m_config.maxFramesInFlight + 1);
+                }
+            }
+            else
+            {
+                vkWaitForFences(m_logicalDevice,
+                                1,
+                                &m_inFlightFences[m_currentFrame],
+                                VK_TRUE,
+                                std::numeric_limits<uint64_t>::max());
+            }
+        }
+
+        // Offscreen targets are owned by the frame slots, so the slot fence already guards the image.
+        releaseRetiredSwapchains(false);
+        releaseRetiredPipelines(false);
+        m_uploadStreamer.release(completedFrameCount());
+        if (!applyPendingPipeline() || !applyFinishedVariants())
+        {
+            return false;
+        }
+
+        uint32_t imageIndex = m_currentFrame;
+        if (!m_config.headless)
+        {
+            const VkResult acquireResult = vkAcquireNextImageKHR(m_logicalDevice,
+                                                                 m_swapchain,
+                                                                 std::numeric_limits<uint64_t>::max(),
+                                                                 m_imageAvailableSemaphores[m_currentFrame],
+                                                                 VK_NULL_HANDLE,
+                                                                 &imageIndex);
+            if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                // Nothing was submitted for this slot yet, its fence stays signaled for the next attempt.
+                return recreateSwapChain();
+            }
+            if (acquireResult != VK_SUCCESS && acquireResult != VK_SUBOPTIMAL_KHR)
+            {
+                lerror("Failed to acquire swap chain image!");
+                return false;
+            }
+
+            // The swap chain can hand out images out of order, wait for the frame still rendering into this one.
+            if (timeline)
+            {
+                PROFILE_ZONE("wait for image");
+                m_frameTimeline.wait(m_imageFrameValues[imageIndex]);
+                m_imageFrameValues[imageIndex] = m_frameNumber + 1;
+            }
+            else
+            {
+                if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE)
+                {
+                    PROFILE_ZONE("wait for image");
+                    vkWaitForFences(m_logicalDevice,
+                                    1,
+                                    &m_imagesInFlight[imageIndex],
+                                    VK_TRUE,
+                                    std::numeric_limits<uint64_t>::max());
+                }
+                m_imagesInFlight[imageIndex] = m_inFlightFences[m_currentFrame];
+            }
+        }
+
+        const auto stallEnd = std::chrono::steady_clock::now();
 
-        uint32_t imageIndex = 0;
-        vkAcquireNextImageKHR(m_logicalDevice,
-                              m_swapchain,
-                              std::numeric_limits<uint64_t>::max(),
-                              m_imageAvailableSemaphore,
-                              VK_NULL_HANDLE,
-                              &imageIndex);
+        // Static command buffers write the queries and read the uniforms of their image, per frame ones those of
+        // their frame slot. Either way the previous submission using the slot is complete after the waits above.
+        const uint32_t slot = m_config.recordingMode == RecordingMode::PerFrame ? m_currentFrame : imageIndex;
+        m_gpuProfiler.collect(slot);
+        updateFrameUniforms(slot);
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (m_config.recordingMode == RecordingMode::PerFrame)
+        {
+            PROFILE_ZONE("record frame");
+            // The slot fence has signaled, nothing recorded from this pool is pending any more.
+            vkResetCommandPool(m_logicalDevice, m_frameCommandPools[m_currentFrame], 0);
+            commandBuffer = m_frameCommandBuffers[m_currentFrame];
+            if (!recordCommandBuffer(
+                    commandBuffer, imageIndex, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, m_currentFrame))
+            {
+                return false;
+            }
+            m_frameStatistics.totalRecordTime += std::chrono::steady_clock::now() - stallEnd;
+        }
+        else
+        {
+            commandBuffer = m_commandBuffers[imageIndex];
+        }
 
         VkSubmitInfo submitInfo = {};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphore};
+        VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[m_currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        // Presentation waits for the binary semaphore, the timeline counts the frame as done. Binary semaphores
+        // ignore their value.
+        VkSemaphore signalSemaphores[2] = {};
+        uint64_t signalValues[2] = {};
+        uint32_t signalCount = 0;
+        if (!m_config.headless)
+        {
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = waitSemaphores;
+            submitInfo.pWaitDstStageMask = waitStages;
+            signalSemaphores[signalCount++] = m_renderFinishedSemaphores[m_currentFrame];
+        }
+        VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+        if (timeline)
+        {
+            signalValues[signalCount] = m_frameNumber + 1;
+            signalSemaphores[signalCount++] = m_frameTimeline.semaphore();
+            timelineInfo.signalSemaphoreValueCount = signalCount;
+            timelineInfo.pSignalSemaphoreValues = signalValues;
+            submitInfo.pNext = &timelineInfo;
+        }
+        submitInfo.signalSemaphoreCount = signalCount;
+        submitInfo.pSignalSemaphores = signalSemaphores;
         submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
+        submitInfo.pCommandBuffers = &commandBuffer;
+
+        // Finished streaming uploads are acquired in a submission ahead of the frame, waiting for their transfers on
+        // the GPU. The frame's draws follow in submission order.
+        VkSubmitInfo submitInfos[2] = {};
+        uint32_t submitCount = 0;
+        m_uploadHandoff.clear();
+        m_uploadStreamer.takeHandoffs(m_frameNumber, m_uploadHandoff);
+        if (!m_uploadHandoff.empty())
+        {
+            VkSubmitInfo& handoffInfo = submitInfos[submitCount++];
+            handoffInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            handoffInfo.waitSemaphoreCount = static_cast<uint32_t>(m_uploadHandoff.waitSemaphores.size());
+            handoffInfo.pWaitSemaphores = m_uploadHandoff.waitSemaphores.data();
+            handoffInfo.pWaitDstStageMask = m_uploadHandoff.waitStages.data();
+            handoffInfo.commandBufferCount = static_cast<uint32_t>(m_uploadHandoff.commandBuffers.size());
+            handoffInfo.pCommandBuffers =
+                m_uploadHandoff.commandBuffers.empty() ? nullptr : m_uploadHandoff.commandBuffers.data();
+        }
+        submitInfos[submitCount++] = submitInfo;
 
-        VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphore};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
+        const VkFence fence = timeline ? VK_NULL_HANDLE : m_inFlightFences[m_currentFrame];
+        if (!timeline)
+        {
+            vkResetFences(m_logicalDevice, 1, &fence);
+        }
+        {
+            PROFILE_ZONE("submit");
+            if (vkQueueSubmit(m_graphicsQueue, submitCount, submitInfos, fence) != VK_SUCCESS)
+            {
+                lerror("Failed to submit commands!");
+                return false;
+            }
+        }
+        m_gpuProfiler.submitted(slot);
+
+        ++m_frameNumber;
+        m_currentFrame = (m_currentFrame + 1) % m_config.maxFramesInFlight;
 
-        if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        if (!m_config.headless)
         {
-            lerror("Failed to submit commands!");
-            return false;
+            const VkResult presentResult = present(imageIndex, signalSemaphores[0]);
+            if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR ||
+                m_framebufferResized)
+            {
+                if (!recreateSwapChain())
+                {
+                    return false;
+                }
+            }
+            else if (presentResult != VK_SUCCESS)
+            {
+                lerror("Failed to present swap chain image!");
+                return false;
+            }
+        }
+
+        if (m_frameStatistics.frameCount > 0)
+        {
+            const auto frameTime = frameStart - m_lastFrameStart;
+            m_frameStatistics.totalFrameTime += frameTime;
+            m_frameStatistics.frameTimes.add(std::chrono::duration<double, std::milli>(frameTime).count());
+        }
+        else
+        {
+            m_timeToFirstFrame = std::chrono::steady_clock::now() - m_runStart;
+            // The base pipeline plus the variants built so far, failed builds fall back to the base and do not count.
+            m_variantsReadyAtFirstFrame = 1;
+            for (uint32_t build = 0; build < m_pipelineBuilds->pipelineCount(); ++build)
+            {
+                if (m_pipelineBuilds->pipeline(build) != VK_NULL_HANDLE)
+                {
+                    ++m_variantsReadyAtFirstFrame;
+                }
+            }
+            linfo("Time to first frame: {:.3f} ms, {} of {} pipeline variants ready",
+                  std::chrono::duration<double, std::milli>(m_timeToFirstFrame).count(),
+                  m_variantsReadyAtFirstFrame,
+                  std::max(1u, m_config.pipelineVariants));
         }
+        m_frameStatistics.totalStallTime += stallEnd - frameStart;
+        ++m_frameStatistics.frameCount;
+        m_lastFrameStart = frameStart;
+
+        return true;
+    }
 
+    VkResult present(uint32_t imageIndex, VkSemaphore renderFinishedSemaphore)
+    {
+        VkSemaphore signalSemaphores[] = {renderFinishedSemaphore};
         VkPresentInfoKHR presentInfo = {};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
@@ -1031,63 +2437,350 @@ private:
         presentInfo.pImageIndices = &imageIndex;
         presentInfo.pResults = nullptr;
 
-        vkQueuePresentKHR(m_presentQueue, &presentInfo);
+        return vkQueuePresentKHR(m_presentQueue, &presentInfo);
+    }
 
+    // Rebuilds only the objects that depend on the surface extent. The old swap chain and its views, framebuffers
+    // and command buffers are retired and destroyed once the frames in flight referencing them have completed.
+    bool recreateSwapChain()
+    {
+        PROFILE_FUNCTION();
+        int width = 0;
+        int height = 0;
+        glfwGetFramebufferSize(m_window, &width, &height);
+        while (width == 0 || height == 0)
+        {
+            // Minimized, there is nothing to render into until the window is restored.
+            if (glfwWindowShouldClose(m_window))
+            {
+                return true;
+            }
+            glfwWaitEvents();
+            glfwGetFramebufferSize(m_window, &width, &height);
+        }
+        m_framebufferResized = false;
+
+        RetiredSwapchain retired;
+        retired.swapchain = m_swapchain;
+        retired.imageViews.swap(m_swapchainImageViews);
+        retired.framebuffers.swap(m_swapchainFramebuffers);
+        retired.commandBuffers.swap(m_commandBuffers);
+        retired.frameNumber = m_frameNumber;
+        m_retiredSwapchains.push_back(std::move(retired));
+
+        const VkFormat previousFormat = m_swapchainImageFormat;
+        if (!createSwapChain(static_cast<uint32_t>(width), static_cast<uint32_t>(height)))
+        {
+            return false;
+        }
+
+        if (m_swapchainImageFormat != previousFormat)
+        {
+            // Rare: the render pass and the pipelines built against it have to follow the new format.
+            linfo("Swap chain format changed, recreating render pass and graphics pipeline.");
+            // Hot reloads build against the render pass, hold them off until it is replaced.
+            std::lock_guard<std::mutex> lock(m_pipelineMutex);
+            releaseAllRetiredSwapchains();
+            releaseRetiredPipelines(true);
+            if (m_pendingPipeline != VK_NULL_HANDLE)
+            {
+                vkDestroyPipeline(m_logicalDevice, m_pendingPipeline, nullptr);
+                m_pendingPipeline = VK_NULL_HANDLE;
+            }
+            m_pipelineBuilds->destroy();
+            vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
+            if (!createRenderPass() || !createGraphicsPipeline())
+            {
+                return false;
+            }
+            m_variantPipelines.clear();
+            m_finishedVariantCount = 0;
+            startPipelineVariantBuilds();
+            updateVariantPipelines();
+        }
+
+        if (m_workerPool && m_config.recordingMode == RecordingMode::Static)
+        {
+            // Secondary command buffers are re-recorded in place, the retired primaries must not reference them.
+            releaseAllRetiredSwapchains();
+        }
+
+        if (!createSwapChainImageViews() || !createFramebuffers() || !growFrameSlots() || !createCommandBuffers())
+        {
+            return false;
+        }
+        m_imagesInFlight.assign(m_swapchainImages.size(), VK_NULL_HANDLE);
+        m_imageFrameValues.assign(m_swapchainImages.size(), 0);
+
+        linfo("Swap chain recreated ({}x{}, {} images)",
+              m_swapchainExtent.width,
+              m_swapchainExtent.height,
+              m_swapchainImages.size());
         return true;
     }
 
-    void mainLoop()
+    // Frame waits only cover the graphics submissions, a retired swap chain can still have presents queued on the
+    // present queue. Its images stay in use until those finish.
+    void releaseAllRetiredSwapchains()
+    {
+        waitForSubmittedFrames();
+        vkQueueWaitIdle(m_presentQueue);
+        releaseRetiredSwapchains(true);
+    }
+
+    void releaseRetiredSwapchains(bool deviceIdle)
+    {
+        const uint64_t completedFrames = deviceIdle ? m_frameNumber : completedFrameCount();
+        while (!m_retiredSwapchains.empty())
+        {
+            RetiredSwapchain& retired = m_retiredSwapchains.front();
+            if (completedFrames < retired.frameNumber)
+            {
+                break;
+            }
+
+            if (!retired.commandBuffers.empty())
+            {
+                vkFreeCommandBuffers(m_logicalDevice,
+                                     m_commandPool,
+                                     static_cast<uint32_t>(retired.commandBuffers.size()),
+                                     retired.commandBuffers.data());
+            }
+            for (VkFramebuffer framebuffer : retired.framebuffers)
+            {
+                vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
+            }
+            for (VkImageView imageView : retired.imageViews)
+            {
+                vkDestroyImageView(m_logicalDevice, imageView, nullptr);
+            }
+            vkDestroySwapchainKHR(m_logicalDevice, retired.swapchain, nullptr);
+            m_retiredSwapchains.pop_front();
+        }
+    }
+
+    // Number of frames known to have completed on the GPU, resources retired after submitting frame n can go once
+    // it reaches n. The timeline counter tells exactly, with fences waiting on the fence of the current slot
+    // guarantees every frame at least maxFramesInFlight frames old has completed.
+    uint64_t completedFrameCount() const
+    {
+        if (m_config.syncMode == SyncMode::Timeline)
+        {
+            return m_frameTimeline.completedValue();
+        }
+        return m_frameNumber > m_config.maxFramesInFlight ? m_frameNumber - m_config.maxFramesInFlight : 0;
+    }
+
+    // Blocks until every submitted frame has completed. The timeline waits for the last frame only, fences fall
+    // back to idling the whole device.
+    void waitForSubmittedFrames()
+    {
+        if (m_config.syncMode == SyncMode::Timeline)
+        {
+            m_frameTimeline.wait(m_frameNumber);
+        }
+        else
+        {
+            vkDeviceWaitIdle(m_logicalDevice);
+        }
+    }
+
+    void fillRunStatistics(RunStatistics& statistics) const
+    {
+        using MilliSeconds = std::chrono::duration<double, std::milli>;
+        statistics.startupTime = MilliSeconds(m_startupTime).count();
+        statistics.timeToFirstFrame = MilliSeconds(m_timeToFirstFrame).count();
+        statistics.pipelineVariants = std::max(1u, m_config.pipelineVariants);
+        statistics.pipelineVariantsReadyAtFirstFrame = m_variantsReadyAtFirstFrame;
+        statistics.pipelineBuildTime = MilliSeconds(m_pipelineBuilds->buildTime()).count();
+        statistics.frameCount = m_frameStatistics.frameCount;
+        const RollingStatistics& frameTimes = m_frameStatistics.frameTimes;
+        statistics.averageFrameTime = frameTimes.average();
+        statistics.framesPerSecond = frameTimes.empty() ? 0.0 : 1000.0 / frameTimes.average();
+        statistics.frameTimeP50 = frameTimes.percentile(50.0);
+        statistics.frameTimeP99 = frameTimes.percentile(99.0);
+    }
+
+    void logFrameStatistics()
     {
-        while (!glfwWindowShouldClose(m_window))
+        if (m_frameStatistics.frameCount < 2)
         {
-            glfwPollEvents();
-            drawFrame();
+            return;
+        }
+
+        using MilliSeconds = std::chrono::duration<double, std::milli>;
+        const double avgFrameTime = MilliSeconds(m_frameStatistics.totalFrameTime).count() /
+                                    static_cast<double>(m_frameStatistics.frameCount - 1);
+        const double avgStallTime =
+            MilliSeconds(m_frameStatistics.totalStallTime).count() / static_cast<double>(m_frameStatistics.frameCount);
+        const double avgRecordTime =
+            MilliSeconds(m_frameStatistics.totalRecordTime).count() / static_cast<double>(m_frameStatistics.frameCount);
+        linfo("Frames in flight: {}, instances: {}, draws: {}, recording: {} with {} threads, frames: {}, "
+              "avg frame time: {:.3f} ms ({:.1f} fps), avg CPU stall: {:.3f} ms, avg record time: {:.3f} ms",
+              m_config.maxFramesInFlight,
+              m_instanceCount,
+              m_drawCount,
+              m_config.recordingMode == RecordingMode::PerFrame ? "per-frame" : "static",
+              m_workerPool ? m_workerPool->threadCount() : 0,
+              m_frameStatistics.frameCount,
+              avgFrameTime,
+              avgFrameTime > 0.0 ? 1000.0 / avgFrameTime : 0.0,
+              avgStallTime,
+              avgRecordTime);
+    }
+
+    bool mainLoop()
+    {
+        PROFILE_FUNCTION();
+        uint32_t frameCount = m_config.frameCount;
+        if (m_config.headless && frameCount == 0)
+        {
+            frameCount = kDefaultHeadlessFrameCount;
+            linfo("No frame count given for headless run, rendering {} frames.", frameCount);
+        }
+
+        bool succeeded = true;
+        for (uint32_t frame = 0; frameCount == 0 || frame < frameCount; ++frame)
+        {
+            if (!m_config.headless)
+            {
+                if (glfwWindowShouldClose(m_window))
+                {
+                    break;
+                }
+                PROFILE_ZONE("poll events");
+                glfwPollEvents();
+            }
+            if (!drawFrame())
+            {
+                succeeded = false;
+                break;
+            }
         }
         vkDeviceWaitIdle(m_logicalDevice);
+        logFrameStatistics();
+
+        if (m_gpuProfiler.enabled())
+        {
+            m_gpuProfiler.collectAll();
+            m_gpuProfiler.logStatistics();
+            if (!m_config.gpuProfilePath.empty())
+            {
+                m_gpuProfiler.writeJson(m_config.gpuProfilePath);
+            }
+        }
+
+        return succeeded;
     }
 
     void cleanup()
     {
+        PROFILE_FUNCTION();
         linfo("Cleaning up");
-        vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphore, nullptr);
-        vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphore, nullptr);
+        m_shaderHotReloader.stop();
+        // Also reached after a failed initVulkan(), everything below the device may be partially created.
+        if (m_logicalDevice != VK_NULL_HANDLE)
+        {
+            vkDeviceWaitIdle(m_logicalDevice);
+            destroyDeviceObjects();
+        }
+
+        if (m_instance != VK_NULL_HANDLE)
+        {
+            if (m_debugCallback != VK_NULL_HANDLE)
+            {
+                DestroyDebugReportCallbackEXT(m_instance, m_debugCallback, nullptr);
+            }
+            if (m_surface != VK_NULL_HANDLE)
+            {
+                vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+            }
+            vkDestroyInstance(m_instance, nullptr);
+        }
+
+        if (!m_config.headless)
+        {
+            glfwDestroyWindow(m_window);
+            glfwTerminate();
+        }
+    }
+
+    void destroyDeviceObjects()
+    {
+        releaseRetiredSwapchains(true);
+        releaseRetiredPipelines(true);
+        if (m_pendingPipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(m_logicalDevice, m_pendingPipeline, nullptr);
+        }
+        for (size_t i = 0; i < m_inFlightFences.size(); ++i)
+        {
+            vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphores[i], nullptr);
+            vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphores[i], nullptr);
+            vkDestroyFence(m_logicalDevice, m_inFlightFences[i], nullptr);
+        }
+        m_frameTimeline.destroy();
         vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
+        for (VkCommandPool commandPool : m_frameCommandPools)
+        {
+            vkDestroyCommandPool(m_logicalDevice, commandPool, nullptr);
+        }
+        m_commandRecorder.destroy();
+        m_workerPool.reset();
+        m_gpuProfiler.destroy();
+        m_gpuCuller.destroy();
+        destroyMesh(m_mesh);
+        m_allocator.destroyBuffer(m_instanceBuffer, m_instanceAllocation);
+        vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
+        m_uniformRing.destroy();
+        m_stagingUploader.destroy();
+        m_uploadStreamer.destroy();
         for (size_t i = 0; i < m_swapchainFramebuffers.size(); ++i)
         {
             vkDestroyFramebuffer(m_logicalDevice, m_swapchainFramebuffers[i], nullptr);
         }
         m_swapchainFramebuffers.clear();
+        m_pipelineBuilds->destroy();
         vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-        vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
+        m_pipelineCache.save();
+        m_pipelineCache.destroy();
+        m_layoutCache.destroy();
+        m_graphExecutor.destroy();
         for (size_t i = 0; i < m_swapchainImageViews.size(); ++i)
         {
             vkDestroyImageView(m_logicalDevice, m_swapchainImageViews[i], nullptr);
         }
-        vkDestroySwapchainKHR(m_logicalDevice, m_swapchain, nullptr);
+        if (m_config.headless)
+        {
+            for (size_t i = 0; i < m_offscreenImageAllocations.size(); ++i)
+            {
+                m_allocator.destroyImage(m_swapchainImages[i], m_offscreenImageAllocations[i]);
+            }
+        }
+        else
+        {
+            vkDestroySwapchainKHR(m_logicalDevice, m_swapchain, nullptr);
+        }
+        m_allocator.logStats();
+        m_allocator.destroy();
         vkDestroyDevice(m_logicalDevice, nullptr);
-
-        DestroyDebugReportCallbackEXT(m_instance, m_debugCallback, nullptr);
-
-        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
-        vkDestroyInstance(m_instance, nullptr);
-
-        glfwDestroyWindow(m_window);
-
-        glfwTerminate();
+        m_logicalDevice = VK_NULL_HANDLE;
     }
 
     std::vector<const char*> getRequiredExtensions()
     {
         std::vector<const char*> extensions;
 
-        unsigned int glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-        for (unsigned int i = 0; i < glfwExtensionCount; ++i)
+        if (!m_config.headless)
         {
-            extensions.push_back(glfwExtensions[i]);
+            unsigned int glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+            for (unsigned int i = 0; i < glfwExtensionCount; ++i)
+            {
+                extensions.push_back(glfwExtensions[i]);
+            }
         }
 
         if (m_enableValidationLayers)
@@ -1131,6 +2824,9 @@ private:
     }
 
 private:
+    static constexpr uint32_t kDefaultHeadlessFrameCount = 1000;
+
+    ApplicationConfig m_config;
     uint32_t m_windowWidth;
     uint32_t m_windowHeight;
     bool m_enableValidationLayers;
@@ -1143,32 +2839,120 @@ private:
     QueueFamilyIndices m_queueFamilyIndices;
     std::vector<const char*> m_requiredDeviceExtensions;
     VkDevice m_logicalDevice;
+    GpuMemoryAllocator m_allocator;
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
+    // The queue of QueueFamilyIndices::transferFamily, m_graphicsQueue when there is none.
+    VkQueue m_transferQueue;
     SwapChainDetails m_swapchainDetails;
     VkSwapchainKHR m_swapchain;
     std::vector<VkImage> m_swapchainImages;
     VkFormat m_swapchainImageFormat;
     VkExtent2D m_swapchainExtent;
     std::vector<VkImageView> m_swapchainImageViews;
+    RenderGraph m_frameGraph;
+    RenderGraphExecutor m_graphExecutor;
+    uint32_t m_backbufferResource;
+    uint32_t m_mainPass;
+    // Images of the graph's resources while recording, the backbuffer is the swapchain image recorded into.
+    std::vector<VkImage> m_graphImages;
+    // The render pass of m_mainPass, owned by m_graphExecutor.
     VkRenderPass m_renderPass;
+    PersistentPipelineCache m_pipelineCache;
+    // Owns m_pipelineLayout.
+    PipelineLayoutCache m_layoutCache;
     VkPipelineLayout m_pipelineLayout;
+    // Owned by m_layoutCache as well, set 0 holds the frame uniforms.
+    std::vector<VkDescriptorSetLayout> m_descriptorSetLayouts;
     VkPipeline m_graphicsPipeline;
+    ShaderHotReloader m_shaderHotReloader;
+    // Guards the pending pipeline and the reloaded SPIR-V, which the shader watcher thread writes.
+    std::mutex m_pipelineMutex;
+    VkPipeline m_pendingPipeline;
+    std::vector<uint32_t> m_reloadedVertSpirv;
+    std::vector<uint32_t> m_reloadedFragSpirv;
+    std::deque<RetiredPipeline> m_retiredPipelines;
+    // Replaced on every hot reload, the previous one retires with the replaced base pipeline.
+    std::unique_ptr<PipelineBuildService> m_pipelineBuilds;
+    // Hashed lookup of the variant index of a key, m_variantKeys maps the index back.
+    std::unordered_map<PipelineVariantKey, uint32_t, PipelineVariantKeyHash> m_variantIndices;
+    std::vector<PipelineVariantKey> m_variantKeys;
+    // Pipeline of every variant as used for recording, see updateVariantPipelines().
+    std::vector<VkPipeline> m_variantPipelines;
+    uint32_t m_finishedVariantCount;
+    uint32_t m_variantsReadyAtFirstFrame;
     std::vector<VkFramebuffer> m_swapchainFramebuffers;
     VkCommandPool m_commandPool;
+    StagingUploader m_stagingUploader;
+    UploadStreamer m_uploadStreamer;
+    // Reused every frame to avoid allocating.
+    GraphicsHandoff m_uploadHandoff;
+    GpuMesh m_mesh;
+    VkBuffer m_instanceBuffer;
+    GpuAllocation m_instanceAllocation;
+    uint32_t m_instanceCount;
+    uint32_t m_instancesPerDraw;
+    uint32_t m_drawCount;
+    // Bounding radius of m_mesh around its origin.
+    float m_meshRadius;
+    GpuCuller m_gpuCuller;
+    // VK_KHR_draw_indirect_count is enabled, the culled draws are bounded by the GPU written counts.
+    bool m_drawIndirectCount;
+    UniformRing m_uniformRing;
+    VkDescriptorPool m_descriptorPool;
+    VkDescriptorSet m_frameDescriptorSet;
+    std::unique_ptr<WorkerPool> m_workerPool;
+    ParallelCommandRecorder m_commandRecorder;
+    GpuProfiler m_gpuProfiler;
     std::vector<VkCommandBuffer> m_commandBuffers;
-    VkSemaphore m_imageAvailableSemaphore;
-    VkSemaphore m_renderFinishedSemaphore;
+    std::vector<VkCommandPool> m_frameCommandPools;
+    std::vector<VkCommandBuffer> m_frameCommandBuffers;
+    std::vector<VkSemaphore> m_imageAvailableSemaphores;
+    std::vector<VkSemaphore> m_renderFinishedSemaphores;
+    std::vector<VkFence> m_inFlightFences;
+    std::vector<VkFence> m_imagesInFlight;
+    // Timeline sync: counts completed frames, replacing m_inFlightFences. m_imageFrameValues replaces
+    // m_imagesInFlight with the value the last frame rendering into each image signals.
+    TimelineSemaphore m_frameTimeline;
+    std::vector<uint64_t> m_imageFrameValues;
+    std::vector<GpuAllocation> m_offscreenImageAllocations;
+    uint32_t m_currentFrame;
+    uint64_t m_frameNumber;
+    bool m_framebufferResized;
+    std::deque<RetiredSwapchain> m_retiredSwapchains;
+    FrameStatistics m_frameStatistics;
+    std::chrono::steady_clock::time_point m_lastFrameStart;
+    std::chrono::steady_clock::time_point m_runStart;
+    std::chrono::steady_clock::duration m_startupTime;
+    std::chrono::steady_clock::duration m_timeToFirstFrame;
 };
 
-int main(int argc, char* argv[])
+bool runApplication(const ApplicationConfig& config, RunStatistics* statistics)
 {
-    sorban::loom::loggerInit("./goboVkTriangle.log", 10, 3);
+    bool succeeded = false;
+    {
+        HelloVkTriangleApplication helloVk(config);
+        succeeded = helloVk.run(statistics);
+    }
+
+    // The worker threads are gone with the application, their zones are complete.
+    if (!config.cpuTracePath.empty())
     {
-        HelloVkTriangleApplication helloVk;
-        helloVk.run();
+#ifdef CPU_PROFILER_ENABLED
+        if (CpuProfiler::instance().writeChromeTrace(config.cpuTracePath))
+        {
+            linfo("CPU trace written to {}, {} zones dropped.",
+                  config.cpuTracePath.c_str(),
+                  CpuProfiler::instance().droppedEventCount());
+        }
+        else
+        {
+            lerror("Failed to write CPU trace to {}", config.cpuTracePath.c_str());
+        }
+#else
+        lerror("No CPU trace written, the CPU profiler is disabled. Configure with -DVK_TRIANGLE_CPU_PROFILER=ON.");
+#endif
     }
 
-    linfo("Event loop finished, preparing to exit.");
-    return EXIT_SUCCESS;
+    return succeeded;
 }
@@ -0,0 +1,376 @@
+#include "gpuAllocator.h"
+
+#include "vkHelpers.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <algorithm>
+
+GpuMemoryAllocator::GpuMemoryAllocator()
+    : m_physicalDevice(VK_NULL_HANDLE),
+      m_device(VK_NULL_HANDLE),
+      m_memoryProperties(),
+      m_blockSize(kDefaultBlockSize),
+      m_bufferImageGranularity(1),
+      m_maxAllocationCount(0),
+      m_deviceMemoryCount(0),
+      m_dedicatedSize(0),
+      m_dedicatedCount(0)
+{
+}
+
+bool GpuMemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+    m_physicalDevice = physicalDevice;
+    m_device = device;
+    m_blockSize = blockSize;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+    m_bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+    m_maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &m_memoryProperties);
+
+    m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < m_pools.size(); ++i)
+    {
+        m_pools[i].memoryType = i / 2;
+    }
+
+    ldebug("Memory allocator initialized, block size {} bytes, buffer image granularity {} bytes",
+           m_blockSize,
+           m_bufferImageGranularity);
+    return true;
+}
+
+void GpuMemoryAllocator::destroy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (Pool& pool : m_pools)
+    {
+        for (Block& block : pool.blocks)
+        {
+            if (block.memory == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+            if (!block.allocator->empty())
+            {
+                lerror("Destroying memory block with {} live allocations!", block.allocator->stats().allocationCount);
+            }
+            freeDeviceMemory(block.memory, block.mapped);
+        }
+        pool.blocks.clear();
+    }
+    if (m_dedicatedCount > 0)
+    {
+        lerror("{} dedicated allocations were not freed!", m_dedicatedCount);
+    }
+}
+
+bool GpuMemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+                                  VkMemoryPropertyFlags properties,
+                                  GpuResourceKind kind,
+                                  GpuAllocation& allocation)
+{
+    uint32_t memoryType = 0;
+    if (!findMemoryType(m_physicalDevice, requirements.memoryTypeBits, properties, memoryType))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (requirements.size > m_blockSize / 2)
+    {
+        char* mapped = nullptr;
+        if (!allocateDeviceMemory(memoryType, requirements.size, allocation.memory, mapped))
+        {
+            return false;
+        }
+        allocation.offset = 0;
+        allocation.size = requirements.size;
+        allocation.mapped = mapped;
+        allocation.dedicated = true;
+        ++m_dedicatedCount;
+        m_dedicatedSize += requirements.size;
+        return true;
+    }
+
+    // Keeping linear and optimal resources in separate blocks satisfies bufferImageGranularity without padding.
+    const uint32_t poolIdx = poolIndex(memoryType, kind);
+    Pool& pool = m_pools[poolIdx];
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    TlsfAllocator::Allocation range;
+    uint32_t blockIdx = 0;
+    for (; blockIdx < pool.blocks.size(); ++blockIdx)
+    {
+        Block& block = pool.blocks[blockIdx];
+        if (block.memory != VK_NULL_HANDLE && block.allocator->allocate(requirements.size, alignment, range))
+        {
+            break;
+        }
+    }
+
+    if (blockIdx == pool.blocks.size())
+    {
+        // Reuse the slot of a released block, allocations refer to their block by index.
+        blockIdx = 0;
+        while (blockIdx < pool.blocks.size() && pool.blocks[blockIdx].memory != VK_NULL_HANDLE)
+        {
+            ++blockIdx;
+        }
+        if (blockIdx == pool.blocks.size())
+        {
+            pool.blocks.emplace_back();
+        }
+
+        Block& block = pool.blocks[blockIdx];
+        bool blockUsable = allocateDeviceMemory(memoryType, m_blockSize, block.memory, block.mapped);
+        if (blockUsable)
+        {
+            block.allocator.reset(new TlsfAllocator(m_blockSize));
+            blockUsable = block.allocator->allocate(requirements.size, alignment, range);
+            if (!blockUsable)
+            {
+                lerror("Failed to sub-allocate {} bytes from a new memory block!", requirements.size);
+                freeDeviceMemory(block.memory, block.mapped);
+                block.memory = VK_NULL_HANDLE;
+                block.mapped = nullptr;
+                block.allocator.reset();
+            }
+        }
+        if (!blockUsable)
+        {
+            // Empty slots in the middle stay for reuse, later blocks are referred to by index.
+            if (blockIdx + 1 == pool.blocks.size())
+            {
+                pool.blocks.pop_back();
+            }
+            return false;
+        }
+    }
+
+    const Block& block = pool.blocks[blockIdx];
+    allocation.memory = block.memory;
+    allocation.offset = range.offset;
+    allocation.size = range.size;
+    allocation.mapped = block.mapped != nullptr ? block.mapped + range.offset : nullptr;
+    allocation.pool = poolIdx;
+    allocation.block = blockIdx;
+    allocation.handle = range.handle;
+    allocation.dedicated = false;
+    return true;
+}
+
+void GpuMemoryAllocator::free(GpuAllocation& allocation)
+{
+    if (allocation.memory == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (allocation.dedicated)
+    {
+        freeDeviceMemory(allocation.memory, static_cast<char*>(allocation.mapped));
+        --m_dedicatedCount;
+        m_dedicatedSize -= allocation.size;
+        allocation = GpuAllocation();
+        return;
+    }
+
+    Pool& pool = m_pools[allocation.pool];
+    Block& block = pool.blocks[allocation.block];
+    block.allocator->free(allocation.handle);
+
+    // Give empty blocks back to the driver, but keep one per pool around to avoid allocation churn.
+    if (block.allocator->empty())
+    {
+        const auto liveBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& poolBlock) {
+            return poolBlock.memory != VK_NULL_HANDLE;
+        });
+        if (liveBlocks > 1)
+        {
+            freeDeviceMemory(block.memory, block.mapped);
+            block.memory = VK_NULL_HANDLE;
+            block.mapped = nullptr;
+            block.allocator.reset();
+        }
+    }
+
+    allocation = GpuAllocation();
+}
+
+bool GpuMemoryAllocator::createBuffer(VkDeviceSize size,
+                                      VkBufferUsageFlags usage,
+                                      VkMemoryPropertyFlags properties,
+                                      VkBuffer& buffer,
+                                      GpuAllocation& allocation)
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        lerror("Failed to create buffer of {} bytes!", size);
+        return false;
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetBufferMemoryRequirements(m_device, buffer, &memoryRequirements);
+    if (!allocate(memoryRequirements, properties, GpuResourceKind::Linear, allocation))
+    {
+        lerror("Failed to allocate {} bytes of buffer memory!", memoryRequirements.size);
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        return false;
+    }
+    vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset);
+
+    return true;
+}
+
+void GpuMemoryAllocator::destroyBuffer(VkBuffer& buffer, GpuAllocation& allocation)
+{
+    vkDestroyBuffer(m_device, buffer, nullptr);
+    buffer = VK_NULL_HANDLE;
+    free(allocation);
+}
+
+bool GpuMemoryAllocator::createImage(const VkImageCreateInfo& imageInfo,
+                                     VkMemoryPropertyFlags properties,
+                                     VkImage& image,
+                                     GpuAllocation& allocation)
+{
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    {
+        lerror("Failed to create {}x{} image!", imageInfo.extent.width, imageInfo.extent.height);
+        return false;
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(m_device, image, &memoryRequirements);
+    const GpuResourceKind kind =
+        imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? GpuResourceKind::Optimal : GpuResourceKind::Linear;
+    if (!allocate(memoryRequirements, properties, kind, allocation))
+    {
+        lerror("Failed to allocate {} bytes of image memory!", memoryRequirements.size);
+        vkDestroyImage(m_device, image, nullptr);
+        image = VK_NULL_HANDLE;
+        return false;
+    }
+    vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+
+    return true;
+}
+
+void GpuMemoryAllocator::destroyImage(VkImage& image, GpuAllocation& allocation)
+{
+    vkDestroyImage(m_device, image, nullptr);
+    image = VK_NULL_HANDLE;
+    free(allocation);
+}
+
+GpuAllocatorStats GpuMemoryAllocator::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    GpuAllocatorStats stats;
+    stats.deviceMemoryCount = m_deviceMemoryCount;
+    stats.reservedSize = m_dedicatedSize;
+    stats.usedSize = m_dedicatedSize;
+    stats.allocationCount = m_dedicatedCount;
+    for (const Pool& pool : m_pools)
+    {
+        for (const Block& block : pool.blocks)
+        {
+            if (block.memory == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+            const TlsfStats blockStats = block.allocator->stats();
+            stats.reservedSize += blockStats.totalSize;
+            stats.usedSize += blockStats.usedSize;
+            stats.allocationCount += blockStats.allocationCount;
+            stats.freeRangeCount += blockStats.freeRangeCount;
+            stats.largestFreeRange = std::max(stats.largestFreeRange, blockStats.largestFreeRange);
+        }
+    }
+    return stats;
+}
+
+void GpuMemoryAllocator::logStats() const
+{
+    const GpuAllocatorStats allocatorStats = stats();
+    linfo("GPU memory: {} allocations in {} device memory objects, {} of {} bytes used ({:.1f}% utilization), "
+          "{} free ranges, {:.1f}% fragmentation",
+          allocatorStats.allocationCount,
+          allocatorStats.deviceMemoryCount,
+          allocatorStats.usedSize,
+          allocatorStats.reservedSize,
+          100.0 * allocatorStats.utilization(),
+          allocatorStats.freeRangeCount,
+          100.0 * allocatorStats.fragmentation());
+}
+
+bool GpuMemoryAllocator::allocateDeviceMemory(uint32_t memoryType,
+                                              VkDeviceSize size,
+                                              VkDeviceMemory& memory,
+                                              char*& mapped)
+{
+    if (m_deviceMemoryCount >= m_maxAllocationCount)
+    {
+        lerror("Reached maxMemoryAllocationCount ({})!", m_maxAllocationCount);
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        lerror("Failed to allocate {} bytes of device memory from type {}!", size, memoryType);
+        memory = VK_NULL_HANDLE;
+        return false;
+    }
+    ++m_deviceMemoryCount;
+
+    mapped = nullptr;
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        void* data = nullptr;
+        if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+        {
+            lerror("Failed to map host visible memory!");
+            freeDeviceMemory(memory, nullptr);
+            memory = VK_NULL_HANDLE;
+            return false;
+        }
+        mapped = static_cast<char*>(data);
+    }
+
+    ldebug("Allocated {} bytes of device memory from type {}", size, memoryType);
+    return true;
+}
+
+void GpuMemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, char* mapped)
+{
+    if (mapped != nullptr)
+    {
+        vkUnmapMemory(m_device, memory);
+    }
+    vkFreeMemory(m_device, memory, nullptr);
+    --m_deviceMemoryCount;
+}
+
+uint32_t GpuMemoryAllocator::poolIndex(uint32_t memoryType, GpuResourceKind kind) const
+{
+    const bool separateOptimal = m_bufferImageGranularity > 1 && kind == GpuResourceKind::Optimal;
+    return memoryType * 2 + (separateOptimal ? 1 : 0);
+}
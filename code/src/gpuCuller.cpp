@@ -0,0 +1,320 @@
+#include "gpuCuller.h"
+#include "transformBatch.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstring>
+#include <vector>
+
+static const uint32_t kWorkgroupSize = 64;
+
+// Mirrors CullConstants in cull.comp.
+struct CullConstants
+{
+    glm::vec4 planes[6];
+    uint32_t drawCount;
+    uint32_t groupCount;
+    uint32_t groupCapacity;
+    uint32_t instancesPerDraw;
+    uint32_t instanceCount;
+    uint32_t indexCount;
+    uint32_t commandBase;
+    uint32_t countBase;
+};
+
+GpuCuller::GpuCuller()
+    : m_allocator(nullptr),
+      m_device(VK_NULL_HANDLE),
+      m_drawCount(0),
+      m_maxGroupCount(0),
+      m_slotCommandCount(0),
+      m_drawIndexedIndirectCount(nullptr),
+      m_boundsBuffer(VK_NULL_HANDLE),
+      m_commandBuffer(VK_NULL_HANDLE),
+      m_countBuffer(VK_NULL_HANDLE),
+      m_pipelineLayout(VK_NULL_HANDLE),
+      m_pipeline(VK_NULL_HANDLE),
+      m_descriptorPool(VK_NULL_HANDLE),
+      m_descriptorSet(VK_NULL_HANDLE)
+{
+}
+
+bool GpuCuller::init(GpuMemoryAllocator& allocator,
+                     VkDevice device,
+                     PipelineLayoutCache& layoutCache,
+                     VkPipelineCache pipelineCache,
+                     const ShaderBinary& shader,
+                     uint32_t drawCount,
+                     uint32_t maxGroupCount,
+                     uint32_t slotCount,
+                     bool drawIndirectCount)
+{
+    m_allocator = &allocator;
+    m_device = device;
+    m_drawCount = drawCount;
+    m_maxGroupCount = maxGroupCount;
+    m_slotCommandCount = drawCount + maxGroupCount;
+    m_drawIndexedIndirectCount = nullptr;
+    if (drawIndirectCount)
+    {
+        m_drawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        if (m_drawIndexedIndirectCount == nullptr)
+        {
+            lerror("VK_KHR_draw_indirect_count is not enabled on the device!");
+            return false;
+        }
+    }
+
+    if (!m_allocator->createBuffer(sizeof(glm::vec4) * drawCount,
+                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                   m_boundsBuffer,
+                                   m_boundsAllocation) ||
+        !createSlotBuffers(slotCount))
+    {
+        lerror("Failed to create culling buffers!");
+        return false;
+    }
+
+    ShaderReflection reflection;
+    std::vector<VkDescriptorSetLayout> setLayouts;
+    if (!reflectSpirv(shader.code, shader.codeSize / sizeof(uint32_t), reflection, "main") ||
+        !layoutCache.pipelineLayout({&reflection}, m_pipelineLayout, &setLayouts) || setLayouts.size() != 1 ||
+        reflection.pushConstantSize != sizeof(CullConstants))
+    {
+        lerror("{} does not declare the culling interface!", shader.name);
+        return false;
+    }
+
+    VkShaderModuleCreateInfo moduleInfo = {};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = shader.codeSize;
+    moduleInfo.pCode = shader.code;
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        lerror("Failed to create shader module!");
+        return false;
+    }
+    VkComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+    const VkResult result = vkCreateComputePipelines(m_device, pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device, shaderModule, nullptr);
+    if (result != VK_SUCCESS)
+    {
+        lerror("Failed to create culling pipeline!");
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 3;
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS)
+    {
+        lerror("Failed to create the culling descriptor pool!");
+        return false;
+    }
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = setLayouts.data();
+    if (vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet) != VK_SUCCESS)
+    {
+        lerror("Failed to allocate the culling descriptor set!");
+        return false;
+    }
+
+    writeDescriptorSet();
+
+    ldebug("GPU culling of {} draws, {} indirect draw count.",
+           drawCount,
+           drawCountSupported() ? "with" : "without");
+    return true;
+}
+
+void GpuCuller::destroy()
+{
+    if (m_allocator == nullptr)
+    {
+        return;
+    }
+    vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+    vkDestroyPipeline(m_device, m_pipeline, nullptr);
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_descriptorSet = VK_NULL_HANDLE;
+    m_pipeline = VK_NULL_HANDLE;
+    m_allocator->destroyBuffer(m_countBuffer, m_countAllocation);
+    m_allocator->destroyBuffer(m_commandBuffer, m_commandAllocation);
+    m_allocator->destroyBuffer(m_boundsBuffer, m_boundsAllocation);
+}
+
+bool GpuCuller::resizeSlots(uint32_t slotCount)
+{
+    m_allocator->destroyBuffer(m_countBuffer, m_countAllocation);
+    m_allocator->destroyBuffer(m_commandBuffer, m_commandAllocation);
+    if (!createSlotBuffers(slotCount))
+    {
+        lerror("Failed to create culling buffers for {} frame slots!", slotCount);
+        return false;
+    }
+    writeDescriptorSet();
+    return true;
+}
+
+bool GpuCuller::createSlotBuffers(uint32_t slotCount)
+{
+    const VkBufferUsageFlags indirectUsage =
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    return m_allocator->createBuffer(sizeof(VkDrawIndexedIndirectCommand) * m_slotCommandCount * slotCount,
+                                     indirectUsage,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                     m_commandBuffer,
+                                     m_commandAllocation) &&
+           m_allocator->createBuffer(sizeof(uint32_t) * m_maxGroupCount * slotCount,
+                                     indirectUsage,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                     m_countBuffer,
+                                     m_countAllocation);
+}
+
+void GpuCuller::writeDescriptorSet()
+{
+    // The shader indexes the whole buffers, the slot offsets are push constants.
+    const VkBuffer buffers[] = {m_boundsBuffer, m_commandBuffer, m_countBuffer};
+    VkDescriptorBufferInfo bufferInfos[3] = {};
+    VkWriteDescriptorSet writes[3] = {};
+    for (uint32_t binding = 0; binding < 3; ++binding)
+    {
+        bufferInfos[binding].buffer = buffers[binding];
+        bufferInfos[binding].range = VK_WHOLE_SIZE;
+        writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[binding].dstSet = m_descriptorSet;
+        writes[binding].dstBinding = binding;
+        writes[binding].descriptorCount = 1;
+        writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[binding].pBufferInfo = &bufferInfos[binding];
+    }
+    vkUpdateDescriptorSets(m_device, 3, writes, 0, nullptr);
+}
+
+void GpuCuller::recordCulling(VkCommandBuffer commandBuffer, uint32_t slot, const CullDispatch& dispatch) const
+{
+    CullConstants constants;
+    frustumPlanes(dispatch.viewProjection, constants.planes);
+    constants.drawCount = m_drawCount;
+    constants.groupCount = dispatch.groupCount;
+    constants.groupCapacity = groupCapacity(dispatch.groupCount);
+    constants.instancesPerDraw = dispatch.instancesPerDraw;
+    constants.instanceCount = dispatch.instanceCount;
+    constants.indexCount = dispatch.indexCount;
+    constants.commandBase = slot * m_slotCommandCount;
+    constants.countBase = slot * m_maxGroupCount;
+
+    vkCmdFillBuffer(commandBuffer,
+                    m_countBuffer,
+                    sizeof(uint32_t) * constants.countBase,
+                    sizeof(uint32_t) * dispatch.groupCount,
+                    0);
+    if (!drawCountSupported())
+    {
+        // Zeroed commands draw no instances, the tail of every group is skipped that way.
+        vkCmdFillBuffer(commandBuffer,
+                        m_commandBuffer,
+                        sizeof(VkDrawIndexedIndirectCommand) * constants.commandBase,
+                        sizeof(VkDrawIndexedIndirectCommand) * m_slotCommandCount,
+                        0);
+    }
+    VkMemoryBarrier clearBarrier = {};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1,
+                         &clearBarrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(
+        commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (m_drawCount + kWorkgroupSize - 1) / kWorkgroupSize, 1, 1);
+
+    VkMemoryBarrier cullBarrier = {};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                         0,
+                         1,
+                         &cullBarrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+}
+
+void GpuCuller::recordDraw(VkCommandBuffer commandBuffer, uint32_t slot, uint32_t groupCount, uint32_t group) const
+{
+    const uint32_t capacity = groupCapacity(groupCount);
+    const VkDeviceSize commandOffset =
+        sizeof(VkDrawIndexedIndirectCommand) * (slot * m_slotCommandCount + group * capacity);
+    if (drawCountSupported())
+    {
+        m_drawIndexedIndirectCount(commandBuffer,
+                                   m_commandBuffer,
+                                   commandOffset,
+                                   m_countBuffer,
+                                   sizeof(uint32_t) * (slot * m_maxGroupCount + group),
+                                   capacity,
+                                   sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else
+    {
+        vkCmdDrawIndexedIndirect(
+            commandBuffer, m_commandBuffer, commandOffset, capacity, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+bool gpuCullingSupported(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    return features.multiDrawIndirect == VK_TRUE && features.drawIndirectFirstInstance == VK_TRUE;
+}
+
+bool drawIndirectCountSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+    for (const VkExtensionProperties& extension : extensions)
+    {
+        if (std::strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,211 @@
+#include "gpuProfiler.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <fstream>
+
+GpuProfiler::GpuProfiler()
+    : m_device(VK_NULL_HANDLE),
+      m_queryPool(VK_NULL_HANDLE),
+      m_timestampPeriod(1.0),
+      m_timestampMask(0),
+      m_queriesPerRange(0)
+{
+}
+
+bool GpuProfiler::init(VkPhysicalDevice physicalDevice,
+                       VkDevice device,
+                       uint32_t queueFamilyIndex,
+                       uint32_t rangeCount,
+                       uint32_t maxScopesPerRange)
+{
+    m_device = device;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    const uint32_t validBits =
+        queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+    if (validBits == 0)
+    {
+        linfo("Queue family {} does not support timestamps, GPU profiling disabled.", queueFamilyIndex);
+        return false;
+    }
+    m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    m_timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+    // Every scope writes a begin and an end timestamp.
+    m_queriesPerRange = maxScopesPerRange * 2;
+    m_ranges.assign(rangeCount, Range());
+
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = m_queriesPerRange * rangeCount;
+    if (vkCreateQueryPool(m_device, &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS)
+    {
+        lerror("Failed to create timestamp query pool!");
+        m_queryPool = VK_NULL_HANDLE;
+        return false;
+    }
+
+    ldebug("GPU profiler created: {} ranges of {} scopes, timestamp period {} ns",
+           rangeCount,
+           maxScopesPerRange,
+           m_timestampPeriod);
+    return true;
+}
+
+void GpuProfiler::destroy()
+{
+    if (m_queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+    m_ranges.clear();
+}
+
+void GpuProfiler::beginRange(VkCommandBuffer commandBuffer, uint32_t range)
+{
+    if (!enabled() || range >= m_ranges.size())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_ranges[range].scopes.clear();
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, range * m_queriesPerRange, m_queriesPerRange);
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t range, const char* name)
+{
+    if (!enabled() || range >= m_ranges.size())
+    {
+        return kInvalidScope;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<Scope>& scopes = m_ranges[range].scopes;
+    if (scopes.size() * 2 >= m_queriesPerRange)
+    {
+        return kInvalidScope;
+    }
+    const uint32_t query = range * m_queriesPerRange + static_cast<uint32_t>(scopes.size()) * 2;
+    scopes.push_back({name, query});
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, query);
+    return static_cast<uint32_t>(scopes.size() - 1);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t range, uint32_t scope)
+{
+    if (scope == kInvalidScope)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    vkCmdWriteTimestamp(
+        commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, m_ranges[range].scopes[scope].query + 1);
+}
+
+void GpuProfiler::submitted(uint32_t range)
+{
+    if (enabled() && range < m_ranges.size())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ranges[range].pending = true;
+    }
+}
+
+void GpuProfiler::collect(uint32_t range)
+{
+    if (!enabled() || range >= m_ranges.size())
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Range& queryRange = m_ranges[range];
+    if (!queryRange.pending || queryRange.scopes.empty())
+    {
+        return;
+    }
+    queryRange.pending = false;
+
+    const uint32_t queryCount = static_cast<uint32_t>(queryRange.scopes.size()) * 2;
+    std::vector<uint64_t> timestamps(queryCount);
+    // No VK_QUERY_RESULT_WAIT_BIT: the submission is complete, anything not available is dropped, never waited for.
+    if (vkGetQueryPoolResults(m_device,
+                              m_queryPool,
+                              range * m_queriesPerRange,
+                              queryCount,
+                              timestamps.size() * sizeof(uint64_t),
+                              timestamps.data(),
+                              sizeof(uint64_t),
+                              VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < queryRange.scopes.size(); ++i)
+    {
+        const uint64_t begin = timestamps[i * 2] & m_timestampMask;
+        const uint64_t end = timestamps[i * 2 + 1] & m_timestampMask;
+        const double milliSeconds = static_cast<double>((end - begin) & m_timestampMask) * m_timestampPeriod * 1e-6;
+        m_statistics[queryRange.scopes[i].name].add(milliSeconds);
+    }
+}
+
+void GpuProfiler::collectAll()
+{
+    for (uint32_t range = 0; range < m_ranges.size(); ++range)
+    {
+        collect(range);
+    }
+}
+
+void GpuProfiler::logStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_statistics)
+    {
+        const RollingStatistics& statistics = entry.second;
+        linfo("GPU scope {}: {} samples, min {:.4f} ms, avg {:.4f} ms, p99 {:.4f} ms",
+              entry.first.c_str(),
+              statistics.count(),
+              statistics.min(),
+              statistics.average(),
+              statistics.percentile(99.0));
+    }
+}
+
+bool GpuProfiler::writeJson(const std::string& filePath) const
+{
+    std::ofstream file(filePath, std::ios::trunc);
+    if (!file.is_open())
+    {
+        lerror("Failed to open file {}", filePath.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    file << "{\n  \"unit\": \"ms\",\n  \"scopes\": [";
+    const char* separator = "\n";
+    for (const auto& entry : m_statistics)
+    {
+        const RollingStatistics& statistics = entry.second;
+        file << separator << "    {\"name\": \"" << entry.first << "\", \"samples\": " << statistics.count()
+             << ", \"min\": " << statistics.min() << ", \"avg\": " << statistics.average()
+             << ", \"p99\": " << statistics.percentile(99.0) << "}";
+        separator = ",\n";
+    }
+    file << "\n  ]\n}\n";
+
+    ldebug("GPU profile written to {}", filePath.c_str());
+    return file.good();
+}
@@ -0,0 +1,26 @@
+// Hello Vulkan triangle demo
+// See original from: https://vulkan-tutorial.com/, for more details.
+
+#include "goboVkTriangle/goboVkTriangle.h"
+#include "cpuProfiler.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstdlib>
+
+int main(int argc, char* argv[])
+{
+    sorban::loom::loggerInit("./goboVkTriangle.log", 10, 3);
+    PROFILE_THREAD_NAME("main");
+
+    ApplicationConfig config;
+    if (!parseCommandLine(argc, argv, config))
+    {
+        return EXIT_FAILURE;
+    }
+
+    const bool succeeded = runApplication(config);
+
+    linfo("Event loop finished, preparing to exit.");
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
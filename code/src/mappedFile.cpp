@@ -0,0 +1,190 @@
+#include "mappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+    : m_data(nullptr),
+      m_size(0),
+      m_isOpen(false)
+#ifdef _WIN32
+      ,
+      m_fileHandle(INVALID_HANDLE_VALUE),
+      m_mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filePath, AccessHint accessHint)
+{
+    close();
+
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (accessHint == AccessHint::Sequential)
+    {
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    }
+    else if (accessHint == AccessHint::Random)
+    {
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+    }
+    m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (m_fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_fileHandle, &fileSize))
+    {
+        close();
+        return false;
+    }
+    m_size = static_cast<uint64_t>(fileSize.QuadPart);
+    m_isOpen = true;
+    if (m_size == 0)
+    {
+        // Empty files cannot be mapped.
+        return true;
+    }
+
+    m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mappingHandle == nullptr)
+    {
+        close();
+        return false;
+    }
+    m_data = static_cast<char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle != nullptr)
+    {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_fileHandle);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+    m_fileHandle = INVALID_HANDLE_VALUE;
+    m_mappingHandle = nullptr;
+}
+
+void MappedFile::prefetch(uint64_t, uint64_t) const
+{
+    // FILE_FLAG_SEQUENTIAL_SCAN covers the common case, there is no cheap per range hint before Windows 8.
+}
+
+#else
+
+bool MappedFile::open(const std::string& filePath, AccessHint accessHint)
+{
+    close();
+
+    const int fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStatus;
+    if (fstat(fileDescriptor, &fileStatus) != 0)
+    {
+        ::close(fileDescriptor);
+        return false;
+    }
+    m_size = static_cast<uint64_t>(fileStatus.st_size);
+    m_isOpen = true;
+    if (m_size == 0)
+    {
+        // Empty files cannot be mapped.
+        ::close(fileDescriptor);
+        return true;
+    }
+
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    // The mapping keeps its own reference to the file.
+    ::close(fileDescriptor);
+    if (data == MAP_FAILED)
+    {
+        m_size = 0;
+        m_isOpen = false;
+        return false;
+    }
+    m_data = static_cast<char*>(data);
+
+    if (accessHint == AccessHint::Sequential)
+    {
+        madvise(m_data, m_size, MADV_SEQUENTIAL);
+    }
+    else if (accessHint == AccessHint::Random)
+    {
+        madvise(m_data, m_size, MADV_RANDOM);
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (m_data != nullptr)
+    {
+        munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isOpen = false;
+}
+
+void MappedFile::prefetch(uint64_t offset, uint64_t size) const
+{
+    if (m_data == nullptr || offset >= m_size)
+    {
+        return;
+    }
+
+    // madvise needs a page aligned start.
+    const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t begin = offset & ~(pageSize - 1);
+    const uint64_t end = offset + size < m_size ? offset + size : m_size;
+    madvise(m_data + begin, end - begin, MADV_WILLNEED);
+}
+
+#endif
+
+bool MappedFile::span(uint64_t offset, uint64_t size, uint64_t alignment, const char*& span) const
+{
+    if (offset > m_size || size > m_size - offset || (alignment > 0 && (offset & (alignment - 1)) != 0))
+    {
+        return false;
+    }
+    span = m_data + offset;
+    return true;
+}
@@ -0,0 +1,123 @@
+#include "pipelineBuildService.h"
+
+#include "cpuProfiler.h"
+#include "workerPool.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+PipelineBuildService::PipelineBuildService()
+    : m_device(VK_NULL_HANDLE),
+      m_threadCount(0),
+      m_finishedCount(0),
+      m_cancelled(false),
+      m_buildTime(std::chrono::steady_clock::duration::zero())
+{
+}
+
+PipelineBuildService::~PipelineBuildService()
+{
+    destroy();
+}
+
+void PipelineBuildService::init(VkDevice device, uint32_t threadCount)
+{
+    m_device = device;
+    m_cancelled = false;
+    m_workerPool.reset(new WorkerPool(threadCount));
+    m_threadCount = m_workerPool->threadCount();
+    ldebug("Pipeline build service started with {} threads.", m_threadCount);
+}
+
+void PipelineBuildService::destroy()
+{
+    if (!m_workerPool)
+    {
+        return;
+    }
+
+    // Queued jobs still run when the pool shuts down, they return right away once cancelled.
+    m_cancelled = true;
+    m_workerPool.reset();
+
+    for (VkPipeline pipeline : m_pipelines)
+    {
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(m_device, pipeline, nullptr);
+        }
+    }
+    m_pipelines.clear();
+    m_finishedCount = 0;
+}
+
+uint32_t PipelineBuildService::enqueue(BuildFunction build)
+{
+    uint32_t index = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_finishedCount == m_pipelines.size())
+        {
+            m_firstEnqueue = std::chrono::steady_clock::now();
+            m_buildTime = std::chrono::steady_clock::duration::zero();
+        }
+        index = static_cast<uint32_t>(m_pipelines.size());
+        m_pipelines.push_back(VK_NULL_HANDLE);
+    }
+    m_workerPool->submit([this, index, build]() { run(index, build); });
+    return index;
+}
+
+VkPipeline PipelineBuildService::pipeline(uint32_t index) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return index < m_pipelines.size() ? m_pipelines[index] : VK_NULL_HANDLE;
+}
+
+uint32_t PipelineBuildService::pipelineCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<uint32_t>(m_pipelines.size());
+}
+
+uint32_t PipelineBuildService::finishedCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_finishedCount;
+}
+
+std::chrono::steady_clock::duration PipelineBuildService::buildTime() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_buildTime;
+}
+
+void PipelineBuildService::waitAll()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_buildFinished.wait(lock, [this]() { return m_finishedCount == m_pipelines.size(); });
+}
+
+void PipelineBuildService::run(uint32_t index, const BuildFunction& build)
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (!m_cancelled)
+    {
+        PROFILE_ZONE("build pipeline");
+        pipeline = build();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pipelines[index] = pipeline;
+        ++m_finishedCount;
+        if (m_finishedCount == m_pipelines.size() && !m_cancelled)
+        {
+            m_buildTime = std::chrono::steady_clock::now() - m_firstEnqueue;
+            linfo("{} pipelines built in {:.3f} ms on {} threads",
+                  m_pipelines.size(),
+                  std::chrono::duration<double, std::milli>(m_buildTime).count(),
+                  m_threadCount);
+        }
+    }
+    m_buildFinished.notify_all();
+}
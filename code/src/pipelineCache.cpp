@@ -0,0 +1,237 @@
+#include "pipelineCache.h"
+
+#include "cpuProfiler.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const uint32_t kPipelineCacheFileMagic = 0x48435047; // "GPCH"
+static const uint32_t kPipelineCacheFileVersion = 1;
+
+struct PipelineCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    uint64_t dataSize;
+    uint64_t dataChecksum;
+};
+
+// Layout of the header every driver puts in front of its pipeline cache data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE).
+struct DriverPipelineCacheHeader
+{
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+};
+
+static uint64_t fnv1a(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+PersistentPipelineCache::PersistentPipelineCache()
+    : m_device(VK_NULL_HANDLE), m_pipelineCache(VK_NULL_HANDLE), m_vendorID(0), m_deviceID(0), m_loadedSize(0)
+{
+    std::memset(m_pipelineCacheUUID, 0, sizeof(m_pipelineCacheUUID));
+}
+
+bool PersistentPipelineCache::create(VkDevice device,
+                                     const VkPhysicalDeviceProperties& deviceProperties,
+                                     const std::string& filePath)
+{
+    PROFILE_FUNCTION();
+    m_device = device;
+    m_filePath = filePath;
+    m_vendorID = deviceProperties.vendorID;
+    m_deviceID = deviceProperties.deviceID;
+    std::memcpy(m_pipelineCacheUUID, deviceProperties.pipelineCacheUUID, sizeof(m_pipelineCacheUUID));
+
+    // The driver copies the initial data, it is read straight from the mapped file.
+    MappedFile file;
+    const char* blob = nullptr;
+    size_t blobSize = 0;
+    if (!m_filePath.empty() && !loadBlob(file, blob, blobSize))
+    {
+        blob = nullptr;
+        blobSize = 0;
+    }
+
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = blobSize;
+    createInfo.pInitialData = blobSize > 0 ? blob : nullptr;
+    if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache) != VK_SUCCESS)
+    {
+        // Drivers may still reject data that passed our checks, fall back to an empty cache.
+        lerror("Failed to create pipeline cache from {} bytes of data, starting with an empty cache.", blobSize);
+        createInfo.initialDataSize = 0;
+        createInfo.pInitialData = nullptr;
+        if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache) != VK_SUCCESS)
+        {
+            lerror("Failed to create pipeline cache!");
+            return false;
+        }
+        blobSize = 0;
+    }
+    m_loadedSize = blobSize;
+
+    ldebug("Pipeline cache created, {} bytes loaded from {}", m_loadedSize, m_filePath.c_str());
+    return true;
+}
+
+bool PersistentPipelineCache::save() const
+{
+    PROFILE_FUNCTION();
+    if (m_pipelineCache == VK_NULL_HANDLE || m_filePath.empty())
+    {
+        return false;
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS)
+    {
+        lerror("Failed to query pipeline cache size!");
+        return false;
+    }
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+    {
+        lerror("Failed to read pipeline cache data!");
+        return false;
+    }
+    data.resize(dataSize);
+
+    PipelineCacheFileHeader header = {};
+    header.magic = kPipelineCacheFileMagic;
+    header.version = kPipelineCacheFileVersion;
+    header.vendorID = m_vendorID;
+    header.deviceID = m_deviceID;
+    std::memcpy(header.pipelineCacheUUID, m_pipelineCacheUUID, sizeof(header.pipelineCacheUUID));
+    header.dataSize = data.size();
+    header.dataChecksum = fnv1a(data.data(), data.size());
+
+    // Write next to the target and rename, a crash mid-write must not leave a half written cache behind.
+    const std::string tempPath = m_filePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            lerror("Failed to open file {}", tempPath.c_str());
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(data.data(), data.size());
+        if (!file.good())
+        {
+            lerror("Failed to write pipeline cache to {}", tempPath.c_str());
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // rename does not replace an existing file on Windows.
+    std::remove(m_filePath.c_str());
+#endif
+    // POSIX rename replaces the target atomically, a crash leaves either the old or the new cache.
+    if (std::rename(tempPath.c_str(), m_filePath.c_str()) != 0)
+    {
+        lerror("Failed to move pipeline cache to {}", m_filePath.c_str());
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    ldebug("Pipeline cache saved, {} bytes written to {}", data.size(), m_filePath.c_str());
+    return true;
+}
+
+void PersistentPipelineCache::destroy()
+{
+    if (m_pipelineCache != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+        m_pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+bool PersistentPipelineCache::loadBlob(MappedFile& file, const char*& blob, size_t& blobSize) const
+{
+    if (!file.open(m_filePath, MappedFile::AccessHint::Sequential))
+    {
+        linfo("No pipeline cache found at {}, starting with an empty cache.", m_filePath.c_str());
+        return false;
+    }
+
+    const size_t fileSize = static_cast<size_t>(file.size());
+    if (!isBlobCompatible(file.data(), fileSize))
+    {
+        return false;
+    }
+
+    blob = file.data() + sizeof(PipelineCacheFileHeader);
+    blobSize = fileSize - sizeof(PipelineCacheFileHeader);
+    return true;
+}
+
+bool PersistentPipelineCache::isBlobCompatible(const char* fileContent, size_t fileSize) const
+{
+    PipelineCacheFileHeader header;
+    if (fileSize < sizeof(header))
+    {
+        lerror("Pipeline cache {} is truncated, discarding it.", m_filePath.c_str());
+        return false;
+    }
+    std::memcpy(&header, fileContent, sizeof(header));
+
+    if (header.magic != kPipelineCacheFileMagic || header.version != kPipelineCacheFileVersion)
+    {
+        lerror("Pipeline cache {} has an unknown format, discarding it.", m_filePath.c_str());
+        return false;
+    }
+    if (header.vendorID != m_vendorID || header.deviceID != m_deviceID ||
+        std::memcmp(header.pipelineCacheUUID, m_pipelineCacheUUID, sizeof(m_pipelineCacheUUID)) != 0)
+    {
+        linfo("Pipeline cache {} was created by another device or driver, discarding it.", m_filePath.c_str());
+        return false;
+    }
+
+    const char* data = fileContent + sizeof(header);
+    const size_t dataSize = fileSize - sizeof(header);
+    if (header.dataSize != dataSize || header.dataChecksum != fnv1a(data, dataSize))
+    {
+        lerror("Pipeline cache {} is corrupt, discarding it.", m_filePath.c_str());
+        return false;
+    }
+
+    // Cross check the header the driver wrote itself, it has to describe the same device.
+    DriverPipelineCacheHeader driverHeader;
+    if (dataSize < sizeof(driverHeader))
+    {
+        lerror("Pipeline cache {} holds no driver data, discarding it.", m_filePath.c_str());
+        return false;
+    }
+    std::memcpy(&driverHeader, data, sizeof(driverHeader));
+    if (driverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driverHeader.vendorID != m_vendorID ||
+        driverHeader.deviceID != m_deviceID ||
+        std::memcmp(driverHeader.pipelineCacheUUID, m_pipelineCacheUUID, sizeof(m_pipelineCacheUUID)) != 0)
+    {
+        linfo("Pipeline cache {} does not match the driver, discarding it.", m_filePath.c_str());
+        return false;
+    }
+
+    return true;
+}
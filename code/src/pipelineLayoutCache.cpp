@@ -0,0 +1,290 @@
+#include "pipelineLayoutCache.h"
+
+#include "vertexLayout.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+PipelineLayoutCache::PipelineLayoutCache() : m_device(VK_NULL_HANDLE), m_dynamicUniformBuffers(false)
+{
+}
+
+void PipelineLayoutCache::init(VkDevice device, bool dynamicUniformBuffers)
+{
+    m_device = device;
+    m_dynamicUniformBuffers = dynamicUniformBuffers;
+}
+
+void PipelineLayoutCache::destroy()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : m_pipelineLayouts)
+    {
+        vkDestroyPipelineLayout(m_device, entry.second.layout, nullptr);
+    }
+    for (VkDescriptorSetLayout setLayout : m_setLayouts)
+    {
+        vkDestroyDescriptorSetLayout(m_device, setLayout, nullptr);
+    }
+    m_pipelineLayouts.clear();
+    m_setLayoutIndices.clear();
+    m_setLayouts.clear();
+}
+
+bool PipelineLayoutCache::pipelineLayout(const std::vector<const ShaderReflection*>& stages,
+                                         VkPipelineLayout& layout,
+                                         std::vector<VkDescriptorSetLayout>* setLayouts)
+{
+    // Merge the bindings of all stages, the stages using a binding share it.
+    std::map<std::pair<uint32_t, uint32_t>, VkDescriptorSetLayoutBinding> bindings;
+    VkPushConstantRange pushConstants = {};
+    uint32_t pushConstantEnd = 0;
+    for (const ShaderReflection* stage : stages)
+    {
+        const VkShaderStageFlagBits stageFlag = shaderStageFlag(stage->executionModel);
+        for (const ReflectedDescriptorBinding& reflected : stage->descriptorBindings)
+        {
+            if (reflected.count == 0)
+            {
+                lerror("Runtime sized descriptor arrays are not supported (set {}, binding {})",
+                       reflected.set,
+                       reflected.binding);
+                return false;
+            }
+            VkDescriptorSetLayoutBinding binding = {};
+            binding.binding = reflected.binding;
+            binding.descriptorType = m_dynamicUniformBuffers && reflected.kind == DescriptorKind::UniformBuffer
+                                         ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC
+                                         : descriptorType(reflected.kind);
+            binding.descriptorCount = reflected.count;
+
+            const auto inserted = bindings.emplace(std::make_pair(reflected.set, reflected.binding), binding);
+            VkDescriptorSetLayoutBinding& merged = inserted.first->second;
+            if (merged.descriptorType != binding.descriptorType || merged.descriptorCount != binding.descriptorCount)
+            {
+                lerror("Shader stages disagree on set {}, binding {}", reflected.set, reflected.binding);
+                return false;
+            }
+            merged.stageFlags |= stageFlag;
+        }
+
+        if (stage->pushConstantSize > 0)
+        {
+            // One range covering every stage's block keeps the layout simple, stages may read different parts.
+            pushConstants.offset = pushConstants.stageFlags == 0
+                                       ? stage->pushConstantOffset
+                                       : std::min(pushConstants.offset, stage->pushConstantOffset);
+            pushConstants.stageFlags |= stageFlag;
+            pushConstantEnd = std::max(pushConstantEnd, stage->pushConstantOffset + stage->pushConstantSize);
+        }
+    }
+    pushConstants.size = pushConstantEnd - pushConstants.offset;
+
+    const uint32_t setCount = bindings.empty() ? 0 : bindings.rbegin()->first.first + 1;
+    std::vector<std::vector<VkDescriptorSetLayoutBinding>> setBindings(setCount);
+    for (const auto& entry : bindings)
+    {
+        setBindings[entry.first.first].push_back(entry.second);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Sets without bindings between used ones get an empty layout.
+    std::vector<uint32_t> key;
+    std::vector<uint32_t> setLayoutIndices(setCount);
+    for (uint32_t set = 0; set < setCount; ++set)
+    {
+        if (!descriptorSetLayout(setBindings[set], setLayoutIndices[set]))
+        {
+            return false;
+        }
+        key.push_back(setLayoutIndices[set]);
+    }
+    key.push_back(pushConstants.stageFlags);
+    key.push_back(pushConstants.offset);
+    key.push_back(pushConstants.size);
+
+    auto found = m_pipelineLayouts.find(key);
+    if (found == m_pipelineLayouts.end())
+    {
+        std::vector<VkDescriptorSetLayout> layouts(setCount);
+        for (uint32_t set = 0; set < setCount; ++set)
+        {
+            layouts[set] = m_setLayouts[setLayoutIndices[set]];
+        }
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = setCount;
+        pipelineLayoutInfo.pSetLayouts = layouts.empty() ? nullptr : layouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = pushConstants.size > 0 ? 1 : 0;
+        pipelineLayoutInfo.pPushConstantRanges = pushConstants.size > 0 ? &pushConstants : nullptr;
+        VkPipelineLayout created = VK_NULL_HANDLE;
+        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &created) != VK_SUCCESS)
+        {
+            lerror("Failed to create pipeline layout!");
+            return false;
+        }
+        ldebug("Pipeline layout created: {} descriptor sets, {} bytes of push constants", setCount, pushConstants.size);
+        found = m_pipelineLayouts.emplace(key, CachedPipelineLayout{created, setLayoutIndices}).first;
+    }
+
+    layout = found->second.layout;
+    if (setLayouts != nullptr)
+    {
+        setLayouts->clear();
+        for (uint32_t index : found->second.setLayoutIndices)
+        {
+            setLayouts->push_back(m_setLayouts[index]);
+        }
+    }
+    return true;
+}
+
+size_t PipelineLayoutCache::WordsHash::operator()(const std::vector<uint32_t>& words) const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (uint32_t word : words)
+    {
+        hash ^= word;
+        hash *= 1099511628211ull;
+    }
+    return static_cast<size_t>(hash);
+}
+
+bool PipelineLayoutCache::descriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                              uint32_t& index)
+{
+    std::vector<uint32_t> key;
+    key.reserve(bindings.size() * 4);
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        key.push_back(binding.binding);
+        key.push_back(static_cast<uint32_t>(binding.descriptorType));
+        key.push_back(binding.descriptorCount);
+        key.push_back(binding.stageFlags);
+    }
+
+    const auto found = m_setLayoutIndices.find(key);
+    if (found != m_setLayoutIndices.end())
+    {
+        index = found->second;
+        return true;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.empty() ? nullptr : bindings.data();
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+    {
+        lerror("Failed to create descriptor set layout!");
+        return false;
+    }
+
+    index = static_cast<uint32_t>(m_setLayouts.size());
+    m_setLayouts.push_back(setLayout);
+    m_setLayoutIndices.emplace(key, index);
+    return true;
+}
+
+VkShaderStageFlagBits shaderStageFlag(ShaderExecutionModel executionModel)
+{
+    switch (executionModel)
+    {
+    case ShaderExecutionModel::Vertex:
+        return VK_SHADER_STAGE_VERTEX_BIT;
+    case ShaderExecutionModel::TessellationControl:
+        return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case ShaderExecutionModel::TessellationEvaluation:
+        return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case ShaderExecutionModel::Geometry:
+        return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case ShaderExecutionModel::Fragment:
+        return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case ShaderExecutionModel::GLCompute:
+        return VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    return VK_SHADER_STAGE_ALL;
+}
+
+VkDescriptorType descriptorType(DescriptorKind kind)
+{
+    switch (kind)
+    {
+    case DescriptorKind::Sampler:
+        return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case DescriptorKind::CombinedImageSampler:
+        return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    case DescriptorKind::SampledImage:
+        return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    case DescriptorKind::StorageImage:
+        return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    case DescriptorKind::UniformTexelBuffer:
+        return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+    case DescriptorKind::StorageTexelBuffer:
+        return VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+    case DescriptorKind::UniformBuffer:
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    case DescriptorKind::StorageBuffer:
+        return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case DescriptorKind::InputAttachment:
+        return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    }
+    return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+}
+
+VkFormat vertexInputFormat(const ReflectedVertexInput& input)
+{
+    if (input.componentWidth != 32 || input.componentCount < 1 || input.componentCount > 4)
+    {
+        return VK_FORMAT_UNDEFINED;
+    }
+
+    static const VkFormat kFloatFormats[] = {
+        VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+    static const VkFormat kSignedFormats[] = {
+        VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+    static const VkFormat kUnsignedFormats[] = {
+        VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+    switch (input.componentKind)
+    {
+    case ComponentKind::Float:
+        return kFloatFormats[input.componentCount - 1];
+    case ComponentKind::SignedInt:
+        return kSignedFormats[input.componentCount - 1];
+    case ComponentKind::UnsignedInt:
+        return kUnsignedFormats[input.componentCount - 1];
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool validateVertexLayout(const ShaderReflection& vertexShader, const VertexLayout& vertexLayout)
+{
+    bool valid = true;
+    for (const ReflectedVertexInput& input : vertexShader.vertexInputs)
+    {
+        const auto& attributes = vertexLayout.attributes();
+        const auto attribute =
+            std::find_if(attributes.begin(), attributes.end(), [&input](const VkVertexInputAttributeDescription& a) {
+                return a.location == input.location;
+            });
+        if (attribute == attributes.end())
+        {
+            lerror("Vertex layout has no attribute for shader input location {}", input.location);
+            valid = false;
+        }
+        else if (attribute->format != vertexInputFormat(input))
+        {
+            lerror("Vertex attribute at location {} has format {}, the shader expects {}",
+                   input.location,
+                   static_cast<int>(attribute->format),
+                   static_cast<int>(vertexInputFormat(input)));
+            valid = false;
+        }
+    }
+    return valid;
+}
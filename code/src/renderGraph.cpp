@@ -0,0 +1,495 @@
+#include "renderGraph.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+struct UsageInfo
+{
+    VkImageLayout layout;
+    VkPipelineStageFlags stages;
+    // Access of a use reading the previous contents, attachments only read them when loading.
+    VkAccessFlags readAccess;
+    VkAccessFlags writeAccess;
+    VkImageUsageFlags usageFlag;
+    bool attachment;
+};
+
+// Access state of an image while walking the passes in execution order.
+struct TrackedState
+{
+    VkImageLayout layout;
+    // The last write or layout transition and the reads since.
+    VkPipelineStageFlags writeStages;
+    VkAccessFlags writeAccess;
+    VkPipelineStageFlags readStages;
+    // Stages and accesses the last write has been made visible to.
+    VkPipelineStageFlags visibleStages;
+    VkAccessFlags visibleAccess;
+};
+}
+
+static UsageInfo usageInfo(ImageUsage usage)
+{
+    switch (usage)
+    {
+    case ImageUsage::ColorAttachment:
+        return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                true};
+    case ImageUsage::DepthStencilAttachment:
+        return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                true};
+    case ImageUsage::FragmentSampled:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                0,
+                VK_IMAGE_USAGE_SAMPLED_BIT,
+                false};
+    case ImageUsage::ComputeSampled:
+        return {VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                0,
+                VK_IMAGE_USAGE_SAMPLED_BIT,
+                false};
+    case ImageUsage::ComputeStorage:
+        return {VK_IMAGE_LAYOUT_GENERAL,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT,
+                VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_USAGE_STORAGE_BIT,
+                false};
+    case ImageUsage::TransferSrc:
+        return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_ACCESS_TRANSFER_READ_BIT,
+                0,
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                false};
+    case ImageUsage::TransferDst:
+        break;
+    }
+    // A copy may cover only part of the image, so the contents are kept even though they are not read.
+    return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            false};
+}
+
+static bool readsContents(const UsageInfo& info, AttachmentLoad load)
+{
+    return info.attachment ? load == AttachmentLoad::Load : info.readAccess != 0;
+}
+
+static bool discardsContents(const UsageInfo& info, AttachmentLoad load)
+{
+    return info.attachment && load != AttachmentLoad::Load;
+}
+
+// A barrier needs stages on both sides, fallback stands in for an empty side.
+static VkPipelineStageFlags stagesOr(VkPipelineStageFlags stages, VkPipelineStageFlags fallback)
+{
+    return stages != 0 ? stages : fallback;
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+RenderGraph::RenderGraph() : m_transientMemorySize(0), m_unaliasedMemorySize(0)
+{
+}
+
+uint32_t RenderGraph::importImage(const std::string& name,
+                                  VkFormat format,
+                                  const ImageState& initialState,
+                                  const ImageState& finalState)
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.format = format;
+    resource.transient = false;
+    resource.initialState = initialState;
+    resource.finalState = finalState;
+    m_resources.push_back(resource);
+    return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::createImage(const std::string& name, const TransientImageDesc& desc)
+{
+    Resource resource = {};
+    resource.name = name;
+    resource.format = desc.format;
+    resource.transient = true;
+    resource.desc = desc;
+    m_resources.push_back(resource);
+    return static_cast<uint32_t>(m_resources.size() - 1);
+}
+
+uint32_t RenderGraph::addPass(const std::string& name, bool sideEffects)
+{
+    Pass pass;
+    pass.name = name;
+    pass.sideEffects = sideEffects;
+    pass.culled = false;
+    m_passes.push_back(pass);
+    return static_cast<uint32_t>(m_passes.size() - 1);
+}
+
+void RenderGraph::useImage(uint32_t pass, uint32_t resource, ImageUsage usage, AttachmentLoad load)
+{
+    m_passes[pass].uses.push_back({resource, usage, load});
+}
+
+void RenderGraph::clear()
+{
+    m_passes.clear();
+    m_resources.clear();
+    m_passOrder.clear();
+    m_batches.clear();
+    m_transientMemorySize = 0;
+    m_unaliasedMemorySize = 0;
+}
+
+bool RenderGraph::compile(const FootprintFunction& footprint)
+{
+    for (Pass& pass : m_passes)
+    {
+        pass.attachments.clear();
+        for (size_t i = 0; i < pass.uses.size(); ++i)
+        {
+            if (pass.uses[i].resource >= m_resources.size())
+            {
+                return false;
+            }
+            for (size_t j = 0; j < i; ++j)
+            {
+                if (pass.uses[j].resource == pass.uses[i].resource)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    cullPasses();
+
+    for (Resource& resource : m_resources)
+    {
+        resource.usageFlags = 0;
+        resource.firstUse = std::numeric_limits<uint32_t>::max();
+        resource.lastUse = 0;
+        resource.memoryOffset = 0;
+    }
+    // Only reading a transient image before anything wrote it is a declaration error.
+    std::vector<bool> written(m_resources.size(), false);
+    for (uint32_t orderIndex = 0; orderIndex < m_passOrder.size(); ++orderIndex)
+    {
+        for (const Use& use : m_passes[m_passOrder[orderIndex]].uses)
+        {
+            Resource& resource = m_resources[use.resource];
+            const UsageInfo info = usageInfo(use.usage);
+            if (resource.transient && !written[use.resource] && info.writeAccess == 0)
+            {
+                return false;
+            }
+            written[use.resource] = written[use.resource] || info.writeAccess != 0;
+            resource.usageFlags |= info.usageFlag;
+            resource.firstUse = std::min(resource.firstUse, orderIndex);
+            resource.lastUse = std::max(resource.lastUse, orderIndex);
+        }
+    }
+
+    for (uint32_t i = 0; i < m_resources.size(); ++i)
+    {
+        if (m_resources[i].transient && resourceUsed(i))
+        {
+            m_resources[i].footprint = footprint(i);
+        }
+    }
+
+    placeTransientImages();
+    deriveBarriers();
+    deriveAttachments();
+    return true;
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walks the passes backwards. A pass is needed when it writes contents a later pass or the outside reads.
+    // Overwriting an image without reading it ends the need for its earlier writers.
+    std::vector<bool> needed(m_resources.size());
+    for (size_t i = 0; i < m_resources.size(); ++i)
+    {
+        needed[i] = !m_resources[i].transient;
+    }
+    for (size_t p = m_passes.size(); p-- > 0;)
+    {
+        Pass& pass = m_passes[p];
+        pass.culled = !pass.sideEffects;
+        for (const Use& use : pass.uses)
+        {
+            if (usageInfo(use.usage).writeAccess != 0 && needed[use.resource])
+            {
+                pass.culled = false;
+            }
+        }
+        if (pass.culled)
+        {
+            continue;
+        }
+        for (const Use& use : pass.uses)
+        {
+            const UsageInfo info = usageInfo(use.usage);
+            if (info.writeAccess != 0 && !readsContents(info, use.load))
+            {
+                needed[use.resource] = false;
+            }
+        }
+        for (const Use& use : pass.uses)
+        {
+            if (readsContents(usageInfo(use.usage), use.load))
+            {
+                needed[use.resource] = true;
+            }
+        }
+    }
+
+    m_passOrder.clear();
+    for (uint32_t p = 0; p < m_passes.size(); ++p)
+    {
+        if (!m_passes[p].culled)
+        {
+            m_passOrder.push_back(p);
+        }
+    }
+}
+
+void RenderGraph::placeTransientImages()
+{
+    std::vector<uint32_t> transients;
+    for (uint32_t i = 0; i < m_resources.size(); ++i)
+    {
+        if (m_resources[i].transient && resourceUsed(i))
+        {
+            transients.push_back(i);
+        }
+    }
+    // Largest first, smaller images then fill the gaps between them.
+    std::stable_sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+        return m_resources[a].footprint.size > m_resources[b].footprint.size;
+    });
+
+    m_transientMemorySize = 0;
+    m_unaliasedMemorySize = 0;
+    std::vector<uint32_t> placed;
+    std::vector<uint32_t> conflicts;
+    for (uint32_t index : transients)
+    {
+        Resource& resource = m_resources[index];
+        // Only images alive at the same time compete for memory.
+        conflicts.clear();
+        for (uint32_t other : placed)
+        {
+            const Resource& otherResource = m_resources[other];
+            if (otherResource.firstUse <= resource.lastUse && resource.firstUse <= otherResource.lastUse)
+            {
+                conflicts.push_back(other);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end(), [this](uint32_t a, uint32_t b) {
+            return m_resources[a].memoryOffset < m_resources[b].memoryOffset;
+        });
+
+        // The lowest offset fitting between the conflicting images.
+        VkDeviceSize offset = 0;
+        for (uint32_t other : conflicts)
+        {
+            const Resource& otherResource = m_resources[other];
+            if (offset + resource.footprint.size <= otherResource.memoryOffset)
+            {
+                break;
+            }
+            offset = std::max(offset,
+                              alignUp(otherResource.memoryOffset + otherResource.footprint.size,
+                                      resource.footprint.alignment));
+        }
+        resource.memoryOffset = offset;
+        placed.push_back(index);
+
+        m_transientMemorySize = std::max(m_transientMemorySize, offset + resource.footprint.size);
+        m_unaliasedMemorySize = alignUp(m_unaliasedMemorySize, resource.footprint.alignment) + resource.footprint.size;
+    }
+}
+
+void RenderGraph::deriveBarriers()
+{
+    std::vector<TrackedState> states(m_resources.size());
+    for (size_t i = 0; i < m_resources.size(); ++i)
+    {
+        const Resource& resource = m_resources[i];
+        if (resource.transient)
+        {
+            states[i] = {VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0, 0};
+        }
+        else
+        {
+            // The access before the graph is pending like a write of our own.
+            const ImageState& initial = resource.initialState;
+            states[i] = {initial.layout, initial.stages, initial.access, 0, 0, 0};
+        }
+    }
+
+    m_batches.assign(m_passOrder.size() + 1, BarrierBatch());
+    for (uint32_t orderIndex = 0; orderIndex < m_passOrder.size(); ++orderIndex)
+    {
+        BarrierBatch& batch = m_batches[orderIndex];
+        for (const Use& use : m_passes[m_passOrder[orderIndex]].uses)
+        {
+            const Resource& resource = m_resources[use.resource];
+            TrackedState& state = states[use.resource];
+            const UsageInfo info = usageInfo(use.usage);
+            const bool reads = readsContents(info, use.load);
+            const bool writes = info.writeAccess != 0;
+            const VkAccessFlags access = (reads ? info.readAccess : 0) | info.writeAccess;
+
+            const bool layoutChange = info.layout != state.layout;
+            VkPipelineStageFlags srcStages = 0;
+            bool barrier = false;
+            if (layoutChange || (writes && (state.writeStages | state.readStages) != 0))
+            {
+                // Transitions and writes wait for every earlier access, reads and writes alike.
+                barrier = true;
+                srcStages = state.writeStages | state.readStages;
+            }
+            else if (reads && state.writeStages != 0 &&
+                     ((info.stages & ~state.visibleStages) != 0 || (access & ~state.visibleAccess) != 0))
+            {
+                // Reads only wait for the last write, and only once per stage.
+                barrier = true;
+                srcStages = state.writeStages;
+            }
+
+            VkAccessFlags srcAccess = state.writeAccess;
+            if (resource.transient && resource.firstUse == orderIndex)
+            {
+                // An aliased image's first use also waits for the images that used its memory before, and makes their
+                // last writes available before it overwrites the memory.
+                for (uint32_t other = 0; other < m_resources.size(); ++other)
+                {
+                    const Resource& otherResource = m_resources[other];
+                    if (other != use.resource && otherResource.transient && resourceUsed(other) &&
+                        otherResource.lastUse < orderIndex &&
+                        otherResource.memoryOffset < resource.memoryOffset + resource.footprint.size &&
+                        resource.memoryOffset < otherResource.memoryOffset + otherResource.footprint.size)
+                    {
+                        srcStages |= states[other].writeStages | states[other].readStages;
+                        srcAccess |= states[other].writeAccess;
+                    }
+                }
+            }
+
+            if (barrier)
+            {
+                const VkImageLayout oldLayout =
+                    layoutChange && discardsContents(info, use.load) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+                batch.srcStages |= stagesOr(srcStages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                batch.dstStages |= info.stages;
+                batch.imageBarriers.push_back({use.resource, oldLayout, info.layout, srcAccess, access});
+                if (layoutChange)
+                {
+                    // Later accesses have to wait for the transition, which happens before the stages of this one.
+                    state = {info.layout, info.stages, 0, 0, info.stages, access};
+                }
+                else
+                {
+                    state.visibleStages |= info.stages;
+                    state.visibleAccess |= access;
+                }
+            }
+
+            if (writes)
+            {
+                state.writeStages = info.stages;
+                state.writeAccess = info.writeAccess;
+                state.readStages = 0;
+                state.visibleStages = 0;
+                state.visibleAccess = 0;
+            }
+            else
+            {
+                state.readStages |= info.stages;
+            }
+        }
+    }
+
+    BarrierBatch& finalBatch = m_batches.back();
+    for (uint32_t i = 0; i < m_resources.size(); ++i)
+    {
+        const Resource& resource = m_resources[i];
+        const TrackedState& state = states[i];
+        if (resource.transient || (resource.finalState.layout == state.layout && !resourceUsed(i)))
+        {
+            continue;
+        }
+        const VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+        finalBatch.srcStages |= stagesOr(srcStages, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        finalBatch.dstStages |= stagesOr(resource.finalState.stages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        finalBatch.imageBarriers.push_back(
+            {i, state.layout, resource.finalState.layout, state.writeAccess, resource.finalState.access});
+    }
+}
+
+void RenderGraph::deriveAttachments()
+{
+    for (uint32_t orderIndex = 0; orderIndex < m_passOrder.size(); ++orderIndex)
+    {
+        Pass& pass = m_passes[m_passOrder[orderIndex]];
+        for (const Use& use : pass.uses)
+        {
+            const UsageInfo info = usageInfo(use.usage);
+            if (!info.attachment)
+            {
+                continue;
+            }
+
+            // Stored when the outside or the next pass using the image reads it.
+            bool store = !m_resources[use.resource].transient;
+            for (uint32_t later = orderIndex + 1; later < m_passOrder.size(); ++later)
+            {
+                const std::vector<Use>& laterUses = m_passes[m_passOrder[later]].uses;
+                const auto found = std::find_if(laterUses.begin(), laterUses.end(), [&use](const Use& laterUse) {
+                    return laterUse.resource == use.resource;
+                });
+                if (found != laterUses.end())
+                {
+                    const UsageInfo laterInfo = usageInfo(found->usage);
+                    store = readsContents(laterInfo, found->load) || !discardsContents(laterInfo, found->load);
+                    break;
+                }
+            }
+
+            GraphAttachment attachment = {};
+            attachment.resource = use.resource;
+            attachment.layout = info.layout;
+            attachment.loadOp = use.load == AttachmentLoad::Clear  ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                : use.load == AttachmentLoad::Load ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                                                   : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            pass.attachments.push_back(attachment);
+        }
+    }
+}
@@ -0,0 +1,337 @@
+#include "renderGraphExecutor.h"
+
+#include "cpuProfiler.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <algorithm>
+
+static VkImageAspectFlags aspectMask(VkFormat format)
+{
+    switch (format)
+    {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    case VK_FORMAT_S8_UINT:
+        return VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+RenderGraphExecutor::RenderGraphExecutor()
+    : m_device(VK_NULL_HANDLE), m_allocator(nullptr), m_graph(nullptr), m_slotCount(0), m_memoryTypeBits(0)
+{
+}
+
+void RenderGraphExecutor::init(VkDevice device, GpuMemoryAllocator& allocator)
+{
+    m_device = device;
+    m_allocator = &allocator;
+}
+
+bool RenderGraphExecutor::build(RenderGraph& graph, uint32_t slotCount)
+{
+    PROFILE_FUNCTION();
+    destroy();
+    m_graph = &graph;
+    m_slotCount = std::max(1u, slotCount);
+    m_images.assign(m_slotCount * graph.resourceCount(), VK_NULL_HANDLE);
+    m_imageViews.assign(m_images.size(), VK_NULL_HANDLE);
+    m_memoryTypeBits = ~0u;
+
+    // The images of the first slot are created while compiling, the placement depends on their memory requirements.
+    bool imagesCreated = true;
+    const auto footprint = [this, &imagesCreated](uint32_t resource) {
+        MemoryFootprint result = {0, 1};
+        imagesCreated = createTransientImage(0, resource, result) && imagesCreated;
+        return result;
+    };
+    if (!graph.compile(footprint))
+    {
+        lerror("Invalid render graph declaration!");
+        return false;
+    }
+    if (!imagesCreated || !createTransientImages())
+    {
+        return false;
+    }
+
+    m_renderPasses.assign(graph.passCount(), VK_NULL_HANDLE);
+    for (uint32_t pass : graph.passOrder())
+    {
+        if (!graph.attachments(pass).empty() && !createRenderPass(pass))
+        {
+            return false;
+        }
+    }
+
+    ldebug("Render graph built: {} of {} passes, {} frame slots of {} bytes of transient memory, {} without aliasing.",
+           graph.passOrder().size(),
+           graph.passCount(),
+           m_slotCount,
+           graph.transientMemorySize(),
+           graph.unaliasedMemorySize());
+    return true;
+}
+
+bool RenderGraphExecutor::resizeSlots(uint32_t slotCount)
+{
+    destroyTransientImages();
+    m_slotCount = std::max(1u, slotCount);
+    m_images.assign(m_slotCount * m_graph->resourceCount(), VK_NULL_HANDLE);
+    m_imageViews.assign(m_images.size(), VK_NULL_HANDLE);
+    return createTransientImages();
+}
+
+void RenderGraphExecutor::destroy()
+{
+    for (VkRenderPass renderPass : m_renderPasses)
+    {
+        vkDestroyRenderPass(m_device, renderPass, nullptr);
+    }
+    m_renderPasses.clear();
+    destroyTransientImages();
+    m_graph = nullptr;
+    m_slotCount = 0;
+}
+
+bool RenderGraphExecutor::createTransientImages()
+{
+    const RenderGraph& graph = *m_graph;
+    const uint32_t resourceCount = graph.resourceCount();
+    VkDeviceSize alignment = 1;
+    for (uint32_t slot = 0; slot < m_slotCount; ++slot)
+    {
+        for (uint32_t resource = 0; resource < resourceCount; ++resource)
+        {
+            const uint32_t index = slot * resourceCount + resource;
+            if (!graph.transient(resource) || !graph.resourceUsed(resource))
+            {
+                continue;
+            }
+            MemoryFootprint footprint = {0, 1};
+            if (m_images[index] == VK_NULL_HANDLE && !createTransientImage(slot, resource, footprint))
+            {
+                return false;
+            }
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(m_device, m_images[index], &requirements);
+            alignment = std::max(alignment, requirements.alignment);
+        }
+    }
+    if (graph.transientMemorySize() == 0)
+    {
+        return true;
+    }
+
+    // Every slot gets a region of the placed size, the images of a slot only alias each other.
+    const VkDeviceSize slotStride = alignUp(graph.transientMemorySize(), alignment);
+    VkMemoryRequirements requirements = {};
+    requirements.size = slotStride * m_slotCount;
+    requirements.alignment = alignment;
+    requirements.memoryTypeBits = m_memoryTypeBits;
+    if (!m_allocator->allocate(
+            requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, GpuResourceKind::Optimal, m_transientMemory))
+    {
+        lerror("Failed to allocate {} bytes of transient image memory!", requirements.size);
+        return false;
+    }
+
+    for (uint32_t slot = 0; slot < m_slotCount; ++slot)
+    {
+        for (uint32_t resource = 0; resource < resourceCount; ++resource)
+        {
+            const uint32_t index = slot * resourceCount + resource;
+            if (m_images[index] == VK_NULL_HANDLE)
+            {
+                continue;
+            }
+            vkBindImageMemory(m_device,
+                              m_images[index],
+                              m_transientMemory.memory,
+                              m_transientMemory.offset + slot * slotStride + graph.memoryOffset(resource));
+
+            VkImageViewCreateInfo viewInfo = {};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = m_images[index];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = graph.resourceFormat(resource);
+            viewInfo.subresourceRange.aspectMask = aspectMask(graph.resourceFormat(resource));
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+            if (vkCreateImageView(m_device, &viewInfo, nullptr, &m_imageViews[index]) != VK_SUCCESS)
+            {
+                lerror("Failed to create view of transient image {}!", graph.resourceName(resource));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void RenderGraphExecutor::destroyTransientImages()
+{
+    for (VkImageView imageView : m_imageViews)
+    {
+        vkDestroyImageView(m_device, imageView, nullptr);
+    }
+    m_imageViews.clear();
+    for (VkImage image : m_images)
+    {
+        vkDestroyImage(m_device, image, nullptr);
+    }
+    m_images.clear();
+    if (m_transientMemory.memory != VK_NULL_HANDLE)
+    {
+        m_allocator->free(m_transientMemory);
+        m_transientMemory = GpuAllocation();
+    }
+}
+
+void RenderGraphExecutor::recordBarriers(VkCommandBuffer commandBuffer,
+                                         uint32_t slot,
+                                         const BarrierBatch& batch,
+                                         const std::vector<VkImage>& importedImages)
+{
+    if (batch.empty())
+    {
+        return;
+    }
+
+    m_scratchBarriers.clear();
+    for (const GraphImageBarrier& graphBarrier : batch.imageBarriers)
+    {
+        const uint32_t resource = graphBarrier.resource;
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = graphBarrier.srcAccess;
+        barrier.dstAccessMask = graphBarrier.dstAccess;
+        barrier.oldLayout = graphBarrier.oldLayout;
+        barrier.newLayout = graphBarrier.newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_graph->transient(resource) ? m_images[slot * m_graph->resourceCount() + resource]
+                                                     : importedImages[resource];
+        barrier.subresourceRange.aspectMask = aspectMask(m_graph->resourceFormat(resource));
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.layerCount = 1;
+        m_scratchBarriers.push_back(barrier);
+    }
+    vkCmdPipelineBarrier(commandBuffer,
+                         batch.srcStages,
+                         batch.dstStages,
+                         0,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr,
+                         static_cast<uint32_t>(m_scratchBarriers.size()),
+                         m_scratchBarriers.data());
+}
+
+bool RenderGraphExecutor::createTransientImage(uint32_t slot, uint32_t resource, MemoryFootprint& footprint)
+{
+    VkImage& image = m_images[slot * m_graph->resourceCount() + resource];
+    const TransientImageDesc& desc = m_graph->transientDesc(resource);
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = desc.format;
+    imageInfo.extent = {desc.width, desc.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = m_graph->imageUsageFlags(resource);
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    {
+        lerror("Failed to create transient image {}!", m_graph->resourceName(resource));
+        return false;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, image, &requirements);
+    m_memoryTypeBits &= requirements.memoryTypeBits;
+    if (m_memoryTypeBits == 0)
+    {
+        lerror("Transient image {} shares no memory type with the others!", m_graph->resourceName(resource));
+        return false;
+    }
+    footprint.size = requirements.size;
+    footprint.alignment = requirements.alignment;
+    return true;
+}
+
+bool RenderGraphExecutor::createRenderPass(uint32_t pass)
+{
+    const std::vector<GraphAttachment>& attachments = m_graph->attachments(pass);
+    std::vector<VkAttachmentDescription> descriptions;
+    std::vector<VkAttachmentReference> colorReferences;
+    VkAttachmentReference depthReference = {};
+    bool hasDepth = false;
+    for (const GraphAttachment& attachment : attachments)
+    {
+        // The graph's barriers transition the attachments, the render pass keeps them in their layout.
+        VkAttachmentDescription description = {};
+        description.format = m_graph->resourceFormat(attachment.resource);
+        description.samples = VK_SAMPLE_COUNT_1_BIT;
+        description.loadOp = attachment.loadOp;
+        description.storeOp = attachment.storeOp;
+        description.stencilLoadOp = attachment.loadOp;
+        description.stencilStoreOp = attachment.storeOp;
+        description.initialLayout = attachment.layout;
+        description.finalLayout = attachment.layout;
+
+        VkAttachmentReference reference = {};
+        reference.attachment = static_cast<uint32_t>(descriptions.size());
+        reference.layout = attachment.layout;
+        descriptions.push_back(description);
+        if (attachment.layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
+        {
+            if (hasDepth)
+            {
+                lerror("Pass {} has more than one depth attachment!", m_graph->passName(pass));
+                return false;
+            }
+            depthReference = reference;
+            hasDepth = true;
+        }
+        else
+        {
+            colorReferences.push_back(reference);
+        }
+    }
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+    subpass.pColorAttachments = colorReferences.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPasses[pass]) != VK_SUCCESS)
+    {
+        lerror("Failed to create the render pass of {}!", m_graph->passName(pass));
+        return false;
+    }
+    return true;
+}
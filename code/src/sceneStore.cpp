@@ -0,0 +1,243 @@
+#include "sceneStore.h"
+
+#include <algorithm>
+
+const uint32_t Entity::kInvalidSlot;
+const uint32_t SceneStore::kDeadIndex;
+const uint64_t SceneStore::kEmptyKey;
+
+static const uint32_t kInitialCommandTableBits = 6;
+
+// Fibonacci hashing, shift leaves as many top bits as the table has index bits.
+static size_t commandTableIndex(uint64_t key, uint32_t shift)
+{
+    return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> shift);
+}
+
+template <typename T>
+static void removeSwap(std::vector<T>& values, uint32_t index)
+{
+    values[index] = values.back();
+    values.pop_back();
+}
+
+SceneStore::SceneStore(SimdLevel level)
+    : m_transforms(level),
+      m_commandTable(1u << kInitialCommandTableBits, CommandEntry{kEmptyKey, 0}),
+      m_commandTableShift(64 - kInitialCommandTableBits)
+{
+}
+
+uint32_t SceneStore::addMesh(const MeshRange& range)
+{
+    m_meshRanges.push_back(range);
+    return static_cast<uint32_t>(m_meshRanges.size() - 1);
+}
+
+Entity SceneStore::create(const EntityDesc& desc)
+{
+    Entity entity;
+    if (desc.mesh >= m_meshRanges.size())
+    {
+        return entity;
+    }
+    if (m_freeSlots.empty())
+    {
+        entity.slot = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back(Slot{kDeadIndex, 0});
+    }
+    else
+    {
+        entity.slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    Slot& slot = m_slots[entity.slot];
+    entity.generation = slot.generation;
+    slot.denseIndex = m_transforms.add(desc.position, desc.rotation, desc.scale, desc.localSphere);
+    m_meshes.push_back(desc.mesh);
+    m_materials.push_back(desc.material);
+    m_denseSlots.push_back(entity.slot);
+    return entity;
+}
+
+bool SceneStore::destroy(Entity entity)
+{
+    if (!alive(entity))
+    {
+        return false;
+    }
+    Slot& slot = m_slots[entity.slot];
+    const uint32_t index = slot.denseIndex;
+    // The last entity moves into the hole, only its slot needs patching.
+    m_slots[m_denseSlots.back()].denseIndex = index;
+    m_transforms.removeSwap(index);
+    removeSwap(m_meshes, index);
+    removeSwap(m_materials, index);
+    removeSwap(m_denseSlots, index);
+
+    slot.denseIndex = kDeadIndex;
+    ++slot.generation;
+    m_freeSlots.push_back(entity.slot);
+    return true;
+}
+
+bool SceneStore::alive(Entity entity) const
+{
+    return entity.slot < m_slots.size() && m_slots[entity.slot].generation == entity.generation &&
+           m_slots[entity.slot].denseIndex != kDeadIndex;
+}
+
+void SceneStore::reserve(uint32_t capacity)
+{
+    m_slots.reserve(capacity);
+    m_transforms.reserve(capacity);
+    m_meshes.reserve(capacity);
+    m_materials.reserve(capacity);
+    m_denseSlots.reserve(capacity);
+    m_visible.reserve(capacity);
+    m_visibleCommands.reserve(capacity);
+}
+
+void SceneStore::clear()
+{
+    // Existing handles have to stay dead, so the slots survive with bumped generations.
+    for (uint32_t dense = 0; dense < size(); ++dense)
+    {
+        Slot& slot = m_slots[m_denseSlots[dense]];
+        slot.denseIndex = kDeadIndex;
+        ++slot.generation;
+        m_freeSlots.push_back(m_denseSlots[dense]);
+    }
+    m_transforms.clear();
+    m_meshes.clear();
+    m_materials.clear();
+    m_denseSlots.clear();
+}
+
+bool SceneStore::setTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, float scale)
+{
+    if (!alive(entity))
+    {
+        return false;
+    }
+    m_transforms.setTransform(denseIndex(entity), position, rotation, scale);
+    return true;
+}
+
+bool SceneStore::setMesh(Entity entity, uint32_t mesh)
+{
+    if (!alive(entity) || mesh >= m_meshRanges.size())
+    {
+        return false;
+    }
+    m_meshes[denseIndex(entity)] = mesh;
+    return true;
+}
+
+bool SceneStore::setMaterial(Entity entity, uint32_t material)
+{
+    if (!alive(entity))
+    {
+        return false;
+    }
+    m_materials[denseIndex(entity)] = material;
+    return true;
+}
+
+void SceneStore::update()
+{
+    m_transforms.update();
+}
+
+void SceneStore::collectDraws(const glm::vec4 planes[6], SceneDraws& draws)
+{
+    draws.instances.clear();
+    draws.commands.clear();
+    draws.commandMaterials.clear();
+    m_visible.clear();
+    m_transforms.cull(planes, m_visible);
+
+    // Counting sort of the visible entities by mesh and material: count the instances of every command, then
+    // scatter the matrices to the ranges the counts leave.
+    std::fill(m_commandTable.begin(), m_commandTable.end(), CommandEntry{kEmptyKey, 0});
+    m_visibleCommands.resize(m_visible.size());
+    const uint32_t visibleCount = static_cast<uint32_t>(m_visible.size());
+    uint64_t previousKey = kEmptyKey;
+    uint32_t previousCommand = 0;
+    for (uint32_t i = 0; i < visibleCount; ++i)
+    {
+        const uint32_t dense = m_visible[i];
+        const uint32_t mesh = m_meshes[dense];
+        const uint32_t material = m_materials[dense];
+        const uint64_t key = (static_cast<uint64_t>(material) << 32) | mesh;
+        // Neighbours often share their pair, they skip the lookup.
+        if (key != previousKey)
+        {
+            previousCommand = findCommand(key, mesh, material, draws);
+            previousKey = key;
+        }
+        m_visibleCommands[i] = previousCommand;
+        ++draws.commands[previousCommand].instanceCount;
+    }
+
+    m_nextInstance.resize(draws.commands.size());
+    uint32_t firstInstance = 0;
+    for (uint32_t command = 0; command < draws.commands.size(); ++command)
+    {
+        draws.commands[command].firstInstance = firstInstance;
+        m_nextInstance[command] = firstInstance;
+        firstInstance += draws.commands[command].instanceCount;
+    }
+    draws.instances.resize(m_visible.size());
+    const glm::mat4* models = m_transforms.modelMatrices();
+    for (uint32_t i = 0; i < visibleCount; ++i)
+    {
+        draws.instances[m_nextInstance[m_visibleCommands[i]]++] = models[m_visible[i]];
+    }
+}
+
+uint32_t SceneStore::findCommand(uint64_t key, uint32_t mesh, uint32_t material, SceneDraws& draws)
+{
+    const size_t mask = m_commandTable.size() - 1;
+    size_t index = commandTableIndex(key, m_commandTableShift);
+    while (m_commandTable[index].key != kEmptyKey)
+    {
+        if (m_commandTable[index].key == key)
+        {
+            return m_commandTable[index].command;
+        }
+        index = (index + 1) & mask;
+    }
+
+    const uint32_t command = static_cast<uint32_t>(draws.commands.size());
+    const MeshRange& range = m_meshRanges[mesh];
+    draws.commands.push_back(DrawIndexedIndirect{range.indexCount, 0, range.firstIndex, range.vertexOffset, 0});
+    draws.commandMaterials.push_back(material);
+    m_commandTable[index] = CommandEntry{key, command};
+    if (2 * draws.commands.size() > m_commandTable.size())
+    {
+        growCommandTable();
+    }
+    return command;
+}
+
+void SceneStore::growCommandTable()
+{
+    std::vector<CommandEntry> entries(m_commandTable.size() * 2, CommandEntry{kEmptyKey, 0});
+    entries.swap(m_commandTable);
+    --m_commandTableShift;
+    const size_t mask = m_commandTable.size() - 1;
+    for (const CommandEntry& entry : entries)
+    {
+        if (entry.key == kEmptyKey)
+        {
+            continue;
+        }
+        size_t index = commandTableIndex(entry.key, m_commandTableShift);
+        while (m_commandTable[index].key != kEmptyKey)
+        {
+            index = (index + 1) & mask;
+        }
+        m_commandTable[index] = entry;
+    }
+}
@@ -0,0 +1,199 @@
+#include "shaderHotReloader.h"
+
+#include "cpuProfiler.h"
+#include "mappedFile.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static const uint32_t kSpirvMagic = 0x07230203;
+// How often the watcher checks for changes and for stop requests.
+static const int kPollIntervalMs = 100;
+// Editors save in bursts (truncate, write, rename), a change is compiled once the file was left alone this long.
+static const int kDebounceIntervalMs = 50;
+
+ShaderHotReloader::ShaderHotReloader() : m_stopping(false), m_inotifyFd(-1)
+{
+}
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+    stop();
+}
+
+bool ShaderHotReloader::start(const std::string& sourceDirectory,
+                              const std::vector<std::string>& names,
+                              const std::string& compilerPath,
+                              ReloadFunction reload)
+{
+    stop();
+    m_sourceDirectory = sourceDirectory;
+    m_names = names;
+    m_compilerPath = compilerPath;
+    m_reload = std::move(reload);
+    m_stopping = false;
+
+#ifdef __linux__
+    // Watch the directory rather than the files, editors that save by renaming replace the watched inode.
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0 || inotify_add_watch(m_inotifyFd, m_sourceDirectory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        lerror("Failed to watch shader directory {}", m_sourceDirectory.c_str());
+        if (m_inotifyFd >= 0)
+        {
+            close(m_inotifyFd);
+            m_inotifyFd = -1;
+        }
+        return false;
+    }
+#endif
+
+    m_thread = std::thread(&ShaderHotReloader::watchLoop, this);
+    linfo("Watching {} shaders in {} for changes.", m_names.size(), m_sourceDirectory.c_str());
+    return true;
+}
+
+void ShaderHotReloader::stop()
+{
+    if (!m_thread.joinable())
+    {
+        return;
+    }
+    m_stopping = true;
+    m_thread.join();
+#ifdef __linux__
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+#endif
+}
+
+#ifdef __linux__
+
+void ShaderHotReloader::watchLoop()
+{
+    PROFILE_THREAD_NAME("shader watcher");
+    alignas(inotify_event) char buffer[4096];
+    std::set<std::string> changed;
+    while (!m_stopping)
+    {
+        pollfd watch = {m_inotifyFd, POLLIN, 0};
+        const int ready = poll(&watch, 1, changed.empty() ? kPollIntervalMs : kDebounceIntervalMs);
+        if (ready > 0)
+        {
+            ssize_t length = 0;
+            while ((length = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+            {
+                for (const char* event = buffer; event < buffer + length;)
+                {
+                    const inotify_event* notification = reinterpret_cast<const inotify_event*>(event);
+                    if (notification->len > 0 &&
+                        std::find(m_names.begin(), m_names.end(), notification->name) != m_names.end())
+                    {
+                        changed.insert(notification->name);
+                    }
+                    event += sizeof(inotify_event) + notification->len;
+                }
+            }
+        }
+        else if (ready == 0 && !changed.empty())
+        {
+            for (const std::string& name : changed)
+            {
+                reload(name);
+            }
+            changed.clear();
+        }
+    }
+}
+
+#else
+
+void ShaderHotReloader::watchLoop()
+{
+    PROFILE_THREAD_NAME("shader watcher");
+    std::vector<time_t> modified(m_names.size(), 0);
+    for (size_t i = 0; i < m_names.size(); ++i)
+    {
+        struct stat status;
+        if (stat((m_sourceDirectory + "/" + m_names[i]).c_str(), &status) == 0)
+        {
+            modified[i] = status.st_mtime;
+        }
+    }
+
+    while (!m_stopping)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(kPollIntervalMs));
+        for (size_t i = 0; i < m_names.size(); ++i)
+        {
+            struct stat status;
+            if (stat((m_sourceDirectory + "/" + m_names[i]).c_str(), &status) == 0 && status.st_mtime != modified[i])
+            {
+                modified[i] = status.st_mtime;
+                std::this_thread::sleep_for(std::chrono::milliseconds(kDebounceIntervalMs));
+                reload(m_names[i]);
+            }
+        }
+    }
+}
+
+#endif
+
+void ShaderHotReloader::reload(const std::string& name) const
+{
+    PROFILE_ZONE("recompile shader");
+    const auto compileStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> spirv;
+    if (!compile(name, spirv))
+    {
+        // Keep rendering with the previous version until the next save fixes the shader.
+        lerror("Failed to recompile shader {}, keeping the previous version.", name.c_str());
+        return;
+    }
+    const std::chrono::duration<double, std::milli> compileTime = std::chrono::steady_clock::now() - compileStart;
+    linfo("Recompiled shader {} in {:.3f} ms", name.c_str(), compileTime.count());
+    m_reload(name, spirv);
+}
+
+bool ShaderHotReloader::compile(const std::string& name, std::vector<uint32_t>& spirv) const
+{
+    const std::string sourcePath = m_sourceDirectory + "/" + name;
+    const std::string outputPath = "./" + name + ".hotreload.spv";
+    std::string command = "\"" + m_compilerPath + "\" -V \"" + sourcePath + "\" -o \"" + outputPath + "\"";
+#ifdef _WIN32
+    // cmd.exe strips the outermost quotes of a command line starting with one.
+    command = "\"" + command + "\"";
+#endif
+    if (std::system(command.c_str()) != 0)
+    {
+        std::remove(outputPath.c_str());
+        return false;
+    }
+
+    bool succeeded = false;
+    {
+        MappedFile file;
+        if (file.open(outputPath, MappedFile::AccessHint::Sequential) && file.size() >= 5 * sizeof(uint32_t) &&
+            file.size() % sizeof(uint32_t) == 0)
+        {
+            spirv.resize(static_cast<size_t>(file.size() / sizeof(uint32_t)));
+            std::memcpy(spirv.data(), file.data(), static_cast<size_t>(file.size()));
+            succeeded = spirv[0] == kSpirvMagic;
+        }
+    }
+    std::remove(outputPath.c_str());
+    return succeeded;
+}
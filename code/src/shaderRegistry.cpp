@@ -0,0 +1,25 @@
+#include "shaderRegistry.h"
+
+#include "shaders/cull.comp.h"
+#include "shaders/triangle1.frag.h"
+#include "shaders/triangle1.vert.h"
+
+#include <cstring>
+
+static const ShaderBinary kShaders[] = {
+    {"cull.comp", kCullCompSpirv, sizeof(kCullCompSpirv), VK_SHADER_STAGE_COMPUTE_BIT},
+    {"triangle1.frag", kTriangle1FragSpirv, sizeof(kTriangle1FragSpirv), VK_SHADER_STAGE_FRAGMENT_BIT},
+    {"triangle1.vert", kTriangle1VertSpirv, sizeof(kTriangle1VertSpirv), VK_SHADER_STAGE_VERTEX_BIT},
+};
+
+const ShaderBinary* findShader(const char* name)
+{
+    for (const ShaderBinary& shader : kShaders)
+    {
+        if (std::strcmp(shader.name, name) == 0)
+        {
+            return &shader;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,566 @@
+#include "spirvReflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+static const uint32_t kSpirvMagic = 0x07230203;
+static const size_t kHeaderWordCount = 5;
+static const uint32_t kUnset = 0xffffffffu;
+
+// Opcodes, decorations, storage classes and image dimensions of the SPIR-V specification.
+static const uint32_t kOpEntryPoint = 15;
+static const uint32_t kOpTypeBool = 20;
+static const uint32_t kOpTypeInt = 21;
+static const uint32_t kOpTypeFloat = 22;
+static const uint32_t kOpTypeVector = 23;
+static const uint32_t kOpTypeMatrix = 24;
+static const uint32_t kOpTypeImage = 25;
+static const uint32_t kOpTypeSampler = 26;
+static const uint32_t kOpTypeSampledImage = 27;
+static const uint32_t kOpTypeArray = 28;
+static const uint32_t kOpTypeRuntimeArray = 29;
+static const uint32_t kOpTypeStruct = 30;
+static const uint32_t kOpTypePointer = 32;
+static const uint32_t kOpConstant = 43;
+static const uint32_t kOpVariable = 59;
+static const uint32_t kOpDecorate = 71;
+static const uint32_t kOpMemberDecorate = 72;
+
+static const uint32_t kDecorationBufferBlock = 3;
+static const uint32_t kDecorationArrayStride = 6;
+static const uint32_t kDecorationMatrixStride = 7;
+static const uint32_t kDecorationBuiltIn = 11;
+static const uint32_t kDecorationLocation = 30;
+static const uint32_t kDecorationBinding = 33;
+static const uint32_t kDecorationDescriptorSet = 34;
+static const uint32_t kDecorationOffset = 35;
+
+static const uint32_t kStorageClassUniformConstant = 0;
+static const uint32_t kStorageClassInput = 1;
+static const uint32_t kStorageClassUniform = 2;
+static const uint32_t kStorageClassPushConstant = 9;
+static const uint32_t kStorageClassStorageBuffer = 12;
+
+static const uint32_t kDimBuffer = 5;
+static const uint32_t kDimSubpassData = 6;
+
+struct SpirvType
+{
+    uint32_t opcode = 0;
+    // Operands following the result id.
+    std::vector<uint32_t> operands;
+};
+
+struct SpirvDecorations
+{
+    uint32_t set = kUnset;
+    uint32_t binding = kUnset;
+    uint32_t location = kUnset;
+    uint32_t arrayStride = 0;
+    bool builtIn = false;
+    bool bufferBlock = false;
+    bool memberBuiltIn = false;
+    std::vector<uint32_t> memberOffsets;
+    std::vector<uint32_t> memberMatrixStrides;
+};
+
+struct SpirvVariable
+{
+    uint32_t id;
+    uint32_t pointerType;
+    uint32_t storageClass;
+};
+
+struct SpirvModule
+{
+    std::unordered_map<uint32_t, SpirvType> types;
+    std::unordered_map<uint32_t, uint32_t> constants;
+    std::unordered_map<uint32_t, SpirvDecorations> decorations;
+    std::vector<SpirvVariable> variables;
+
+    const SpirvType* type(uint32_t id) const
+    {
+        const auto found = types.find(id);
+        return found != types.end() ? &found->second : nullptr;
+    }
+
+    const SpirvDecorations& decoration(uint32_t id) const
+    {
+        static const SpirvDecorations kNoDecorations;
+        const auto found = decorations.find(id);
+        return found != decorations.end() ? found->second : kNoDecorations;
+    }
+};
+
+static void setMemberValue(std::vector<uint32_t>& values, uint32_t member, uint32_t value)
+{
+    if (values.size() <= member)
+    {
+        values.resize(member + 1, 0);
+    }
+    values[member] = value;
+}
+
+// Size of a value of typeId in a push constant block. matrixStride comes from the member holding the matrix.
+static bool typeSize(const SpirvModule& module, uint32_t typeId, uint32_t matrixStride, uint32_t& size)
+{
+    const SpirvType* type = module.type(typeId);
+    if (type == nullptr)
+    {
+        return false;
+    }
+
+    switch (type->opcode)
+    {
+    case kOpTypeInt:
+    case kOpTypeFloat:
+        size = type->operands[0] / 8;
+        return true;
+    case kOpTypeVector:
+    {
+        uint32_t componentSize = 0;
+        if (!typeSize(module, type->operands[0], 0, componentSize))
+        {
+            return false;
+        }
+        size = componentSize * type->operands[1];
+        return true;
+    }
+    case kOpTypeMatrix:
+    {
+        uint32_t columnSize = 0;
+        if (!typeSize(module, type->operands[0], 0, columnSize))
+        {
+            return false;
+        }
+        size = std::max(columnSize, matrixStride) * type->operands[1];
+        return true;
+    }
+    case kOpTypeArray:
+    {
+        const auto length = module.constants.find(type->operands[1]);
+        uint32_t elementSize = module.decoration(typeId).arrayStride;
+        if (length == module.constants.end() ||
+            (elementSize == 0 && !typeSize(module, type->operands[0], matrixStride, elementSize)))
+        {
+            return false;
+        }
+        size = elementSize * length->second;
+        return true;
+    }
+    case kOpTypeStruct:
+    {
+        const SpirvDecorations& decorations = module.decoration(typeId);
+        size = 0;
+        for (uint32_t member = 0; member < type->operands.size(); ++member)
+        {
+            const uint32_t offset = member < decorations.memberOffsets.size() ? decorations.memberOffsets[member] : 0;
+            const uint32_t stride =
+                member < decorations.memberMatrixStrides.size() ? decorations.memberMatrixStrides[member] : 0;
+            uint32_t memberSize = 0;
+            if (!typeSize(module, type->operands[member], stride, memberSize))
+            {
+                return false;
+            }
+            size = std::max(size, offset + memberSize);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool descriptorKind(const SpirvModule& module,
+                           uint32_t storageClass,
+                           uint32_t typeId,
+                           DescriptorKind& kind,
+                           uint32_t& count)
+{
+    // Arrays of resources become one binding with a descriptor count.
+    count = 1;
+    const SpirvType* type = module.type(typeId);
+    while (type != nullptr && (type->opcode == kOpTypeArray || type->opcode == kOpTypeRuntimeArray))
+    {
+        if (type->opcode == kOpTypeRuntimeArray)
+        {
+            count = 0;
+        }
+        else
+        {
+            const auto length = module.constants.find(type->operands[1]);
+            if (length == module.constants.end())
+            {
+                return false;
+            }
+            count *= length->second;
+        }
+        typeId = type->operands[0];
+        type = module.type(typeId);
+    }
+    if (type == nullptr)
+    {
+        return false;
+    }
+
+    if (storageClass == kStorageClassStorageBuffer)
+    {
+        kind = DescriptorKind::StorageBuffer;
+        return true;
+    }
+    if (storageClass == kStorageClassUniform)
+    {
+        // Before SPIR-V 1.3 storage buffers are Uniform blocks decorated BufferBlock.
+        kind = module.decoration(typeId).bufferBlock ? DescriptorKind::StorageBuffer : DescriptorKind::UniformBuffer;
+        return true;
+    }
+
+    switch (type->opcode)
+    {
+    case kOpTypeSampler:
+        kind = DescriptorKind::Sampler;
+        return true;
+    case kOpTypeSampledImage:
+        kind = DescriptorKind::CombinedImageSampler;
+        return true;
+    case kOpTypeImage:
+    {
+        // Operands: sampled type, dim, depth, arrayed, multisampled, sampled (1: with a sampler, 2: storage).
+        const uint32_t dim = type->operands[1];
+        const bool storage = type->operands[5] == 2;
+        if (dim == kDimSubpassData)
+        {
+            kind = DescriptorKind::InputAttachment;
+        }
+        else if (dim == kDimBuffer)
+        {
+            kind = storage ? DescriptorKind::StorageTexelBuffer : DescriptorKind::UniformTexelBuffer;
+        }
+        else
+        {
+            kind = storage ? DescriptorKind::StorageImage : DescriptorKind::SampledImage;
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool vertexInput(const SpirvModule& module, uint32_t typeId, ReflectedVertexInput& input)
+{
+    const SpirvType* type = module.type(typeId);
+    if (type == nullptr)
+    {
+        return false;
+    }
+    input.componentCount = 1;
+    if (type->opcode == kOpTypeVector)
+    {
+        input.componentCount = type->operands[1];
+        type = module.type(type->operands[0]);
+        if (type == nullptr)
+        {
+            return false;
+        }
+    }
+
+    if (type->opcode == kOpTypeFloat)
+    {
+        input.componentKind = ComponentKind::Float;
+    }
+    else if (type->opcode == kOpTypeInt)
+    {
+        input.componentKind = type->operands[1] != 0 ? ComponentKind::SignedInt : ComponentKind::UnsignedInt;
+    }
+    else
+    {
+        return false;
+    }
+    input.componentWidth = type->operands[0];
+    return true;
+}
+
+static bool parseModule(const uint32_t* code,
+                        size_t wordCount,
+                        const char* entryPoint,
+                        SpirvModule& module,
+                        ShaderReflection& reflection,
+                        std::vector<uint32_t>& interfaceIds)
+{
+    bool entryPointFound = false;
+    for (size_t position = kHeaderWordCount; position < wordCount;)
+    {
+        const uint32_t opcode = code[position] & 0xffffu;
+        const uint32_t instructionWordCount = code[position] >> 16;
+        if (instructionWordCount == 0 || position + instructionWordCount > wordCount)
+        {
+            return false;
+        }
+        const uint32_t* operands = code + position + 1;
+        const uint32_t operandCount = instructionWordCount - 1;
+        position += instructionWordCount;
+
+        switch (opcode)
+        {
+        case kOpEntryPoint:
+        {
+            if (operandCount < 3 || entryPointFound)
+            {
+                break;
+            }
+            // The name is a nul terminated string packed into words, the interface ids follow it.
+            const char* name = reinterpret_cast<const char*>(operands + 2);
+            const size_t nameLength = strnlen(name, (operandCount - 2) * sizeof(uint32_t));
+            const size_t nameWordCount = nameLength / sizeof(uint32_t) + 1;
+            if (2 + nameWordCount > operandCount)
+            {
+                return false;
+            }
+            if (entryPoint != nullptr && std::string(name, nameLength) != entryPoint)
+            {
+                break;
+            }
+            entryPointFound = true;
+            reflection.executionModel = static_cast<ShaderExecutionModel>(operands[0]);
+            reflection.entryPoint.assign(name, nameLength);
+            interfaceIds.assign(operands + 2 + nameWordCount, operands + operandCount);
+            break;
+        }
+        case kOpDecorate:
+        {
+            if (operandCount < 2)
+            {
+                return false;
+            }
+            SpirvDecorations& decorations = module.decorations[operands[0]];
+            const uint32_t value = operandCount > 2 ? operands[2] : 0;
+            switch (operands[1])
+            {
+            case kDecorationBufferBlock:
+                decorations.bufferBlock = true;
+                break;
+            case kDecorationArrayStride:
+                decorations.arrayStride = value;
+                break;
+            case kDecorationBuiltIn:
+                decorations.builtIn = true;
+                break;
+            case kDecorationLocation:
+                decorations.location = value;
+                break;
+            case kDecorationBinding:
+                decorations.binding = value;
+                break;
+            case kDecorationDescriptorSet:
+                decorations.set = value;
+                break;
+            default:
+                break;
+            }
+            break;
+        }
+        case kOpMemberDecorate:
+        {
+            if (operandCount < 3)
+            {
+                return false;
+            }
+            SpirvDecorations& decorations = module.decorations[operands[0]];
+            const uint32_t value = operandCount > 3 ? operands[3] : 0;
+            if (operands[2] == kDecorationOffset)
+            {
+                setMemberValue(decorations.memberOffsets, operands[1], value);
+            }
+            else if (operands[2] == kDecorationMatrixStride)
+            {
+                setMemberValue(decorations.memberMatrixStrides, operands[1], value);
+            }
+            else if (operands[2] == kDecorationBuiltIn)
+            {
+                decorations.memberBuiltIn = true;
+            }
+            break;
+        }
+        case kOpTypeBool:
+        case kOpTypeInt:
+        case kOpTypeFloat:
+        case kOpTypeVector:
+        case kOpTypeMatrix:
+        case kOpTypeImage:
+        case kOpTypeSampler:
+        case kOpTypeSampledImage:
+        case kOpTypeArray:
+        case kOpTypeRuntimeArray:
+        case kOpTypeStruct:
+        case kOpTypePointer:
+        {
+            if (operandCount < 1)
+            {
+                return false;
+            }
+            SpirvType& type = module.types[operands[0]];
+            type.opcode = opcode;
+            type.operands.assign(operands + 1, operands + operandCount);
+            break;
+        }
+        case kOpConstant:
+            // Only 32 bit integer constants matter here, as array lengths.
+            if (operandCount >= 3)
+            {
+                module.constants[operands[1]] = operands[2];
+            }
+            break;
+        case kOpVariable:
+            if (operandCount < 3)
+            {
+                return false;
+            }
+            module.variables.push_back({operands[1], operands[0], operands[2]});
+            break;
+        default:
+            break;
+        }
+    }
+    return entryPointFound;
+}
+
+// Minimum checks the per-opcode operand counts rely on.
+static bool typesWellFormed(const SpirvModule& module)
+{
+    for (const auto& entry : module.types)
+    {
+        const SpirvType& type = entry.second;
+        size_t minimumOperandCount = 0;
+        switch (type.opcode)
+        {
+        case kOpTypeInt:
+        case kOpTypeVector:
+        case kOpTypeMatrix:
+        case kOpTypeArray:
+        case kOpTypePointer:
+            minimumOperandCount = 2;
+            break;
+        case kOpTypeFloat:
+        case kOpTypeSampledImage:
+        case kOpTypeRuntimeArray:
+            minimumOperandCount = 1;
+            break;
+        case kOpTypeImage:
+            minimumOperandCount = 7;
+            break;
+        default:
+            break;
+        }
+        if (type.operands.size() < minimumOperandCount)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool reflectSpirv(const uint32_t* code, size_t wordCount, ShaderReflection& reflection, const char* entryPoint)
+{
+    reflection = ShaderReflection();
+    if (code == nullptr || wordCount < kHeaderWordCount || code[0] != kSpirvMagic)
+    {
+        return false;
+    }
+
+    SpirvModule module;
+    std::vector<uint32_t> interfaceIds;
+    if (!parseModule(code, wordCount, entryPoint, module, reflection, interfaceIds) || !typesWellFormed(module))
+    {
+        return false;
+    }
+
+    uint32_t pushConstantEnd = 0;
+    reflection.pushConstantOffset = kUnset;
+    for (const SpirvVariable& variable : module.variables)
+    {
+        const SpirvType* pointer = module.type(variable.pointerType);
+        if (pointer == nullptr || pointer->opcode != kOpTypePointer)
+        {
+            return false;
+        }
+        const uint32_t typeId = pointer->operands[1];
+        const SpirvDecorations& decorations = module.decoration(variable.id);
+
+        switch (variable.storageClass)
+        {
+        case kStorageClassUniformConstant:
+        case kStorageClassUniform:
+        case kStorageClassStorageBuffer:
+        {
+            if (decorations.set == kUnset || decorations.binding == kUnset)
+            {
+                break;
+            }
+            ReflectedDescriptorBinding binding;
+            binding.set = decorations.set;
+            binding.binding = decorations.binding;
+            if (!descriptorKind(module, variable.storageClass, typeId, binding.kind, binding.count))
+            {
+                return false;
+            }
+            reflection.descriptorBindings.push_back(binding);
+            break;
+        }
+        case kStorageClassPushConstant:
+        {
+            const SpirvType* block = module.type(typeId);
+            uint32_t size = 0;
+            if (block == nullptr || block->opcode != kOpTypeStruct || !typeSize(module, typeId, 0, size))
+            {
+                return false;
+            }
+            const std::vector<uint32_t>& offsets = module.decoration(typeId).memberOffsets;
+            const uint32_t offset = offsets.empty() ? 0 : *std::min_element(offsets.begin(), offsets.end());
+            reflection.pushConstantOffset = std::min(reflection.pushConstantOffset, offset);
+            pushConstantEnd = std::max(pushConstantEnd, size);
+            break;
+        }
+        case kStorageClassInput:
+        {
+            if (reflection.executionModel != ShaderExecutionModel::Vertex || decorations.builtIn ||
+                module.decoration(typeId).memberBuiltIn ||
+                std::find(interfaceIds.begin(), interfaceIds.end(), variable.id) == interfaceIds.end())
+            {
+                break;
+            }
+            ReflectedVertexInput input;
+            input.location = decorations.location;
+            if (input.location == kUnset || !vertexInput(module, typeId, input))
+            {
+                return false;
+            }
+            reflection.vertexInputs.push_back(input);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (pushConstantEnd > 0)
+    {
+        reflection.pushConstantSize = pushConstantEnd - reflection.pushConstantOffset;
+    }
+    else
+    {
+        reflection.pushConstantOffset = 0;
+    }
+    std::sort(reflection.descriptorBindings.begin(),
+              reflection.descriptorBindings.end(),
+              [](const ReflectedDescriptorBinding& lhs, const ReflectedDescriptorBinding& rhs) {
+                  return lhs.set != rhs.set ? lhs.set < rhs.set : lhs.binding < rhs.binding;
+              });
+    std::sort(reflection.vertexInputs.begin(),
+              reflection.vertexInputs.end(),
+              [](const ReflectedVertexInput& lhs, const ReflectedVertexInput& rhs) {
+                  return lhs.location < rhs.location;
+              });
+    return true;
+}
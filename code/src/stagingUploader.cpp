@@ -0,0 +1,208 @@
+#include "stagingUploader.h"
+
+#include "cpuProfiler.h"
+#include "gpuAllocator.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstring>
+#include <limits>
+
+StagingUploader::StagingUploader()
+    : m_allocator(nullptr),
+      m_device(VK_NULL_HANDLE),
+      m_queue(VK_NULL_HANDLE),
+      m_commandPool(VK_NULL_HANDLE),
+      m_fence(VK_NULL_HANDLE),
+      m_useTimeline(false),
+      m_flushCount(0)
+{
+}
+
+bool StagingUploader::init(GpuMemoryAllocator& allocator,
+                           VkDevice device,
+                           VkQueue queue,
+                           uint32_t queueFamilyIndex,
+                           bool timelineSemaphore)
+{
+    m_allocator = &allocator;
+    m_device = device;
+    m_queue = queue;
+    m_useTimeline = timelineSemaphore;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS)
+    {
+        lerror("Failed to create upload command pool!");
+        return false;
+    }
+
+    if (m_useTimeline)
+    {
+        return m_timeline.init(m_device, m_flushCount);
+    }
+
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(m_device, &fenceInfo, nullptr, &m_fence) != VK_SUCCESS)
+    {
+        lerror("Failed to create upload fence!");
+        return false;
+    }
+
+    return true;
+}
+
+void StagingUploader::destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        // Never initialized.
+        return;
+    }
+    vkDestroyFence(m_device, m_fence, nullptr);
+    m_timeline.destroy();
+    vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    m_fence = VK_NULL_HANDLE;
+    m_commandPool = VK_NULL_HANDLE;
+    m_pendingCopies.clear();
+}
+
+void StagingUploader::enqueue(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+    if (size > 0)
+    {
+        m_pendingCopies.push_back({data, size, dstBuffer, dstOffset});
+    }
+}
+
+bool StagingUploader::flush()
+{
+    PROFILE_FUNCTION();
+    if (m_pendingCopies.empty())
+    {
+        return true;
+    }
+
+    // Keep each copy source 16 byte aligned, vkCmdCopyBuffer has no alignment requirements but memcpy likes it.
+    const VkDeviceSize copyAlignment = 16;
+    VkDeviceSize stagingSize = 0;
+    for (const PendingCopy& copy : m_pendingCopies)
+    {
+        stagingSize = (stagingSize + copyAlignment - 1) & ~(copyAlignment - 1);
+        stagingSize += copy.size;
+    }
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    GpuAllocation stagingAllocation;
+    if (!m_allocator->createBuffer(stagingSize,
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   stagingBuffer,
+                                   stagingAllocation))
+    {
+        lerror("Failed to create staging buffer of {} bytes!", stagingSize);
+        m_pendingCopies.clear();
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+    {
+        lerror("Failed to allocate upload command buffer!");
+        m_allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+        m_pendingCopies.clear();
+        return false;
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    // Host visible allocations stay mapped, the copies go straight into the staging memory.
+    char* mapped = static_cast<char*>(stagingAllocation.mapped);
+    VkDeviceSize stagingOffset = 0;
+    for (const PendingCopy& copy : m_pendingCopies)
+    {
+        stagingOffset = (stagingOffset + copyAlignment - 1) & ~(copyAlignment - 1);
+        std::memcpy(mapped + stagingOffset, copy.data, static_cast<size_t>(copy.size));
+
+        VkBufferCopy region = {};
+        region.srcOffset = stagingOffset;
+        region.dstOffset = copy.dstOffset;
+        region.size = copy.size;
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, copy.dstBuffer, 1, &region);
+
+        stagingOffset += copy.size;
+    }
+
+    // Make the copies visible to vertex input and any later shader reads, the GPU culler reads its bounds in a
+    // compute shader.
+    VkMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0,
+                         1,
+                         &barrier,
+                         0,
+                         nullptr,
+                         0,
+                         nullptr);
+    vkEndCommandBuffer(commandBuffer);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    const uint64_t flushValue = m_flushCount + 1;
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &flushValue;
+    const VkSemaphore timelineSemaphore = m_timeline.semaphore();
+    if (m_useTimeline)
+    {
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &timelineSemaphore;
+    }
+    bool success = vkQueueSubmit(m_queue, 1, &submitInfo, m_useTimeline ? VK_NULL_HANDLE : m_fence) == VK_SUCCESS;
+    if (success)
+    {
+        m_flushCount = flushValue;
+        if (m_useTimeline)
+        {
+            m_timeline.wait(flushValue);
+        }
+        else
+        {
+            vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+            vkResetFences(m_device, 1, &m_fence);
+        }
+        ldebug("Uploaded {} bytes in {} copies.", stagingOffset, m_pendingCopies.size());
+    }
+    else
+    {
+        lerror("Failed to submit upload commands!");
+    }
+
+    vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
+    m_allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+    m_pendingCopies.clear();
+
+    return success;
+}
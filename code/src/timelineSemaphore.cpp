@@ -0,0 +1,93 @@
+#include "timelineSemaphore.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstring>
+#include <vector>
+
+TimelineSemaphore::TimelineSemaphore()
+    : m_device(VK_NULL_HANDLE),
+      m_semaphore(VK_NULL_HANDLE),
+      m_getSemaphoreCounterValue(nullptr),
+      m_waitSemaphores(nullptr)
+{
+}
+
+bool TimelineSemaphore::init(VkDevice device, uint64_t initialValue)
+{
+    m_device = device;
+    // The entry points are not part of Vulkan 1.1, they come with the extension.
+    m_getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(
+        vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+    m_waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+    if (m_getSemaphoreCounterValue == nullptr || m_waitSemaphores == nullptr)
+    {
+        lerror("VK_KHR_timeline_semaphore is not enabled on the device!");
+        return false;
+    }
+
+    VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue = initialValue;
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS)
+    {
+        lerror("Failed to create timeline semaphore!");
+        return false;
+    }
+    return true;
+}
+
+void TimelineSemaphore::destroy()
+{
+    if (m_semaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(m_device, m_semaphore, nullptr);
+        m_semaphore = VK_NULL_HANDLE;
+    }
+}
+
+uint64_t TimelineSemaphore::completedValue() const
+{
+    uint64_t value = 0;
+    m_getSemaphoreCounterValue(m_device, m_semaphore, &value);
+    return value;
+}
+
+bool TimelineSemaphore::wait(uint64_t value, uint64_t timeout) const
+{
+    VkSemaphoreWaitInfoKHR waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+    return m_waitSemaphores(m_device, &waitInfo, timeout) == VK_SUCCESS;
+}
+
+bool timelineSemaphoreSupported(VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+    bool extensionFound = false;
+    for (const VkExtensionProperties& extension : extensions)
+    {
+        extensionFound |= std::strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+    }
+    if (!extensionFound)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
+}
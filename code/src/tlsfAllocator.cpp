@@ -0,0 +1,302 @@
+#include "tlsfAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const uint32_t TlsfAllocator::kInvalidHandle;
+const uint64_t TlsfAllocator::kMinAlignment;
+
+static uint32_t mostSignificantBit(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    return 63u - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+static uint32_t leastSignificantBit(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return static_cast<uint32_t>(index);
+#else
+    return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t size)
+    : m_size(size & ~(kMinAlignment - 1)), m_usedSize(0), m_allocationCount(0), m_firstLevelBitmap(0)
+{
+    std::fill(std::begin(m_secondLevelBitmaps), std::end(m_secondLevelBitmaps), 0u);
+    for (auto& heads : m_freeHeads)
+    {
+        std::fill(std::begin(heads), std::end(heads), kInvalidHandle);
+    }
+
+    // The range at offset 0 always keeps handle 0, it is the head of the physical range list.
+    if (m_size > 0)
+    {
+        insertFreeRange(createRange(0, m_size));
+    }
+}
+
+bool TlsfAllocator::allocate(uint64_t size, uint64_t alignment, Allocation& allocation)
+{
+    assert(alignment == 0 || (alignment & (alignment - 1)) == 0);
+
+    size = alignUp(std::max(size, kMinAlignment), kMinAlignment);
+    alignment = std::max(alignment, kMinAlignment);
+
+    // Offsets are multiples of kMinAlignment, so aligning one costs at most alignment - kMinAlignment bytes.
+    const uint64_t searchSize = size + alignment - kMinAlignment;
+    if (searchSize > m_size - m_usedSize)
+    {
+        return false;
+    }
+    uint32_t handle = findFreeRange(searchSize);
+    if (handle == kInvalidHandle)
+    {
+        return false;
+    }
+    removeFreeRange(handle);
+
+    const uint64_t padding = alignUp(m_ranges[handle].offset, alignment) - m_ranges[handle].offset;
+    if (padding > 0)
+    {
+        // The physical neighbours of a free range are never free, the gap becomes a free range of its own.
+        const uint32_t gap = createRange(m_ranges[handle].offset, padding);
+        const uint32_t prev = m_ranges[handle].prevPhysical;
+        m_ranges[gap].prevPhysical = prev;
+        m_ranges[gap].nextPhysical = handle;
+        if (prev != kInvalidHandle)
+        {
+            m_ranges[prev].nextPhysical = gap;
+        }
+        m_ranges[handle].prevPhysical = gap;
+        m_ranges[handle].offset += padding;
+        m_ranges[handle].size -= padding;
+        insertFreeRange(gap);
+    }
+
+    if (m_ranges[handle].size > size)
+    {
+        splitTail(handle, size);
+    }
+
+    Range& range = m_ranges[handle];
+    range.isFree = false;
+    m_usedSize += range.size;
+    ++m_allocationCount;
+
+    allocation.offset = range.offset;
+    allocation.size = range.size;
+    allocation.handle = handle;
+    return true;
+}
+
+void TlsfAllocator::free(uint32_t handle)
+{
+    // Released handles have a zero size, freeing them again must not corrupt the range lists.
+    if (handle == kInvalidHandle || handle >= m_ranges.size() || m_ranges[handle].isFree ||
+        m_ranges[handle].size == 0)
+    {
+        return;
+    }
+
+    m_usedSize -= m_ranges[handle].size;
+    --m_allocationCount;
+    m_ranges[handle].isFree = true;
+
+    const uint32_t next = m_ranges[handle].nextPhysical;
+    if (next != kInvalidHandle && m_ranges[next].isFree)
+    {
+        removeFreeRange(next);
+        mergeWithNext(handle);
+    }
+    const uint32_t prev = m_ranges[handle].prevPhysical;
+    if (prev != kInvalidHandle && m_ranges[prev].isFree)
+    {
+        removeFreeRange(prev);
+        mergeWithNext(prev);
+        handle = prev;
+    }
+    insertFreeRange(handle);
+}
+
+TlsfStats TlsfAllocator::stats() const
+{
+    TlsfStats stats;
+    stats.totalSize = m_size;
+    stats.usedSize = m_usedSize;
+    stats.allocationCount = m_allocationCount;
+    for (uint32_t handle = m_ranges.empty() ? kInvalidHandle : 0; handle != kInvalidHandle;
+         handle = m_ranges[handle].nextPhysical)
+    {
+        if (m_ranges[handle].isFree)
+        {
+            ++stats.freeRangeCount;
+            stats.largestFreeRange = std::max(stats.largestFreeRange, m_ranges[handle].size);
+        }
+    }
+    return stats;
+}
+
+void TlsfAllocator::mapping(uint64_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+    if (size < kSmallRangeSize)
+    {
+        firstLevel = 0;
+        secondLevel = static_cast<uint32_t>(size >> kMinAlignmentLog2);
+        return;
+    }
+
+    const uint32_t msb = mostSignificantBit(size);
+    firstLevel = msb - kFirstLevelShift + 1;
+    secondLevel = static_cast<uint32_t>(size >> (msb - kSecondLevelCountLog2)) ^ kSecondLevelCount;
+}
+
+uint32_t TlsfAllocator::findFreeRange(uint64_t size) const
+{
+    // Round up to the next size class, so any range in the class found is large enough.
+    if (size >= kSmallRangeSize)
+    {
+        size += (1ull << (mostSignificantBit(size) - kSecondLevelCountLog2)) - 1;
+    }
+
+    uint32_t firstLevel = 0;
+    uint32_t secondLevel = 0;
+    mapping(size, firstLevel, secondLevel);
+    if (firstLevel >= kFirstLevelCount)
+    {
+        return kInvalidHandle;
+    }
+
+    uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0)
+    {
+        const uint64_t firstLevelMap =
+            firstLevel + 1 < 64 ? m_firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0ull;
+        if (firstLevelMap == 0)
+        {
+            return kInvalidHandle;
+        }
+        firstLevel = leastSignificantBit(firstLevelMap);
+        secondLevelMap = m_secondLevelBitmaps[firstLevel];
+    }
+    secondLevel = leastSignificantBit(secondLevelMap);
+
+    return m_freeHeads[firstLevel][secondLevel];
+}
+
+void TlsfAllocator::insertFreeRange(uint32_t handle)
+{
+    uint32_t firstLevel = 0;
+    uint32_t secondLevel = 0;
+    mapping(m_ranges[handle].size, firstLevel, secondLevel);
+
+    const uint32_t head = m_freeHeads[firstLevel][secondLevel];
+    m_ranges[handle].isFree = true;
+    m_ranges[handle].prevFree = kInvalidHandle;
+    m_ranges[handle].nextFree = head;
+    if (head != kInvalidHandle)
+    {
+        m_ranges[head].prevFree = handle;
+    }
+    m_freeHeads[firstLevel][secondLevel] = handle;
+    m_firstLevelBitmap |= 1ull << firstLevel;
+    m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+}
+
+void TlsfAllocator::removeFreeRange(uint32_t handle)
+{
+    uint32_t firstLevel = 0;
+    uint32_t secondLevel = 0;
+    mapping(m_ranges[handle].size, firstLevel, secondLevel);
+
+    const uint32_t prev = m_ranges[handle].prevFree;
+    const uint32_t next = m_ranges[handle].nextFree;
+    if (prev != kInvalidHandle)
+    {
+        m_ranges[prev].nextFree = next;
+    }
+    if (next != kInvalidHandle)
+    {
+        m_ranges[next].prevFree = prev;
+    }
+    if (m_freeHeads[firstLevel][secondLevel] == handle)
+    {
+        m_freeHeads[firstLevel][secondLevel] = next;
+        if (next == kInvalidHandle)
+        {
+            m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (m_secondLevelBitmaps[firstLevel] == 0)
+            {
+                m_firstLevelBitmap &= ~(1ull << firstLevel);
+            }
+        }
+    }
+    m_ranges[handle].prevFree = kInvalidHandle;
+    m_ranges[handle].nextFree = kInvalidHandle;
+}
+
+uint32_t TlsfAllocator::createRange(uint64_t offset, uint64_t size)
+{
+    Range range = {offset, size, kInvalidHandle, kInvalidHandle, kInvalidHandle, kInvalidHandle, false};
+    if (!m_unusedHandles.empty())
+    {
+        const uint32_t handle = m_unusedHandles.back();
+        m_unusedHandles.pop_back();
+        m_ranges[handle] = range;
+        return handle;
+    }
+    m_ranges.push_back(range);
+    return static_cast<uint32_t>(m_ranges.size() - 1);
+}
+
+void TlsfAllocator::releaseRange(uint32_t handle)
+{
+    m_ranges[handle].isFree = false;
+    m_ranges[handle].size = 0;
+    m_unusedHandles.push_back(handle);
+}
+
+void TlsfAllocator::splitTail(uint32_t handle, uint64_t size)
+{
+    const uint32_t tail = createRange(m_ranges[handle].offset + size, m_ranges[handle].size - size);
+    const uint32_t next = m_ranges[handle].nextPhysical;
+    m_ranges[tail].prevPhysical = handle;
+    m_ranges[tail].nextPhysical = next;
+    if (next != kInvalidHandle)
+    {
+        m_ranges[next].prevPhysical = tail;
+    }
+    m_ranges[handle].nextPhysical = tail;
+    m_ranges[handle].size = size;
+    insertFreeRange(tail);
+}
+
+void TlsfAllocator::mergeWithNext(uint32_t handle)
+{
+    const uint32_t next = m_ranges[handle].nextPhysical;
+    const uint32_t nextNext = m_ranges[next].nextPhysical;
+    m_ranges[handle].size += m_ranges[next].size;
+    m_ranges[handle].nextPhysical = nextNext;
+    if (nextNext != kInvalidHandle)
+    {
+        m_ranges[nextNext].prevPhysical = handle;
+    }
+    releaseRange(next);
+}
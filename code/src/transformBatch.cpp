@@ -0,0 +1,560 @@
+#include "transformBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRANSFORMBATCH_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit AVX2 instructions in functions marked for it, MSVC emits them anywhere. Nothing outside
+// the marked functions may use them, the process has to run on CPUs without AVX2 as well.
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// The component arrays of a batch as seen by the kernels.
+struct UpdateArrays
+{
+    const float* positionX;
+    const float* positionY;
+    const float* positionZ;
+    const float* rotationX;
+    const float* rotationY;
+    const float* rotationZ;
+    const float* rotationW;
+    const float* scale;
+    const float* localX;
+    const float* localY;
+    const float* localZ;
+    const float* localRadius;
+    float* worldX;
+    float* worldY;
+    float* worldZ;
+    float* worldRadius;
+    // 16 floats per object, column major.
+    float* models;
+};
+
+struct CullArrays
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    const float* radius;
+};
+
+// The vector kernels repeat these operations in the same order, the levels only differ where a compiler contracts
+// them into FMA.
+static void updateScalar(const UpdateArrays& arrays, uint32_t first, uint32_t last)
+{
+    for (uint32_t i = first; i < last; ++i)
+    {
+        const float x = arrays.rotationX[i];
+        const float y = arrays.rotationY[i];
+        const float z = arrays.rotationZ[i];
+        const float w = arrays.rotationW[i];
+        const float s = arrays.scale[i];
+        const float s2 = s + s;
+
+        float* model = arrays.models + 16 * static_cast<size_t>(i);
+        model[0] = s - s2 * (y * y + z * z);
+        model[1] = s2 * (x * y + w * z);
+        model[2] = s2 * (x * z - w * y);
+        model[3] = 0.0f;
+        model[4] = s2 * (x * y - w * z);
+        model[5] = s - s2 * (x * x + z * z);
+        model[6] = s2 * (y * z + w * x);
+        model[7] = 0.0f;
+        model[8] = s2 * (x * z + w * y);
+        model[9] = s2 * (y * z - w * x);
+        model[10] = s - s2 * (x * x + y * y);
+        model[11] = 0.0f;
+        model[12] = arrays.positionX[i];
+        model[13] = arrays.positionY[i];
+        model[14] = arrays.positionZ[i];
+        model[15] = 1.0f;
+
+        const float lx = arrays.localX[i];
+        const float ly = arrays.localY[i];
+        const float lz = arrays.localZ[i];
+        arrays.worldX[i] = model[0] * lx + model[4] * ly + model[8] * lz + model[12];
+        arrays.worldY[i] = model[1] * lx + model[5] * ly + model[9] * lz + model[13];
+        arrays.worldZ[i] = model[2] * lx + model[6] * ly + model[10] * lz + model[14];
+        arrays.worldRadius[i] = std::fabs(s) * arrays.localRadius[i];
+    }
+}
+
+static uint32_t cullScalar(const CullArrays& spheres,
+                           const glm::vec4 planes[6],
+                           uint32_t first,
+                           uint32_t last,
+                           std::vector<uint32_t>& visible)
+{
+    uint32_t count = 0;
+    for (uint32_t i = first; i < last; ++i)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p)
+        {
+            const float distance =
+                planes[p].x * spheres.x[i] + planes[p].y * spheres.y[i] + planes[p].z * spheres.z[i] + planes[p].w;
+            inside = !(distance < -spheres.radius[i]);
+        }
+        if (inside)
+        {
+            visible.push_back(i);
+            ++count;
+        }
+    }
+    return count;
+}
+
+#ifdef TRANSFORMBATCH_X86_64
+static uint32_t appendSetBits(uint32_t mask, uint32_t base, std::vector<uint32_t>& visible)
+{
+    uint32_t count = 0;
+    while (mask != 0)
+    {
+#ifdef _MSC_VER
+        unsigned long bit = 0;
+        _BitScanForward(&bit, mask);
+#else
+        const uint32_t bit = static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+        visible.push_back(base + static_cast<uint32_t>(bit));
+        mask &= mask - 1;
+        ++count;
+    }
+    return count;
+}
+
+static uint32_t updateSse2(const UpdateArrays& arrays, uint32_t count)
+{
+    const uint32_t blockEnd = count & ~3u;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    for (uint32_t i = 0; i < blockEnd; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(arrays.rotationX + i);
+        const __m128 y = _mm_loadu_ps(arrays.rotationY + i);
+        const __m128 z = _mm_loadu_ps(arrays.rotationZ + i);
+        const __m128 w = _mm_loadu_ps(arrays.rotationW + i);
+        const __m128 s = _mm_loadu_ps(arrays.scale + i);
+        const __m128 s2 = _mm_add_ps(s, s);
+        const __m128 xx = _mm_mul_ps(x, x);
+        const __m128 yy = _mm_mul_ps(y, y);
+        const __m128 zz = _mm_mul_ps(z, z);
+        const __m128 xy = _mm_mul_ps(x, y);
+        const __m128 xz = _mm_mul_ps(x, z);
+        const __m128 yz = _mm_mul_ps(y, z);
+        const __m128 wx = _mm_mul_ps(w, x);
+        const __m128 wy = _mm_mul_ps(w, y);
+        const __m128 wz = _mm_mul_ps(w, z);
+
+        // columns[c][r] holds element r of column c for the 4 objects.
+        __m128 columns[4][4];
+        columns[0][0] = _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(yy, zz)));
+        columns[0][1] = _mm_mul_ps(s2, _mm_add_ps(xy, wz));
+        columns[0][2] = _mm_mul_ps(s2, _mm_sub_ps(xz, wy));
+        columns[1][0] = _mm_mul_ps(s2, _mm_sub_ps(xy, wz));
+        columns[1][1] = _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(xx, zz)));
+        columns[1][2] = _mm_mul_ps(s2, _mm_add_ps(yz, wx));
+        columns[2][0] = _mm_mul_ps(s2, _mm_add_ps(xz, wy));
+        columns[2][1] = _mm_mul_ps(s2, _mm_sub_ps(yz, wx));
+        columns[2][2] = _mm_sub_ps(s, _mm_mul_ps(s2, _mm_add_ps(xx, yy)));
+        columns[3][0] = _mm_loadu_ps(arrays.positionX + i);
+        columns[3][1] = _mm_loadu_ps(arrays.positionY + i);
+        columns[3][2] = _mm_loadu_ps(arrays.positionZ + i);
+        columns[0][3] = zero;
+        columns[1][3] = zero;
+        columns[2][3] = zero;
+        columns[3][3] = one;
+
+        const __m128 lx = _mm_loadu_ps(arrays.localX + i);
+        const __m128 ly = _mm_loadu_ps(arrays.localY + i);
+        const __m128 lz = _mm_loadu_ps(arrays.localZ + i);
+        for (int r = 0; r < 3; ++r)
+        {
+            float* world = r == 0 ? arrays.worldX : (r == 1 ? arrays.worldY : arrays.worldZ);
+            const __m128 center = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(columns[0][r], lx),
+                                                                   _mm_mul_ps(columns[1][r], ly)),
+                                                        _mm_mul_ps(columns[2][r], lz)),
+                                             columns[3][r]);
+            _mm_storeu_ps(world + i, center);
+        }
+        const __m128 radius = _mm_mul_ps(_mm_andnot_ps(signMask, s), _mm_loadu_ps(arrays.localRadius + i));
+        _mm_storeu_ps(arrays.worldRadius + i, radius);
+
+        // Turns the column elements of 4 objects into one column of each object.
+        float* models = arrays.models + 16 * static_cast<size_t>(i);
+        for (int c = 0; c < 4; ++c)
+        {
+            _MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+            for (int object = 0; object < 4; ++object)
+            {
+                _mm_storeu_ps(models + 16 * object + 4 * c, columns[c][object]);
+            }
+        }
+    }
+    return blockEnd;
+}
+
+static uint32_t cullSse2(const CullArrays& spheres,
+                         const glm::vec4 planes[6],
+                         uint32_t count,
+                         std::vector<uint32_t>& visible)
+{
+    const uint32_t blockEnd = count & ~3u;
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < blockEnd; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(spheres.x + i);
+        const __m128 y = _mm_loadu_ps(spheres.y + i);
+        const __m128 z = _mm_loadu_ps(spheres.z + i);
+        const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i));
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const __m128 distance =
+                _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[p].x), x),
+                                                 _mm_mul_ps(_mm_set1_ps(planes[p].y), y)),
+                                      _mm_mul_ps(_mm_set1_ps(planes[p].z), z)),
+                           _mm_set1_ps(planes[p].w));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+        }
+        const uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(outside)) ^ 0xfu;
+        visibleCount += appendSetBits(mask, i, visible);
+    }
+    return visibleCount;
+}
+
+TARGET_AVX2 static void storeColumnAvx2(float* models, int column, __m256 r0, __m256 r1, __m256 r2, __m256 r3)
+{
+    // A 4x8 transpose: the 128 bit halves of object k and k + 4 come out of the same register.
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    const __m256 objects[4] = {_mm256_shuffle_ps(t0, t2, 0x44),
+                               _mm256_shuffle_ps(t0, t2, 0xee),
+                               _mm256_shuffle_ps(t1, t3, 0x44),
+                               _mm256_shuffle_ps(t1, t3, 0xee)};
+    for (int object = 0; object < 4; ++object)
+    {
+        _mm_storeu_ps(models + 16 * object + 4 * column, _mm256_castps256_ps128(objects[object]));
+        _mm_storeu_ps(models + 16 * (object + 4) + 4 * column, _mm256_extractf128_ps(objects[object], 1));
+    }
+}
+
+TARGET_AVX2 static uint32_t updateAvx2(const UpdateArrays& arrays, uint32_t count)
+{
+    const uint32_t blockEnd = count & ~7u;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    for (uint32_t i = 0; i < blockEnd; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(arrays.rotationX + i);
+        const __m256 y = _mm256_loadu_ps(arrays.rotationY + i);
+        const __m256 z = _mm256_loadu_ps(arrays.rotationZ + i);
+        const __m256 w = _mm256_loadu_ps(arrays.rotationW + i);
+        const __m256 s = _mm256_loadu_ps(arrays.scale + i);
+        const __m256 s2 = _mm256_add_ps(s, s);
+        const __m256 xx = _mm256_mul_ps(x, x);
+        const __m256 yy = _mm256_mul_ps(y, y);
+        const __m256 zz = _mm256_mul_ps(z, z);
+        const __m256 xy = _mm256_mul_ps(x, y);
+        const __m256 xz = _mm256_mul_ps(x, z);
+        const __m256 yz = _mm256_mul_ps(y, z);
+        const __m256 wx = _mm256_mul_ps(w, x);
+        const __m256 wy = _mm256_mul_ps(w, y);
+        const __m256 wz = _mm256_mul_ps(w, z);
+
+        // No FMA, the products are rounded like in the other kernels.
+        const __m256 m00 = _mm256_sub_ps(s, _mm256_mul_ps(s2, _mm256_add_ps(yy, zz)));
+        const __m256 m01 = _mm256_mul_ps(s2, _mm256_add_ps(xy, wz));
+        const __m256 m02 = _mm256_mul_ps(s2, _mm256_sub_ps(xz, wy));
+        const __m256 m10 = _mm256_mul_ps(s2, _mm256_sub_ps(xy, wz));
+        const __m256 m11 = _mm256_sub_ps(s, _mm256_mul_ps(s2, _mm256_add_ps(xx, zz)));
+        const __m256 m12 = _mm256_mul_ps(s2, _mm256_add_ps(yz, wx));
+        const __m256 m20 = _mm256_mul_ps(s2, _mm256_add_ps(xz, wy));
+        const __m256 m21 = _mm256_mul_ps(s2, _mm256_sub_ps(yz, wx));
+        const __m256 m22 = _mm256_sub_ps(s, _mm256_mul_ps(s2, _mm256_add_ps(xx, yy)));
+        const __m256 px = _mm256_loadu_ps(arrays.positionX + i);
+        const __m256 py = _mm256_loadu_ps(arrays.positionY + i);
+        const __m256 pz = _mm256_loadu_ps(arrays.positionZ + i);
+
+        const __m256 lx = _mm256_loadu_ps(arrays.localX + i);
+        const __m256 ly = _mm256_loadu_ps(arrays.localY + i);
+        const __m256 lz = _mm256_loadu_ps(arrays.localZ + i);
+        _mm256_storeu_ps(arrays.worldX + i,
+                         _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m00, lx), _mm256_mul_ps(m10, ly)),
+                                                     _mm256_mul_ps(m20, lz)),
+                                       px));
+        _mm256_storeu_ps(arrays.worldY + i,
+                         _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m01, lx), _mm256_mul_ps(m11, ly)),
+                                                     _mm256_mul_ps(m21, lz)),
+                                       py));
+        _mm256_storeu_ps(arrays.worldZ + i,
+                         _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m02, lx), _mm256_mul_ps(m12, ly)),
+                                                     _mm256_mul_ps(m22, lz)),
+                                       pz));
+        _mm256_storeu_ps(arrays.worldRadius + i,
+                         _mm256_mul_ps(_mm256_andnot_ps(signMask, s), _mm256_loadu_ps(arrays.localRadius + i)));
+
+        float* models = arrays.models + 16 * static_cast<size_t>(i);
+        storeColumnAvx2(models, 0, m00, m01, m02, zero);
+        storeColumnAvx2(models, 1, m10, m11, m12, zero);
+        storeColumnAvx2(models, 2, m20, m21, m22, zero);
+        storeColumnAvx2(models, 3, px, py, pz, one);
+    }
+    return blockEnd;
+}
+
+TARGET_AVX2 static uint32_t cullAvx2(const CullArrays& spheres,
+                                     const glm::vec4 planes[6],
+                                     uint32_t count,
+                                     std::vector<uint32_t>& visible)
+{
+    const uint32_t blockEnd = count & ~7u;
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < blockEnd; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(spheres.x + i);
+        const __m256 y = _mm256_loadu_ps(spheres.y + i);
+        const __m256 z = _mm256_loadu_ps(spheres.z + i);
+        const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i));
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; ++p)
+        {
+            const __m256 distance =
+                _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[p].x), x),
+                                                          _mm256_mul_ps(_mm256_set1_ps(planes[p].y), y)),
+                                            _mm256_mul_ps(_mm256_set1_ps(planes[p].z), z)),
+                              _mm256_set1_ps(planes[p].w));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeRadius, _CMP_LT_OQ));
+        }
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(outside)) ^ 0xffu;
+        visibleCount += appendSetBits(mask, i, visible);
+    }
+    return visibleCount;
+}
+#endif
+
+template <typename T>
+static void removeSwap(std::vector<T>& values, uint32_t index)
+{
+    values[index] = values.back();
+    values.pop_back();
+}
+
+SimdLevel detectSimdLevel()
+{
+#ifdef TRANSFORMBATCH_X86_64
+#ifdef _MSC_VER
+    // AVX2 needs the CPU feature and the OS saving the YMM registers.
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return SimdLevel::Sse2;
+    }
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5)) != 0 ? SimdLevel::Avx2 : SimdLevel::Sse2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::Avx2 : SimdLevel::Sse2;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Sse2:
+        return "sse2";
+    case SimdLevel::Avx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+TransformBatch::TransformBatch(SimdLevel level) : m_level(std::min(level, detectSimdLevel()))
+{
+}
+
+uint32_t TransformBatch::add(const glm::vec3& position,
+                             const glm::quat& rotation,
+                             float scale,
+                             const glm::vec4& localSphere)
+{
+    const uint32_t index = size();
+    m_positionX.push_back(position.x);
+    m_positionY.push_back(position.y);
+    m_positionZ.push_back(position.z);
+    m_rotationX.push_back(rotation.x);
+    m_rotationY.push_back(rotation.y);
+    m_rotationZ.push_back(rotation.z);
+    m_rotationW.push_back(rotation.w);
+    m_scale.push_back(scale);
+    m_localX.push_back(localSphere.x);
+    m_localY.push_back(localSphere.y);
+    m_localZ.push_back(localSphere.z);
+    m_localRadius.push_back(localSphere.w);
+    m_worldX.push_back(0.0f);
+    m_worldY.push_back(0.0f);
+    m_worldZ.push_back(0.0f);
+    m_worldRadius.push_back(0.0f);
+    m_models.push_back(glm::mat4(1.0f));
+    return index;
+}
+
+void TransformBatch::setTransform(uint32_t index, const glm::vec3& position, const glm::quat& rotation, float scale)
+{
+    m_positionX[index] = position.x;
+    m_positionY[index] = position.y;
+    m_positionZ[index] = position.z;
+    m_rotationX[index] = rotation.x;
+    m_rotationY[index] = rotation.y;
+    m_rotationZ[index] = rotation.z;
+    m_rotationW[index] = rotation.w;
+    m_scale[index] = scale;
+}
+
+void TransformBatch::removeSwap(uint32_t index)
+{
+    ::removeSwap(m_positionX, index);
+    ::removeSwap(m_positionY, index);
+    ::removeSwap(m_positionZ, index);
+    ::removeSwap(m_rotationX, index);
+    ::removeSwap(m_rotationY, index);
+    ::removeSwap(m_rotationZ, index);
+    ::removeSwap(m_rotationW, index);
+    ::removeSwap(m_scale, index);
+    ::removeSwap(m_localX, index);
+    ::removeSwap(m_localY, index);
+    ::removeSwap(m_localZ, index);
+    ::removeSwap(m_localRadius, index);
+    ::removeSwap(m_worldX, index);
+    ::removeSwap(m_worldY, index);
+    ::removeSwap(m_worldZ, index);
+    ::removeSwap(m_worldRadius, index);
+    ::removeSwap(m_models, index);
+}
+
+void TransformBatch::reserve(uint32_t capacity)
+{
+    for (std::vector<float>* component : {&m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY,
+                                          &m_rotationZ, &m_rotationW, &m_scale, &m_localX, &m_localY, &m_localZ,
+                                          &m_localRadius, &m_worldX, &m_worldY, &m_worldZ, &m_worldRadius})
+    {
+        component->reserve(capacity);
+    }
+    m_models.reserve(capacity);
+}
+
+void TransformBatch::clear()
+{
+    for (std::vector<float>* component : {&m_positionX, &m_positionY, &m_positionZ, &m_rotationX, &m_rotationY,
+                                          &m_rotationZ, &m_rotationW, &m_scale, &m_localX, &m_localY, &m_localZ,
+                                          &m_localRadius, &m_worldX, &m_worldY, &m_worldZ, &m_worldRadius})
+    {
+        component->clear();
+    }
+    m_models.clear();
+}
+
+void TransformBatch::update()
+{
+    const UpdateArrays arrays = {m_positionX.data(),
+                                 m_positionY.data(),
+                                 m_positionZ.data(),
+                                 m_rotationX.data(),
+                                 m_rotationY.data(),
+                                 m_rotationZ.data(),
+                                 m_rotationW.data(),
+                                 m_scale.data(),
+                                 m_localX.data(),
+                                 m_localY.data(),
+                                 m_localZ.data(),
+                                 m_localRadius.data(),
+                                 m_worldX.data(),
+                                 m_worldY.data(),
+                                 m_worldZ.data(),
+                                 m_worldRadius.data(),
+                                 m_models.empty() ? nullptr : &m_models[0][0][0]};
+    // The vector kernels stop at the last full block, the scalar one finishes the tail.
+    uint32_t done = 0;
+#ifdef TRANSFORMBATCH_X86_64
+    if (m_level == SimdLevel::Avx2)
+    {
+        done = updateAvx2(arrays, size());
+    }
+    else if (m_level == SimdLevel::Sse2)
+    {
+        done = updateSse2(arrays, size());
+    }
+#endif
+    updateScalar(arrays, done, size());
+}
+
+uint32_t TransformBatch::cull(const glm::vec4 planes[6], std::vector<uint32_t>& visible) const
+{
+    const CullArrays spheres = {m_worldX.data(), m_worldY.data(), m_worldZ.data(), m_worldRadius.data()};
+    uint32_t visibleCount = 0;
+    uint32_t done = 0;
+#ifdef TRANSFORMBATCH_X86_64
+    if (m_level == SimdLevel::Avx2)
+    {
+        visibleCount = cullAvx2(spheres, planes, size(), visible);
+        done = size() & ~7u;
+    }
+    else if (m_level == SimdLevel::Sse2)
+    {
+        visibleCount = cullSse2(spheres, planes, size(), visible);
+        done = size() & ~3u;
+    }
+#endif
+    return visibleCount + cullScalar(spheres, planes, done, size(), visible);
+}
+
+void frustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+    // Rows of the matrix, glm stores columns.
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; ++row)
+    {
+        rows[row] = glm::vec4(
+            viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    }
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[2];
+    planes[5] = rows[3] - rows[2];
+    for (int i = 0; i < 6; ++i)
+    {
+        const float length = glm::length(glm::vec3(planes[i]));
+        if (length > 0.0f)
+        {
+            planes[i] /= length;
+        }
+    }
+}
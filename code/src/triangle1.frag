@@ -1,9 +1,25 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Specialization constants, set per pipeline variant. The branches below are folded when the pipeline is built.
+// 0: vertex color, 1: grayscale, 2: inverted.
+layout(constant_id = 0) const uint kColorMode = 0u;
+// Number of levels per channel, 0 disables posterization.
+layout(constant_id = 1) const uint kPosterizeLevels = 0u;
+layout(constant_id = 2) const uint kOpacityPercent = 100u;
+
 layout(location = 0) out vec4 outColor;
 layout(location = 0) in vec3 fragColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (kColorMode == 1u) {
+        color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+    } else if (kColorMode == 2u) {
+        color = vec3(1.0) - color;
+    }
+    if (kPosterizeLevels > 0u) {
+        color = floor(color * float(kPosterizeLevels)) / float(kPosterizeLevels);
+    }
+    outColor = vec4(color, float(kOpacityPercent) / 100.0);
 }
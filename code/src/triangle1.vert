@@ -5,21 +5,27 @@ out gl_PerVertex {
     vec4 gl_Position;
 };
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 instanceOffset;
+layout(location = 3) in float instanceScale;
+layout(location = 4) in vec4 instanceColor;
+
+// Per frame data, bound with a dynamic offset into the uniform ring.
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 model;
+    mat4 viewProjection;
+} frame;
 
-vec3 colors[3] = vec3[] (
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
+// Per draw data.
+layout(push_constant) uniform DrawConstants {
+    vec4 tint;
+} draw;
 
-vec2 positions[3] = vec2 [] (
-        vec2(0.0, -0.5),
-        vec2(0.5, 0.5),
-        vec2(-0.5, 0.5)
-);
+layout(location = 0) out vec3 fragColor;
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
+    vec2 position = (frame.model * vec4(inPosition, 0.0, 1.0)).xy;
+    gl_Position = frame.viewProjection * vec4(position * instanceScale + instanceOffset, 0.0, 1.0);
+    fragColor = inColor * instanceColor.rgb * draw.tint.rgb;
 }
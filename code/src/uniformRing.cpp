@@ -0,0 +1,58 @@
+#include "uniformRing.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstring>
+
+UniformRing::UniformRing()
+    : m_allocator(nullptr), m_buffer(VK_NULL_HANDLE), m_sliceSize(0), m_alignedSliceSize(0), m_sliceCount(0)
+{
+}
+
+bool UniformRing::init(GpuMemoryAllocator& allocator,
+                       VkDeviceSize sliceSize,
+                       uint32_t sliceCount,
+                       VkDeviceSize offsetAlignment)
+{
+    m_allocator = &allocator;
+    m_sliceSize = sliceSize;
+    m_sliceCount = sliceCount;
+    // The alignment is a power of two.
+    const VkDeviceSize alignment = offsetAlignment > 0 ? offsetAlignment : 1;
+    m_alignedSliceSize = (sliceSize + alignment - 1) & ~(alignment - 1);
+
+    if (!m_allocator->createBuffer(m_alignedSliceSize * sliceCount,
+                                   VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   m_buffer,
+                                   m_allocation))
+    {
+        lerror("Failed to create uniform ring buffer!");
+        return false;
+    }
+    if (m_allocation.mapped == nullptr)
+    {
+        lerror("Uniform ring buffer is not mapped!");
+        destroy();
+        return false;
+    }
+
+    // Slices are only partially written, start them all from defined contents.
+    std::memset(m_allocation.mapped, 0, static_cast<size_t>(m_alignedSliceSize * sliceCount));
+    ldebug("Uniform ring created: {} slices of {} bytes", sliceCount, m_alignedSliceSize);
+    return true;
+}
+
+void UniformRing::destroy()
+{
+    if (m_allocator != nullptr)
+    {
+        m_allocator->destroyBuffer(m_buffer, m_allocation);
+    }
+    m_sliceCount = 0;
+}
+
+void UniformRing::write(uint32_t slice, const void* data, VkDeviceSize size)
+{
+    std::memcpy(static_cast<char*>(m_allocation.mapped) + dynamicOffset(slice), data, static_cast<size_t>(size));
+}
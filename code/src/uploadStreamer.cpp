@@ -0,0 +1,303 @@
+#include "uploadStreamer.h"
+
+#include "cpuProfiler.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+#include <cstring>
+
+// Streamed buffers are read as vertex, index and uniform data and by the culling compute shader.
+static const VkPipelineStageFlags kConsumerStages =
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+static const VkAccessFlags kConsumerAccess =
+    VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+UploadStreamer::UploadStreamer()
+    : m_allocator(nullptr),
+      m_device(VK_NULL_HANDLE),
+      m_transferQueue(VK_NULL_HANDLE),
+      m_transferFamily(0),
+      m_graphicsFamily(0),
+      m_transferCommandPool(VK_NULL_HANDLE),
+      m_acquireCommandPool(VK_NULL_HANDLE)
+{
+}
+
+bool UploadStreamer::init(GpuMemoryAllocator& allocator,
+                          VkDevice device,
+                          VkQueue transferQueue,
+                          uint32_t transferFamily,
+                          uint32_t graphicsFamily)
+{
+    m_allocator = &allocator;
+    m_device = device;
+    m_transferQueue = transferQueue;
+    m_transferFamily = transferFamily;
+    m_graphicsFamily = graphicsFamily;
+
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_transferCommandPool) != VK_SUCCESS)
+    {
+        lerror("Failed to create transfer command pool!");
+        return false;
+    }
+    if (dedicatedQueueFamily())
+    {
+        poolInfo.queueFamilyIndex = m_graphicsFamily;
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_acquireCommandPool) != VK_SUCCESS)
+        {
+            lerror("Failed to create ownership acquire command pool!");
+            return false;
+        }
+    }
+
+    ldebug("Upload streamer uses queue family {}{}.",
+           m_transferFamily,
+           dedicatedQueueFamily() ? "" : ", shared with graphics");
+    return true;
+}
+
+void UploadStreamer::destroy()
+{
+    if (m_device == VK_NULL_HANDLE)
+    {
+        // Never initialized.
+        return;
+    }
+    for (Batch& batch : m_batches)
+    {
+        freeBatch(batch);
+    }
+    m_batches.clear();
+    for (VkSemaphore semaphore : m_freeSemaphores)
+    {
+        vkDestroySemaphore(m_device, semaphore, nullptr);
+    }
+    m_freeSemaphores.clear();
+    vkDestroyCommandPool(m_device, m_acquireCommandPool, nullptr);
+    vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
+    m_acquireCommandPool = VK_NULL_HANDLE;
+    m_transferCommandPool = VK_NULL_HANDLE;
+    m_pendingCopies.clear();
+}
+
+void UploadStreamer::enqueue(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+    if (size > 0)
+    {
+        m_pendingCopies.push_back({data, size, dstBuffer, dstOffset});
+    }
+}
+
+bool UploadStreamer::submit()
+{
+    PROFILE_FUNCTION();
+    if (m_pendingCopies.empty())
+    {
+        return true;
+    }
+
+    // Same layout as the staging uploader, 16 byte aligned copy sources.
+    const VkDeviceSize copyAlignment = 16;
+    VkDeviceSize stagingSize = 0;
+    for (const PendingCopy& copy : m_pendingCopies)
+    {
+        stagingSize = (stagingSize + copyAlignment - 1) & ~(copyAlignment - 1);
+        stagingSize += copy.size;
+    }
+
+    Batch batch;
+    if (!m_allocator->createBuffer(stagingSize,
+                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   batch.stagingBuffer,
+                                   batch.stagingAllocation))
+    {
+        lerror("Failed to create streaming staging buffer of {} bytes!", stagingSize);
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_transferCommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    batch.semaphore = takeSemaphore();
+    if (batch.semaphore == VK_NULL_HANDLE ||
+        vkAllocateCommandBuffers(m_device, &allocInfo, &batch.transferCommands) != VK_SUCCESS)
+    {
+        lerror("Failed to prepare upload batch!");
+        freeBatch(batch);
+        return false;
+    }
+    if (dedicatedQueueFamily())
+    {
+        allocInfo.commandPool = m_acquireCommandPool;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &batch.acquireCommands) != VK_SUCCESS)
+        {
+            lerror("Failed to allocate ownership acquire command buffer!");
+            freeBatch(batch);
+            return false;
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch.transferCommands, &beginInfo);
+
+    // A release barrier on the transfer family and a matching acquire barrier on the graphics family per copy.
+    // Sharing a family, the semaphore alone makes the copies visible to the waiting stages.
+    std::vector<VkBufferMemoryBarrier> releaseBarriers;
+    std::vector<VkBufferMemoryBarrier> acquireBarriers;
+    char* mapped = static_cast<char*>(batch.stagingAllocation.mapped);
+    VkDeviceSize stagingOffset = 0;
+    for (const PendingCopy& copy : m_pendingCopies)
+    {
+        stagingOffset = (stagingOffset + copyAlignment - 1) & ~(copyAlignment - 1);
+        std::memcpy(mapped + stagingOffset, copy.data, static_cast<size_t>(copy.size));
+
+        VkBufferCopy region = {};
+        region.srcOffset = stagingOffset;
+        region.dstOffset = copy.dstOffset;
+        region.size = copy.size;
+        vkCmdCopyBuffer(batch.transferCommands, batch.stagingBuffer, copy.dstBuffer, 1, &region);
+        stagingOffset += copy.size;
+
+        if (dedicatedQueueFamily())
+        {
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = m_transferFamily;
+            barrier.dstQueueFamilyIndex = m_graphicsFamily;
+            barrier.buffer = copy.dstBuffer;
+            barrier.offset = copy.dstOffset;
+            barrier.size = copy.size;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            releaseBarriers.push_back(barrier);
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = kConsumerAccess;
+            acquireBarriers.push_back(barrier);
+        }
+    }
+
+    if (dedicatedQueueFamily())
+    {
+        vkCmdPipelineBarrier(batch.transferCommands,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0,
+                             0,
+                             nullptr,
+                             static_cast<uint32_t>(releaseBarriers.size()),
+                             releaseBarriers.data(),
+                             0,
+                             nullptr);
+
+        vkBeginCommandBuffer(batch.acquireCommands, &beginInfo);
+        vkCmdPipelineBarrier(batch.acquireCommands,
+                             kConsumerStages,
+                             kConsumerStages,
+                             0,
+                             0,
+                             nullptr,
+                             static_cast<uint32_t>(acquireBarriers.size()),
+                             acquireBarriers.data(),
+                             0,
+                             nullptr);
+        vkEndCommandBuffer(batch.acquireCommands);
+    }
+    vkEndCommandBuffer(batch.transferCommands);
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.transferCommands;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &batch.semaphore;
+    if (vkQueueSubmit(m_transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    {
+        lerror("Failed to submit upload batch!");
+        freeBatch(batch);
+        return false;
+    }
+
+    ldebug("Streaming {} bytes in {} copies.", stagingOffset, m_pendingCopies.size());
+    m_pendingCopies.clear();
+    m_batches.push_back(batch);
+    return true;
+}
+
+void UploadStreamer::takeHandoffs(uint64_t submissionNumber, GraphicsHandoff& handoff)
+{
+    for (Batch& batch : m_batches)
+    {
+        if (batch.handedOff)
+        {
+            continue;
+        }
+        handoff.waitSemaphores.push_back(batch.semaphore);
+        handoff.waitStages.push_back(kConsumerStages);
+        if (batch.acquireCommands != VK_NULL_HANDLE)
+        {
+            handoff.commandBuffers.push_back(batch.acquireCommands);
+        }
+        batch.handedOff = true;
+        batch.submissionNumber = submissionNumber;
+    }
+}
+
+void UploadStreamer::release(uint64_t completedSubmissions)
+{
+    while (!m_batches.empty() && m_batches.front().handedOff &&
+           m_batches.front().submissionNumber < completedSubmissions)
+    {
+        Batch& batch = m_batches.front();
+        // The wait consumed the signal, the semaphore is ready for another batch.
+        m_freeSemaphores.push_back(batch.semaphore);
+        batch.semaphore = VK_NULL_HANDLE;
+        freeBatch(batch);
+        m_batches.pop_front();
+    }
+}
+
+VkSemaphore UploadStreamer::takeSemaphore()
+{
+    if (!m_freeSemaphores.empty())
+    {
+        const VkSemaphore semaphore = m_freeSemaphores.back();
+        m_freeSemaphores.pop_back();
+        return semaphore;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+    {
+        lerror("Failed to create upload semaphore!");
+        return VK_NULL_HANDLE;
+    }
+    return semaphore;
+}
+
+void UploadStreamer::freeBatch(Batch& batch)
+{
+    if (batch.transferCommands != VK_NULL_HANDLE)
+    {
+        vkFreeCommandBuffers(m_device, m_transferCommandPool, 1, &batch.transferCommands);
+    }
+    if (batch.acquireCommands != VK_NULL_HANDLE)
+    {
+        vkFreeCommandBuffers(m_device, m_acquireCommandPool, 1, &batch.acquireCommands);
+    }
+    if (batch.semaphore != VK_NULL_HANDLE)
+    {
+        vkDestroySemaphore(m_device, batch.semaphore, nullptr);
+    }
+    m_allocator->destroyBuffer(batch.stagingBuffer, batch.stagingAllocation);
+    batch = Batch();
+}
@@ -0,0 +1,24 @@
+#include "vkHelpers.h"
+
+#include "sorban_loom/sorban_loom.h"
+
+bool findMemoryType(const VkPhysicalDevice& device,
+                    uint32_t typeFilter,
+                    VkMemoryPropertyFlags properties,
+                    uint32_t& memoryTypeIndex)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+    {
+        if ((typeFilter & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            memoryTypeIndex = i;
+            return true;
+        }
+    }
+
+    lerror("Failed to find a suitable memory type!");
+    return false;
+}
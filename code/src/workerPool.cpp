@@ -0,0 +1,86 @@
+#include "workerPool.h"
+
+#include "cpuProfiler.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(uint32_t threadCount) : m_stopping(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_threads.reserve(threadCount);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_jobAvailable.notify_all();
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_jobAvailable.notify_one();
+}
+
+void WorkerPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    uint32_t remaining = count;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            m_jobs.push_back([&, i]() {
+                task(i);
+                std::lock_guard<std::mutex> doneLock(doneMutex);
+                if (--remaining == 0)
+                {
+                    doneCondition.notify_one();
+                }
+            });
+        }
+    }
+    m_jobAvailable.notify_all();
+
+    std::unique_lock<std::mutex> doneLock(doneMutex);
+    doneCondition.wait(doneLock, [&]() { return remaining == 0; });
+}
+
+void WorkerPool::workerLoop()
+{
+    PROFILE_THREAD_NAME("worker");
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_jobAvailable.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty())
+            {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,56 @@
+#include "cpuProfiler.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+static std::string readTextFile(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+TEST(CpuProfiler, ZonesOfAllThreadsAreExported)
+{
+    {
+        CpuProfileZone zone("cpuProfilerTestMain");
+    }
+    std::thread worker([]() {
+        CpuProfiler::instance().setThreadName("cpuProfilerTestWorker");
+        CpuProfileZone outer("cpuProfilerTestOuter");
+        CpuProfileZone inner("cpuProfilerTestInner");
+    });
+    worker.join();
+
+    const std::string filePath = "cpuProfilerTest.json";
+    ASSERT_TRUE(CpuProfiler::instance().writeChromeTrace(filePath));
+    const std::string trace = readTextFile(filePath);
+    std::remove(filePath.c_str());
+
+    EXPECT_EQ(trace.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["), 0u);
+    EXPECT_NE(trace.find("\"name\": \"cpuProfilerTestMain\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"cpuProfilerTestOuter\""), std::string::npos);
+    EXPECT_NE(trace.find("\"name\": \"cpuProfilerTestInner\""), std::string::npos);
+    EXPECT_NE(trace.find("\"args\": {\"name\": \"cpuProfilerTestWorker\"}"), std::string::npos);
+    EXPECT_EQ(CpuProfiler::instance().droppedEventCount(), 0u);
+}
+
+TEST(CpuProfiler, DisabledMacrosCompileToNothing)
+{
+#ifndef CPU_PROFILER_ENABLED
+    PROFILE_ZONE("never recorded");
+    PROFILE_FUNCTION();
+    PROFILE_THREAD_NAME("never named");
+    const std::string filePath = "cpuProfilerMacroTest.json";
+    ASSERT_TRUE(CpuProfiler::instance().writeChromeTrace(filePath));
+    const std::string trace = readTextFile(filePath);
+    std::remove(filePath.c_str());
+    EXPECT_EQ(trace.find("never"), std::string::npos);
+#endif
+}
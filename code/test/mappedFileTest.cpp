@@ -0,0 +1,60 @@
+#include "mappedFile.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <vector>
+
+static std::vector<char> writeRandomFile(const std::string& filePath, size_t size)
+{
+    std::vector<char> content(size);
+    std::mt19937 random(3);
+    for (auto& byte : content)
+    {
+        byte = static_cast<char>(random());
+    }
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), content.size());
+    return content;
+}
+
+TEST(MappedFile, MapsFileContent)
+{
+    const std::string filePath = "mappedFileTest.bin";
+    const std::vector<char> content = writeRandomFile(filePath, 100000);
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(filePath, MappedFile::AccessHint::Sequential));
+    ASSERT_EQ(file.size(), content.size());
+    EXPECT_EQ(std::memcmp(file.data(), content.data(), content.size()), 0);
+    file.prefetch(4096, 50000);
+
+    const char* span = nullptr;
+    EXPECT_TRUE(file.span(256, 1024, 256, span));
+    EXPECT_EQ(span, file.data() + 256);
+    EXPECT_FALSE(file.span(100, 16, 64, span));
+    EXPECT_FALSE(file.span(99990, 16, 1, span));
+    EXPECT_TRUE(file.span(content.size(), 0, 1, span));
+
+    file.close();
+    EXPECT_FALSE(file.isOpen());
+    std::remove(filePath.c_str());
+}
+
+TEST(MappedFile, HandlesEmptyAndMissingFiles)
+{
+    const std::string filePath = "mappedFileEmpty.bin";
+    writeRandomFile(filePath, 0);
+
+    MappedFile file;
+    ASSERT_TRUE(file.open(filePath));
+    EXPECT_EQ(file.size(), 0u);
+    EXPECT_EQ(file.data(), nullptr);
+    std::remove(filePath.c_str());
+
+    EXPECT_FALSE(file.open("mappedFileMissing.bin"));
+    EXPECT_FALSE(file.isOpen());
+}
@@ -0,0 +1,43 @@
+#include "pipelineVariant.h"
+
+#include "gtest/gtest.h"
+
+#include <unordered_map>
+
+TEST(PipelineVariant, EqualKeysHashEqually)
+{
+    PipelineVariantKey first;
+    first.specializationConstants[0] = 2;
+    first.blendMode = BlendMode::Alpha;
+    PipelineVariantKey second = first;
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(PipelineVariantKeyHash()(first), PipelineVariantKeyHash()(second));
+
+    second.specializationConstants[3] = 1;
+    EXPECT_NE(first, second);
+    second = first;
+    second.blendMode = BlendMode::Additive;
+    EXPECT_NE(first, second);
+}
+
+TEST(PipelineVariant, TableKeepsOneEntryPerKey)
+{
+    std::unordered_map<PipelineVariantKey, uint32_t, PipelineVariantKeyHash> table;
+    for (uint32_t i = 0; i < 64; ++i)
+    {
+        PipelineVariantKey key;
+        key.specializationConstants[0] = i % 8;
+        key.specializationConstants[1] = i / 8;
+        key.blendMode = static_cast<BlendMode>(i % 3);
+        table.emplace(key, i);
+    }
+    // Repeated keys do not add entries, their first index stays.
+    PipelineVariantKey key;
+    key.specializationConstants[0] = 1;
+    key.blendMode = BlendMode::Alpha;
+    EXPECT_FALSE(table.emplace(key, 100u).second);
+
+    EXPECT_EQ(table.size(), 64u);
+    EXPECT_EQ(table.at(key), 1u);
+}
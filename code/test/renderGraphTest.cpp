@@ -0,0 +1,251 @@
+#include "renderGraph.h"
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+static const ImageState kAcquired = {VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+static const ImageState kPresented = {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0};
+static const TransientImageDesc kColorTarget = {VK_FORMAT_R16G16B16A16_SFLOAT, 256, 256};
+
+// Every transient image takes 1024 bytes aligned to 256 bytes.
+static MemoryFootprint fixedFootprint(uint32_t)
+{
+    return {1024, 256};
+}
+
+static const GraphImageBarrier* findBarrier(const BarrierBatch& batch, uint32_t resource)
+{
+    for (const GraphImageBarrier& barrier : batch.imageBarriers)
+    {
+        if (barrier.resource == resource)
+        {
+            return &barrier;
+        }
+    }
+    return nullptr;
+}
+
+TEST(RenderGraph, CullsPassesNotContributingToOutputs)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t shadow = graph.createImage("shadow", kColorTarget);
+    const uint32_t debug = graph.createImage("debug", kColorTarget);
+
+    const uint32_t shadowPass = graph.addPass("shadow");
+    graph.useImage(shadowPass, shadow, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t debugPass = graph.addPass("debug");
+    graph.useImage(debugPass, debug, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t capturePass = graph.addPass("capture", true);
+    graph.useImage(capturePass, shadow, ImageUsage::TransferSrc);
+    const uint32_t mainPass = graph.addPass("main");
+    graph.useImage(mainPass, shadow, ImageUsage::FragmentSampled);
+    graph.useImage(mainPass, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+
+    const std::vector<uint32_t> expected = {shadowPass, capturePass, mainPass};
+    EXPECT_EQ(expected, graph.passOrder());
+    EXPECT_TRUE(graph.resourceUsed(shadow));
+    EXPECT_FALSE(graph.resourceUsed(debug));
+    EXPECT_EQ(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+              graph.imageUsageFlags(shadow));
+}
+
+TEST(RenderGraph, CullsWritersOfOverwrittenContents)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t first = graph.addPass("first");
+    graph.useImage(first, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t blend = graph.addPass("blend");
+    graph.useImage(blend, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Load);
+    const uint32_t overwrite = graph.addPass("overwrite");
+    graph.useImage(overwrite, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+
+    const std::vector<uint32_t> expected = {overwrite};
+    EXPECT_EQ(expected, graph.passOrder());
+}
+
+TEST(RenderGraph, BatchesBarriersAndTransitionsPerPass)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t albedo = graph.createImage("albedo", kColorTarget);
+    const uint32_t normals = graph.createImage("normals", kColorTarget);
+    const uint32_t geometry = graph.addPass("geometry");
+    graph.useImage(geometry, albedo, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    graph.useImage(geometry, normals, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t lighting = graph.addPass("lighting");
+    graph.useImage(lighting, albedo, ImageUsage::FragmentSampled);
+    graph.useImage(lighting, normals, ImageUsage::FragmentSampled);
+    graph.useImage(lighting, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+
+    const BarrierBatch& beforeGeometry = graph.barriersBefore(0);
+    ASSERT_EQ(2u, beforeGeometry.imageBarriers.size());
+    EXPECT_EQ(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT), beforeGeometry.srcStages);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, beforeGeometry.imageBarriers[0].oldLayout);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, beforeGeometry.imageBarriers[0].newLayout);
+
+    // Both inputs and the output are transitioned by one batch.
+    const BarrierBatch& beforeLighting = graph.barriersBefore(1);
+    ASSERT_EQ(3u, beforeLighting.imageBarriers.size());
+    EXPECT_EQ(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+              beforeLighting.srcStages);
+    EXPECT_EQ(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT),
+              beforeLighting.dstStages);
+    const GraphImageBarrier* albedoBarrier = findBarrier(beforeLighting, albedo);
+    ASSERT_NE(nullptr, albedoBarrier);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, albedoBarrier->oldLayout);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, albedoBarrier->newLayout);
+    EXPECT_EQ(static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT), albedoBarrier->srcAccess);
+    EXPECT_EQ(static_cast<VkAccessFlags>(VK_ACCESS_SHADER_READ_BIT), albedoBarrier->dstAccess);
+
+    const BarrierBatch& final = graph.finalBarriers();
+    ASSERT_EQ(1u, final.imageBarriers.size());
+    EXPECT_EQ(backbuffer, final.imageBarriers[0].resource);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, final.imageBarriers[0].oldLayout);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, final.imageBarriers[0].newLayout);
+    EXPECT_EQ(static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT), final.dstStages);
+}
+
+TEST(RenderGraph, SkipsBarriersBetweenReadsOfTheSameStage)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t scene = graph.createImage("scene", kColorTarget);
+    const uint32_t histogram = graph.createImage("histogram", kColorTarget);
+    const uint32_t render = graph.addPass("render");
+    graph.useImage(render, scene, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t tonemap = graph.addPass("tonemap");
+    graph.useImage(tonemap, scene, ImageUsage::FragmentSampled);
+    graph.useImage(tonemap, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t overlay = graph.addPass("overlay");
+    graph.useImage(overlay, scene, ImageUsage::FragmentSampled);
+    graph.useImage(overlay, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Load);
+    const uint32_t analyze = graph.addPass("analyze", true);
+    graph.useImage(analyze, scene, ImageUsage::ComputeSampled);
+    graph.useImage(analyze, histogram, ImageUsage::ComputeStorage);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+    ASSERT_EQ(4u, graph.passOrder().size());
+
+    // The second fragment read finds the image transitioned and visible already, only the output is synchronized.
+    const BarrierBatch& beforeOverlay = graph.barriersBefore(2);
+    EXPECT_EQ(nullptr, findBarrier(beforeOverlay, scene));
+    const GraphImageBarrier* outputBarrier = findBarrier(beforeOverlay, backbuffer);
+    ASSERT_NE(nullptr, outputBarrier);
+    EXPECT_EQ(outputBarrier->oldLayout, outputBarrier->newLayout);
+
+    // Compute reads in the same layout, the earlier transition still has to be made visible to its stage.
+    const GraphImageBarrier* computeBarrier = findBarrier(graph.barriersBefore(3), scene);
+    ASSERT_NE(nullptr, computeBarrier);
+    EXPECT_EQ(computeBarrier->oldLayout, computeBarrier->newLayout);
+    EXPECT_EQ(0u, computeBarrier->srcAccess);
+}
+
+TEST(RenderGraph, AliasesTransientImagesWithDisjointLifetimes)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t first = graph.createImage("first", kColorTarget);
+    const uint32_t second = graph.createImage("second", kColorTarget);
+    const uint32_t third = graph.createImage("third", kColorTarget);
+    const uint32_t pass0 = graph.addPass("pass0");
+    graph.useImage(pass0, first, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t pass1 = graph.addPass("pass1");
+    graph.useImage(pass1, first, ImageUsage::FragmentSampled);
+    graph.useImage(pass1, second, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t pass2 = graph.addPass("pass2");
+    graph.useImage(pass2, second, ImageUsage::FragmentSampled);
+    graph.useImage(pass2, third, ImageUsage::ColorAttachment, AttachmentLoad::DontCare);
+    const uint32_t pass3 = graph.addPass("pass3");
+    graph.useImage(pass3, third, ImageUsage::FragmentSampled);
+    graph.useImage(pass3, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+
+    EXPECT_EQ(graph.memoryOffset(first), graph.memoryOffset(third));
+    EXPECT_NE(graph.memoryOffset(first), graph.memoryOffset(second));
+    EXPECT_EQ(0u, graph.memoryOffset(second) % 256);
+    EXPECT_EQ(2048u, graph.transientMemorySize());
+    EXPECT_EQ(3072u, graph.unaliasedMemorySize());
+
+    // The image taking over the memory discards its contents and waits for the last reads of the previous one.
+    const GraphImageBarrier* takeover = findBarrier(graph.barriersBefore(2), third);
+    ASSERT_NE(nullptr, takeover);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, takeover->oldLayout);
+    EXPECT_NE(0u, graph.barriersBefore(2).srcStages & VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+TEST(RenderGraph, AliasedFirstUseWaitsForThePreviousWrite)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t scratch = graph.createImage("scratch", kColorTarget);
+    const uint32_t color = graph.createImage("color", kColorTarget);
+    // Only written, kept alive by its side effects.
+    const uint32_t pass0 = graph.addPass("pass0", true);
+    graph.useImage(pass0, scratch, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t pass1 = graph.addPass("pass1");
+    graph.useImage(pass1, color, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    const uint32_t pass2 = graph.addPass("pass2");
+    graph.useImage(pass2, color, ImageUsage::FragmentSampled);
+    graph.useImage(pass2, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+    ASSERT_EQ(graph.memoryOffset(scratch), graph.memoryOffset(color));
+
+    // Write after write on the same memory: the takeover has to wait for the write and make it available.
+    const BarrierBatch& batch = graph.barriersBefore(1);
+    const GraphImageBarrier* takeover = findBarrier(batch, color);
+    ASSERT_NE(nullptr, takeover);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_UNDEFINED, takeover->oldLayout);
+    EXPECT_EQ(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, takeover->srcAccess & VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+    EXPECT_NE(0u, batch.srcStages & VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+}
+
+TEST(RenderGraph, StoresOnlyContentsReadLater)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t color = graph.createImage("color", kColorTarget);
+    const uint32_t depth = graph.createImage("depth", {VK_FORMAT_D32_SFLOAT, 256, 256});
+    const uint32_t scene = graph.addPass("scene");
+    graph.useImage(scene, color, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    graph.useImage(scene, depth, ImageUsage::DepthStencilAttachment, AttachmentLoad::Clear);
+    const uint32_t resolve = graph.addPass("resolve");
+    graph.useImage(resolve, color, ImageUsage::FragmentSampled);
+    graph.useImage(resolve, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::DontCare);
+    ASSERT_TRUE(graph.compile(fixedFootprint));
+
+    const std::vector<GraphAttachment>& sceneAttachments = graph.attachments(scene);
+    ASSERT_EQ(2u, sceneAttachments.size());
+    EXPECT_EQ(VK_ATTACHMENT_LOAD_OP_CLEAR, sceneAttachments[0].loadOp);
+    EXPECT_EQ(VK_ATTACHMENT_STORE_OP_STORE, sceneAttachments[0].storeOp);
+    EXPECT_EQ(VK_ATTACHMENT_STORE_OP_DONT_CARE, sceneAttachments[1].storeOp);
+    EXPECT_EQ(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, sceneAttachments[1].layout);
+
+    const std::vector<GraphAttachment>& resolveAttachments = graph.attachments(resolve);
+    ASSERT_EQ(1u, resolveAttachments.size());
+    EXPECT_EQ(VK_ATTACHMENT_LOAD_OP_DONT_CARE, resolveAttachments[0].loadOp);
+    EXPECT_EQ(VK_ATTACHMENT_STORE_OP_STORE, resolveAttachments[0].storeOp);
+}
+
+TEST(RenderGraph, RejectsInvalidDeclarations)
+{
+    RenderGraph graph;
+    const uint32_t backbuffer = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t unwritten = graph.createImage("unwritten", kColorTarget);
+    const uint32_t pass = graph.addPass("main");
+    graph.useImage(pass, unwritten, ImageUsage::FragmentSampled);
+    graph.useImage(pass, backbuffer, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    EXPECT_FALSE(graph.compile(fixedFootprint));
+
+    graph.clear();
+    const uint32_t image = graph.importImage("backbuffer", VK_FORMAT_B8G8R8A8_UNORM, kAcquired, kPresented);
+    const uint32_t twice = graph.addPass("twice");
+    graph.useImage(twice, image, ImageUsage::ColorAttachment, AttachmentLoad::Clear);
+    graph.useImage(twice, image, ImageUsage::FragmentSampled);
+    EXPECT_FALSE(graph.compile(fixedFootprint));
+}
@@ -0,0 +1,41 @@
+#include "rollingStatistics.h"
+
+#include "gtest/gtest.h"
+
+TEST(RollingStatistics, EmptyStatisticsAreZero)
+{
+    RollingStatistics statistics;
+    EXPECT_TRUE(statistics.empty());
+    EXPECT_EQ(statistics.count(), 0u);
+    EXPECT_EQ(statistics.average(), 0.0);
+    EXPECT_EQ(statistics.percentile(99.0), 0.0);
+}
+
+TEST(RollingStatistics, PercentilesUseNearestRank)
+{
+    RollingStatistics statistics;
+    for (int i = 100; i >= 1; --i)
+    {
+        statistics.add(i);
+    }
+    EXPECT_EQ(statistics.min(), 1.0);
+    EXPECT_EQ(statistics.max(), 100.0);
+    EXPECT_DOUBLE_EQ(statistics.average(), 50.5);
+    EXPECT_EQ(statistics.percentile(50.0), 50.0);
+    EXPECT_EQ(statistics.percentile(99.0), 99.0);
+    EXPECT_EQ(statistics.percentile(100.0), 100.0);
+    EXPECT_EQ(statistics.percentile(0.0), 1.0);
+}
+
+TEST(RollingStatistics, OnlyTheMostRecentSamplesCount)
+{
+    RollingStatistics statistics(4);
+    for (int i = 1; i <= 10; ++i)
+    {
+        statistics.add(i);
+    }
+    EXPECT_EQ(statistics.count(), 10u);
+    EXPECT_EQ(statistics.min(), 7.0);
+    EXPECT_EQ(statistics.max(), 10.0);
+    EXPECT_DOUBLE_EQ(statistics.average(), 8.5);
+}
@@ -0,0 +1,190 @@
+#include "sceneStore.h"
+
+#include "gtest/gtest.h"
+
+// The inside of the cube [-1, 1]^3, normalized and facing inwards.
+static const glm::vec4 kUnitCube[6] = {glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+                                       glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+                                       glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
+                                       glm::vec4(0.0f, -1.0f, 0.0f, 1.0f),
+                                       glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+                                       glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)};
+
+static EntityDesc entityAt(float x, uint32_t mesh = 0, uint32_t material = 0)
+{
+    EntityDesc desc;
+    desc.position = glm::vec3(x, 0.0f, 0.0f);
+    desc.localSphere = glm::vec4(0.0f, 0.0f, 0.0f, 0.1f);
+    desc.mesh = mesh;
+    desc.material = material;
+    return desc;
+}
+
+TEST(SceneStore, DestroyedHandlesStayDead)
+{
+    SceneStore store;
+    store.addMesh(MeshRange());
+    const Entity first = store.create(entityAt(0.0f));
+    EXPECT_TRUE(store.alive(first));
+    EXPECT_TRUE(store.destroy(first));
+    EXPECT_FALSE(store.alive(first));
+    EXPECT_FALSE(store.destroy(first));
+    EXPECT_FALSE(store.alive(Entity()));
+
+    // The slot is reused with a new generation, the old handle does not see the new entity.
+    const Entity second = store.create(entityAt(0.0f));
+    EXPECT_EQ(second.slot, first.slot);
+    EXPECT_NE(second.generation, first.generation);
+    EXPECT_FALSE(store.alive(first));
+    EXPECT_TRUE(store.alive(second));
+
+    store.clear();
+    EXPECT_EQ(store.size(), 0u);
+    EXPECT_FALSE(store.alive(second));
+}
+
+TEST(SceneStore, RejectsUnknownMeshes)
+{
+    SceneStore store;
+    EXPECT_FALSE(store.alive(store.create(entityAt(0.0f, 0))));
+    EXPECT_EQ(store.size(), 0u);
+
+    const uint32_t mesh = store.addMesh(MeshRange());
+    const Entity entity = store.create(entityAt(0.0f, mesh));
+    ASSERT_TRUE(store.alive(entity));
+    EXPECT_FALSE(store.setMesh(entity, mesh + 1));
+    EXPECT_EQ(store.meshes()[store.denseIndex(entity)], mesh);
+    EXPECT_TRUE(store.setMesh(entity, mesh));
+}
+
+TEST(SceneStore, SettersIgnoreDeadHandles)
+{
+    SceneStore store;
+    const uint32_t mesh = store.addMesh(MeshRange());
+    const Entity stale = store.create(entityAt(0.0f, mesh, 1));
+    // Leaves a single entity, at the dense index the stale handle used to have.
+    const Entity survivor = store.create(entityAt(0.5f, mesh, 2));
+    ASSERT_TRUE(store.destroy(stale));
+
+    EXPECT_FALSE(store.setTransform(stale, glm::vec3(5.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 2.0f));
+    EXPECT_FALSE(store.setMesh(stale, mesh));
+    EXPECT_FALSE(store.setMaterial(stale, 7));
+    EXPECT_FALSE(store.setMaterial(Entity(), 7));
+    EXPECT_EQ(store.materials()[store.denseIndex(survivor)], 2u);
+
+    store.update();
+    SceneDraws draws;
+    store.collectDraws(kUnitCube, draws);
+    ASSERT_EQ(draws.instances.size(), 1u);
+    EXPECT_FLOAT_EQ(draws.instances[0][3].x, 0.5f);
+
+    EXPECT_TRUE(store.setMaterial(survivor, 3));
+    EXPECT_EQ(store.materials()[store.denseIndex(survivor)], 3u);
+}
+
+TEST(SceneStore, DestroyKeepsTheComponentsDense)
+{
+    SceneStore store;
+    std::vector<Entity> entities;
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        store.addMesh(MeshRange());
+        entities.push_back(store.create(entityAt(static_cast<float>(i), i, 10 + i)));
+    }
+    store.destroy(entities[1]);
+    store.destroy(entities[3]);
+    store.update();
+
+    ASSERT_EQ(store.size(), 3u);
+    for (uint32_t i : {0u, 2u, 4u})
+    {
+        ASSERT_TRUE(store.alive(entities[i]));
+        const uint32_t dense = store.denseIndex(entities[i]);
+        ASSERT_LT(dense, store.size());
+        EXPECT_EQ(store.entityAt(dense).slot, entities[i].slot);
+        EXPECT_EQ(store.meshes()[dense], i);
+        EXPECT_EQ(store.materials()[dense], 10 + i);
+        EXPECT_EQ(store.transforms().worldSphere(dense).x, static_cast<float>(i));
+    }
+}
+
+TEST(SceneStore, CollectDrawsInstancesTheVisibleEntitiesPerMeshAndMaterial)
+{
+    SceneStore store;
+    MeshRange triangle;
+    triangle.indexCount = 3;
+    MeshRange quad;
+    quad.indexCount = 6;
+    quad.firstIndex = 3;
+    quad.vertexOffset = 3;
+    const uint32_t triangleMesh = store.addMesh(triangle);
+    const uint32_t quadMesh = store.addMesh(quad);
+
+    store.create(entityAt(-0.5f, triangleMesh, 0));
+    store.create(entityAt(0.0f, quadMesh, 0));
+    // Outside of the cube.
+    store.create(entityAt(5.0f, triangleMesh, 0));
+    store.create(entityAt(0.25f, triangleMesh, 1));
+    store.create(entityAt(0.5f, triangleMesh, 0));
+    store.update();
+
+    SceneDraws draws;
+    store.collectDraws(kUnitCube, draws);
+    ASSERT_EQ(draws.commands.size(), 3u);
+    ASSERT_EQ(draws.commandMaterials.size(), 3u);
+    ASSERT_EQ(draws.instances.size(), 4u);
+
+    // Triangles of material 0, in creation order.
+    EXPECT_EQ(draws.commands[0].indexCount, 3u);
+    EXPECT_EQ(draws.commands[0].instanceCount, 2u);
+    EXPECT_EQ(draws.commands[0].firstInstance, 0u);
+    EXPECT_EQ(draws.commandMaterials[0], 0u);
+    EXPECT_EQ(draws.instances[0][3][0], -0.5f);
+    EXPECT_EQ(draws.instances[1][3][0], 0.5f);
+
+    EXPECT_EQ(draws.commands[1].indexCount, 6u);
+    EXPECT_EQ(draws.commands[1].firstIndex, 3u);
+    EXPECT_EQ(draws.commands[1].vertexOffset, 3);
+    EXPECT_EQ(draws.commands[1].instanceCount, 1u);
+    EXPECT_EQ(draws.commands[1].firstInstance, 2u);
+    EXPECT_EQ(draws.instances[2][3][0], 0.0f);
+
+    EXPECT_EQ(draws.commands[2].instanceCount, 1u);
+    EXPECT_EQ(draws.commands[2].firstInstance, 3u);
+    EXPECT_EQ(draws.commandMaterials[2], 1u);
+    EXPECT_EQ(draws.instances[3][3][0], 0.25f);
+}
+
+TEST(SceneStore, CollectDrawsHandlesManyMeshAndMaterialPairs)
+{
+    SceneStore store;
+    const uint32_t meshCount = 50;
+    for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+    {
+        MeshRange range;
+        range.indexCount = 3;
+        range.firstIndex = 3 * mesh;
+        store.addMesh(range);
+    }
+    // 500 pairs, enough to grow the command table several times, every pair created twice and interleaved.
+    for (uint32_t round = 0; round < 2; ++round)
+    {
+        for (uint32_t pair = 0; pair < 500; ++pair)
+        {
+            store.create(entityAt(0.0f, pair % meshCount, pair / meshCount));
+        }
+    }
+    store.update();
+
+    SceneDraws draws;
+    store.collectDraws(kUnitCube, draws);
+    ASSERT_EQ(draws.commands.size(), 500u);
+    ASSERT_EQ(draws.instances.size(), 1000u);
+    for (uint32_t pair = 0; pair < 500; ++pair)
+    {
+        EXPECT_EQ(draws.commands[pair].firstIndex, 3 * (pair % meshCount));
+        EXPECT_EQ(draws.commandMaterials[pair], pair / meshCount);
+        EXPECT_EQ(draws.commands[pair].instanceCount, 2u);
+        EXPECT_EQ(draws.commands[pair].firstInstance, 2 * pair);
+    }
+}
@@ -0,0 +1,152 @@
+#include "spirvReflection.h"
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+
+// Assembles SPIR-V modules instruction by instruction, the ids are chosen by the tests.
+class SpirvBuilder
+{
+public:
+    SpirvBuilder()
+    {
+        m_words = {0x07230203, 0x00010000, 0, 100, 0};
+    }
+
+    SpirvBuilder& op(uint32_t opcode, std::initializer_list<uint32_t> operands)
+    {
+        m_words.push_back(static_cast<uint32_t>(operands.size() + 1) << 16 | opcode);
+        m_words.insert(m_words.end(), operands);
+        return *this;
+    }
+
+    // OpEntryPoint with a nul terminated name padded to whole words.
+    SpirvBuilder& entryPoint(uint32_t executionModel, const char* name, std::initializer_list<uint32_t> interfaceIds)
+    {
+        std::vector<uint32_t> nameWords(std::strlen(name) / 4 + 1, 0);
+        std::memcpy(nameWords.data(), name, std::strlen(name));
+        m_words.push_back(static_cast<uint32_t>(3 + nameWords.size() + interfaceIds.size()) << 16 | 15);
+        m_words.push_back(executionModel);
+        m_words.push_back(1);
+        m_words.insert(m_words.end(), nameWords.begin(), nameWords.end());
+        m_words.insert(m_words.end(), interfaceIds);
+        return *this;
+    }
+
+    const std::vector<uint32_t>& words() const
+    {
+        return m_words;
+    }
+
+private:
+    std::vector<uint32_t> m_words;
+};
+
+TEST(SpirvReflection, ReflectsVertexInputsUniformsAndPushConstants)
+{
+    SpirvBuilder builder;
+    builder.entryPoint(0, "main", {10, 11, 13})
+        .op(71, {10, 30, 1})     // Location 1
+        .op(71, {11, 30, 0})     // Location 0
+        .op(71, {13, 11, 0})     // BuiltIn VertexIndex
+        .op(71, {5, 2})          // Block
+        .op(72, {5, 0, 35, 0})   // Offset
+        .op(71, {12, 34, 1})     // DescriptorSet 1
+        .op(71, {12, 33, 2})     // Binding 2
+        .op(71, {7, 2})          // Block
+        .op(72, {7, 0, 35, 16})  // Offset
+        .op(72, {7, 1, 35, 24})  // Offset
+        .op(22, {1, 32})         // float
+        .op(23, {2, 1, 2})       // vec2
+        .op(21, {3, 32, 0})      // uint
+        .op(32, {4, 1, 2})       // Input vec2*
+        .op(32, {6, 1, 3})       // Input uint*
+        .op(30, {5, 2})          // struct { vec2 }
+        .op(32, {8, 2, 5})       // Uniform struct*
+        .op(30, {7, 1, 2})       // struct { float, vec2 }
+        .op(32, {9, 9, 7})       // PushConstant struct*
+        .op(59, {4, 10, 1})
+        .op(59, {6, 11, 1})
+        .op(59, {6, 13, 1})
+        .op(59, {8, 12, 2})
+        .op(59, {9, 14, 9});
+
+    ShaderReflection reflection;
+    ASSERT_TRUE(reflectSpirv(builder.words().data(), builder.words().size(), reflection));
+    EXPECT_EQ(reflection.executionModel, ShaderExecutionModel::Vertex);
+    EXPECT_EQ(reflection.entryPoint, "main");
+
+    ASSERT_EQ(reflection.vertexInputs.size(), 2u);
+    EXPECT_EQ(reflection.vertexInputs[0].location, 0u);
+    EXPECT_EQ(reflection.vertexInputs[0].componentKind, ComponentKind::UnsignedInt);
+    EXPECT_EQ(reflection.vertexInputs[0].componentCount, 1u);
+    EXPECT_EQ(reflection.vertexInputs[1].location, 1u);
+    EXPECT_EQ(reflection.vertexInputs[1].componentKind, ComponentKind::Float);
+    EXPECT_EQ(reflection.vertexInputs[1].componentCount, 2u);
+
+    ASSERT_EQ(reflection.descriptorBindings.size(), 1u);
+    EXPECT_EQ(reflection.descriptorBindings[0].set, 1u);
+    EXPECT_EQ(reflection.descriptorBindings[0].binding, 2u);
+    EXPECT_EQ(reflection.descriptorBindings[0].kind, DescriptorKind::UniformBuffer);
+    EXPECT_EQ(reflection.descriptorBindings[0].count, 1u);
+
+    EXPECT_EQ(reflection.pushConstantOffset, 16u);
+    EXPECT_EQ(reflection.pushConstantSize, 16u);
+}
+
+TEST(SpirvReflection, ReflectsResourceArraysAndStorageBuffers)
+{
+    SpirvBuilder builder;
+    builder.entryPoint(4, "main", {})
+        .op(71, {20, 34, 0})
+        .op(71, {20, 33, 3})
+        .op(71, {21, 3})         // BufferBlock
+        .op(71, {22, 34, 0})
+        .op(71, {22, 33, 1})
+        .op(22, {1, 32})         // float
+        .op(21, {2, 32, 0})      // uint
+        .op(43, {2, 3, 4})       // uint 4
+        .op(25, {4, 1, 1, 0, 0, 0, 1, 0})  // sampled 2D image
+        .op(27, {5, 4})          // combined image sampler
+        .op(28, {6, 5, 3})       // array of 4
+        .op(32, {7, 0, 6})       // UniformConstant array*
+        .op(29, {8, 1})          // float[]
+        .op(30, {9, 8})          // struct { float[] }
+        .op(32, {10, 2, 9})      // Uniform struct*
+        .op(59, {7, 20, 0})
+        .op(59, {10, 22, 2})
+        .op(71, {9, 3});         // BufferBlock
+
+    ShaderReflection reflection;
+    ASSERT_TRUE(reflectSpirv(builder.words().data(), builder.words().size(), reflection));
+    EXPECT_EQ(reflection.executionModel, ShaderExecutionModel::Fragment);
+    EXPECT_TRUE(reflection.vertexInputs.empty());
+    EXPECT_EQ(reflection.pushConstantSize, 0u);
+
+    ASSERT_EQ(reflection.descriptorBindings.size(), 2u);
+    EXPECT_EQ(reflection.descriptorBindings[0].binding, 1u);
+    EXPECT_EQ(reflection.descriptorBindings[0].kind, DescriptorKind::StorageBuffer);
+    EXPECT_EQ(reflection.descriptorBindings[1].binding, 3u);
+    EXPECT_EQ(reflection.descriptorBindings[1].kind, DescriptorKind::CombinedImageSampler);
+    EXPECT_EQ(reflection.descriptorBindings[1].count, 4u);
+}
+
+TEST(SpirvReflection, RejectsMalformedModules)
+{
+    ShaderReflection reflection;
+    const uint32_t notSpirv[] = {0xdeadbeef, 0x00010000, 0, 1, 0};
+    EXPECT_FALSE(reflectSpirv(notSpirv, 5, reflection));
+
+    SpirvBuilder builder;
+    builder.entryPoint(0, "main", {}).op(22, {1, 32});
+    std::vector<uint32_t> truncated = builder.words();
+    truncated.pop_back();
+    EXPECT_FALSE(reflectSpirv(truncated.data(), truncated.size(), reflection));
+
+    // Without an entry point there is no interface to reflect.
+    SpirvBuilder noEntryPoint;
+    noEntryPoint.op(22, {1, 32});
+    EXPECT_FALSE(reflectSpirv(noEntryPoint.words().data(), noEntryPoint.words().size(), reflection));
+}
@@ -0,0 +1,82 @@
+#include "tlsfAllocator.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+TEST(TlsfAllocator, AllocationsAreAlignedAndDisjoint)
+{
+    TlsfAllocator allocator(1 << 20);
+    std::vector<TlsfAllocator::Allocation> allocations;
+
+    std::mt19937 random(7);
+    for (int i = 0; i < 200; ++i)
+    {
+        const uint64_t size = 1 + random() % 4000;
+        const uint64_t alignment = 1ull << (random() % 12);
+        TlsfAllocator::Allocation allocation;
+        ASSERT_TRUE(allocator.allocate(size, alignment, allocation));
+        EXPECT_EQ(allocation.offset % alignment, 0u);
+        EXPECT_GE(allocation.size, size);
+        allocations.push_back(allocation);
+    }
+
+    std::sort(allocations.begin(), allocations.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+    for (size_t i = 1; i < allocations.size(); ++i)
+    {
+        EXPECT_LE(allocations[i - 1].offset + allocations[i - 1].size, allocations[i].offset);
+    }
+    EXPECT_LE(allocations.back().offset + allocations.back().size, allocator.size());
+}
+
+TEST(TlsfAllocator, FreedRangesCoalesce)
+{
+    const uint64_t size = 64 * 1024;
+    TlsfAllocator allocator(size);
+
+    std::vector<TlsfAllocator::Allocation> allocations(16);
+    for (auto& allocation : allocations)
+    {
+        ASSERT_TRUE(allocator.allocate(size / 16, 8, allocation));
+    }
+    TlsfAllocator::Allocation overflow;
+    EXPECT_FALSE(allocator.allocate(8, 8, overflow));
+
+    // Free every other range first, then the rest, the allocator has to end up with one free range again.
+    for (size_t i = 0; i < allocations.size(); i += 2)
+    {
+        allocator.free(allocations[i].handle);
+    }
+    EXPECT_EQ(allocator.stats().freeRangeCount, 8u);
+    for (size_t i = 1; i < allocations.size(); i += 2)
+    {
+        allocator.free(allocations[i].handle);
+    }
+
+    const TlsfStats stats = allocator.stats();
+    EXPECT_TRUE(allocator.empty());
+    EXPECT_EQ(stats.usedSize, 0u);
+    EXPECT_EQ(stats.freeRangeCount, 1u);
+    EXPECT_EQ(stats.largestFreeRange, size);
+
+    TlsfAllocator::Allocation whole;
+    EXPECT_TRUE(allocator.allocate(size, 8, whole));
+    EXPECT_EQ(whole.offset, 0u);
+}
+
+TEST(TlsfAllocator, AlignmentPaddingIsReusable)
+{
+    TlsfAllocator allocator(1 << 16);
+    TlsfAllocator::Allocation small;
+    TlsfAllocator::Allocation aligned;
+    ASSERT_TRUE(allocator.allocate(24, 8, small));
+    ASSERT_TRUE(allocator.allocate(256, 4096, aligned));
+    EXPECT_EQ(aligned.offset, 4096u);
+
+    // The gap in front of the aligned allocation stays available for small allocations.
+    TlsfAllocator::Allocation filler;
+    ASSERT_TRUE(allocator.allocate(1024, 8, filler));
+    EXPECT_LT(filler.offset, aligned.offset);
+}
@@ -0,0 +1,160 @@
+#include "transformBatch.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+static const SimdLevel kLevels[] = {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2};
+
+// The inside of the cube [-1, 1]^3, normalized and facing inwards.
+static const glm::vec4 kUnitCube[6] = {glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+                                       glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+                                       glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
+                                       glm::vec4(0.0f, -1.0f, 0.0f, 1.0f),
+                                       glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+                                       glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)};
+
+// Deterministic objects with normalized rotations, scattered around the unit cube.
+static void fillBatch(TransformBatch& batch, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const float t = static_cast<float>(i);
+        const glm::vec3 axis(std::sin(t * 0.7f), std::cos(t * 1.3f), std::sin(t * 2.1f) + 0.1f);
+        const float axisLength = std::sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+        const float halfAngle = t * 0.37f;
+        const float sine = std::sin(halfAngle) / axisLength;
+        const glm::quat rotation(std::cos(halfAngle), axis.x * sine, axis.y * sine, axis.z * sine);
+        const glm::vec3 position(2.0f * std::sin(t * 0.11f), 2.0f * std::cos(t * 0.23f), 1.5f * std::sin(t * 0.05f));
+        const float scale = i % 7 == 0 ? -0.25f : 0.05f + 0.01f * static_cast<float>(i % 13);
+        batch.add(position, rotation, scale, glm::vec4(0.3f, -0.2f, 0.1f, 0.5f));
+    }
+}
+
+TEST(TransformBatch, FrustumPlanesOfTheIdentityBoundTheClipVolume)
+{
+    glm::vec4 planes[6];
+    frustumPlanes(glm::mat4(1.0f), planes);
+    // x and y in [-1, 1], z in [0, 1].
+    const glm::vec4 expected[6] = {glm::vec4(1.0f, 0.0f, 0.0f, 1.0f),
+                                   glm::vec4(-1.0f, 0.0f, 0.0f, 1.0f),
+                                   glm::vec4(0.0f, 1.0f, 0.0f, 1.0f),
+                                   glm::vec4(0.0f, -1.0f, 0.0f, 1.0f),
+                                   glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+                                   glm::vec4(0.0f, 0.0f, -1.0f, 1.0f)};
+    for (int plane = 0; plane < 6; ++plane)
+    {
+        for (int component = 0; component < 4; ++component)
+        {
+            EXPECT_FLOAT_EQ(planes[plane][component], expected[plane][component]) << plane << ", " << component;
+        }
+    }
+}
+
+TEST(TransformBatch, ComposesTranslationRotationAndScale)
+{
+    TransformBatch batch(SimdLevel::Scalar);
+    // A quarter turn around z.
+    const float half = std::sqrt(0.5f);
+    batch.add(glm::vec3(1.0f, 2.0f, 3.0f), glm::quat(half, 0.0f, 0.0f, half), 2.0f, glm::vec4(1.0f, 0.0f, 0.0f, 0.5f));
+    batch.update();
+
+    const glm::mat4& model = batch.modelMatrices()[0];
+    const float expected[4][4] = {{0, 2, 0, 0}, {-2, 0, 0, 0}, {0, 0, 2, 0}, {1, 2, 3, 1}};
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            EXPECT_NEAR(model[column][row], expected[column][row], 1e-6f) << column << ", " << row;
+        }
+    }
+    const glm::vec4 sphere = batch.worldSphere(0);
+    EXPECT_NEAR(sphere.x, 1.0f, 1e-6f);
+    EXPECT_NEAR(sphere.y, 4.0f, 1e-6f);
+    EXPECT_NEAR(sphere.z, 3.0f, 1e-6f);
+    EXPECT_FLOAT_EQ(sphere.w, 1.0f);
+}
+
+TEST(TransformBatch, EveryLevelMatchesScalar)
+{
+    // Not a multiple of 8, the vector kernels leave a tail to the scalar one.
+    const uint32_t count = 1003;
+    TransformBatch reference(SimdLevel::Scalar);
+    fillBatch(reference, count);
+    reference.update();
+    std::vector<uint32_t> referenceVisible;
+    reference.cull(kUnitCube, referenceVisible);
+    ASSERT_GT(referenceVisible.size(), 0u);
+    ASSERT_LT(referenceVisible.size(), count);
+
+    for (SimdLevel level : kLevels)
+    {
+        TransformBatch batch(level);
+        fillBatch(batch, count);
+        batch.update();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float* model = &batch.modelMatrices()[i][0][0];
+            const float* referenceModel = &reference.modelMatrices()[i][0][0];
+            for (int element = 0; element < 16; ++element)
+            {
+                ASSERT_NEAR(model[element], referenceModel[element], 1e-5f)
+                    << simdLevelName(batch.simdLevel()) << " object " << i << " element " << element;
+            }
+            for (int component = 0; component < 4; ++component)
+            {
+                ASSERT_NEAR(batch.worldSphere(i)[component], reference.worldSphere(i)[component], 1e-5f)
+                    << simdLevelName(batch.simdLevel()) << " object " << i;
+            }
+        }
+        std::vector<uint32_t> visible;
+        EXPECT_EQ(batch.cull(kUnitCube, visible), referenceVisible.size());
+        EXPECT_EQ(visible, referenceVisible) << simdLevelName(batch.simdLevel());
+    }
+}
+
+TEST(TransformBatch, CullKeepsSpheresTouchingTheFrustum)
+{
+    for (SimdLevel level : kLevels)
+    {
+        TransformBatch batch(level);
+        // 19 objects cover full blocks of 4 and 8 and a tail. Every third one is outside, the others inside or
+        // straddling a plane.
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < 19; ++i)
+        {
+            const float offset = static_cast<float>(i % 3);
+            const glm::vec3 position = i % 2 == 0 ? glm::vec3(offset * 0.9f, 0.0f, 0.0f)
+                                                  : glm::vec3(0.0f, 0.0f, -offset * 0.9f);
+            batch.add(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 1.0f, glm::vec4(0.0f, 0.0f, 0.0f, 0.5f));
+            if (i % 3 != 2)
+            {
+                expected.push_back(i);
+            }
+        }
+        batch.update();
+
+        std::vector<uint32_t> visible = {42};
+        EXPECT_EQ(batch.cull(kUnitCube, visible), expected.size());
+        expected.insert(expected.begin(), 42);
+        EXPECT_EQ(visible, expected) << simdLevelName(batch.simdLevel());
+    }
+}
+
+TEST(TransformBatch, RemoveSwapMovesTheLastObject)
+{
+    TransformBatch batch(SimdLevel::Scalar);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        const float x = static_cast<float>(i);
+        batch.add(glm::vec3(x, 0.0f, 0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), 1.0f, glm::vec4(0.0f, 0.0f, 0.0f, x));
+    }
+    batch.removeSwap(1);
+    batch.update();
+
+    ASSERT_EQ(batch.size(), 3u);
+    EXPECT_EQ(batch.worldSphere(0).x, 0.0f);
+    EXPECT_EQ(batch.worldSphere(1).x, 3.0f);
+    EXPECT_EQ(batch.worldSphere(1).w, 3.0f);
+    EXPECT_EQ(batch.worldSphere(2).x, 2.0f);
+}
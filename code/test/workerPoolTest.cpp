@@ -0,0 +1,48 @@
+#include "workerPool.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+TEST(WorkerPool, ParallelForRunsEveryIndexOnce)
+{
+    WorkerPool workerPool(4);
+    EXPECT_EQ(workerPool.threadCount(), 4u);
+
+    std::vector<std::atomic<int>> runCounts(1000);
+    workerPool.parallelFor(static_cast<uint32_t>(runCounts.size()), [&](uint32_t index) { ++runCounts[index]; });
+    for (const auto& runCount : runCounts)
+    {
+        EXPECT_EQ(runCount.load(), 1);
+    }
+}
+
+TEST(WorkerPool, ParallelForUsesWorkerThreads)
+{
+    WorkerPool workerPool(2);
+    std::mutex mutex;
+    std::set<std::thread::id> threadIds;
+    workerPool.parallelFor(64, [&](uint32_t) {
+        std::lock_guard<std::mutex> lock(mutex);
+        threadIds.insert(std::this_thread::get_id());
+    });
+    EXPECT_EQ(threadIds.count(std::this_thread::get_id()), 0u);
+    EXPECT_LE(threadIds.size(), 2u);
+}
+
+TEST(WorkerPool, SubmittedJobsFinishBeforeDestruction)
+{
+    std::atomic<int> finished(0);
+    {
+        WorkerPool workerPool(3);
+        for (int i = 0; i < 100; ++i)
+        {
+            workerPool.submit([&finished]() { ++finished; });
+        }
+    }
+    EXPECT_EQ(finished.load(), 100);
+}
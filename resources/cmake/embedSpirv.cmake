@@ -0,0 +1,35 @@
+# Converts a SPIR-V binary into a header holding it as a constexpr array of 32 bit words.
+# Usage: cmake -DINPUT=<shader.spv> -DOUTPUT=<header.h> -DVARIABLE=<name> -P embedSpirv.cmake
+
+file(READ "${INPUT}" SPIRV_HEX HEX)
+string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+math(EXPR SPIRV_REMAINDER "${SPIRV_HEX_LENGTH} % 8")
+if(SPIRV_HEX_LENGTH EQUAL 0 OR NOT SPIRV_REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${INPUT} is not a SPIR-V binary, its size is not a multiple of 4 bytes.")
+endif()
+
+# SPIR-V words are stored little endian, 8 words per line.
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " SPIRV_WORDS "${SPIRV_HEX}")
+set(SPIRV_LINE_PATTERN "")
+foreach(WORD RANGE 1 8)
+    string(APPEND SPIRV_LINE_PATTERN "0x[0-9a-f]+u, ")
+endforeach()
+string(REGEX REPLACE "(${SPIRV_LINE_PATTERN})" "\\1\n    " SPIRV_WORDS "${SPIRV_WORDS}")
+string(REGEX REPLACE ", \n" ",\n" SPIRV_WORDS "${SPIRV_WORDS}")
+string(REGEX REPLACE "[, \n]+$" "" SPIRV_WORDS "${SPIRV_WORDS}")
+
+string(TOUPPER "${VARIABLE}" GUARD)
+get_filename_component(INPUT_NAME "${INPUT}" NAME)
+file(WRITE "${OUTPUT}"
+"// Generated from ${INPUT_NAME} by embedSpirv.cmake, do not edit.
+#ifndef ${GUARD}_H
+#define ${GUARD}_H
+
+#include <cstdint>
+
+alignas(4) constexpr uint32_t ${VARIABLE}[] = {
+    ${SPIRV_WORDS}
+};
+
+#endif
+")
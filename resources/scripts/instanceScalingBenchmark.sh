@@ -0,0 +1,18 @@
+#!/bin/bash
+# Renders headless with 1 up to 1M instances and prints the frame statistics of every run.
+# Usage: instanceScalingBenchmark.sh [path to vkTriangle] [frames per run]
+SCRIPT_PATH="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )";
+. "${SCRIPT_PATH}/defaultBaseEnvironment.sh";
+
+BINARY="${1:-${BUILD_ROOT}/goboVkTriangle/vkTriangle}";
+FRAMES="${2:-500}";
+LOG_FILE="./goboVkTriangle.log";
+
+for INSTANCES in 1 10 100 1000 10000 100000 1000000; do
+    rm -f "${LOG_FILE}";
+    if ! "${BINARY}" --headless --frames "${FRAMES}" --instances "${INSTANCES}"; then
+        echo "Run with ${INSTANCES} instances failed.";
+        exit 1;
+    fi
+    grep "avg frame time" "${LOG_FILE}" | tail -n 1;
+done
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Measures time to first frame against the number of pipeline variants, built in the background on all cores vs.
+# serially before the first frame. Runs headless without the on-disk pipeline cache.
+# Usage: pipelineVariantBenchmark.sh [path to vkTriangle_bench] [frames per run]
+SCRIPT_PATH="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )";
+. "${SCRIPT_PATH}/defaultBaseEnvironment.sh";
+
+BINARY="${1:-${BUILD_ROOT}/goboVkTriangle/vkTriangle_bench}";
+FRAMES="${2:-200}";
+
+for VARIANTS in 1 4 16 64; do
+    for BUILD in background serial; do
+        if [ "${BUILD}" == "background" ]; then
+            BUILD_OPTIONS="--pipeline-build-threads 0";
+        else
+            BUILD_OPTIONS="--pipeline-build-threads 1 --wait-for-pipelines";
+        fi
+        echo "${VARIANTS} variants, ${BUILD} build:";
+        if ! "${BINARY}" --frames "${FRAMES}" --instances 1000 --instances-per-draw 10 \
+            --pipeline-variants "${VARIANTS}" ${BUILD_OPTIONS}; then
+            echo "Run with ${VARIANTS} variants, ${BUILD} build failed.";
+            exit 1;
+        fi
+    done
+done
@@ -0,0 +1,25 @@
+#!/bin/bash
+# Compares static and per-frame command buffer recording, inline and on worker threads, headless.
+# Usage: recordingModeBenchmark.sh [path to vkTriangle] [frames per run] [recording threads]
+SCRIPT_PATH="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )";
+. "${SCRIPT_PATH}/defaultBaseEnvironment.sh";
+
+BINARY="${1:-${BUILD_ROOT}/goboVkTriangle/vkTriangle}";
+FRAMES="${2:-500}";
+THREADS="${3:-$(nproc)}";
+LOG_FILE="./goboVkTriangle.log";
+
+for DRAWS in 1 100 10000; do
+    for MODE in static per-frame; do
+        for RECORDING_THREADS in 0 "${THREADS}"; do
+            rm -f "${LOG_FILE}";
+            if ! "${BINARY}" --headless --frames "${FRAMES}" --instances 100000 \
+                --instances-per-draw $((100000 / DRAWS)) --recording-mode "${MODE}" \
+                --recording-threads "${RECORDING_THREADS}"; then
+                echo "Run with ${DRAWS} draws, ${MODE} recording on ${RECORDING_THREADS} threads failed.";
+                exit 1;
+            fi
+            grep "avg frame time" "${LOG_FILE}" | tail -n 1;
+        done
+    done
+done